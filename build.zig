@@ -21,6 +21,7 @@ const tyrian_srcs = [_][]const u8{
     "src/lib/palette.c",
     "src/lib/params.c",
     "src/lib/pcxmast.c",
+    "src/lib/philox.c",
     "src/lib/picload.c",
     "src/lib/sprite.c",
     "src/lib/vga256d.c",
@@ -64,29 +65,10 @@ pub fn build(b: *std.Build) !void {
             .optimize = optimize,
         }),
     });
-    exe.addCSourceFiles(.{ .files = &tyrian_srcs, .flags = c_flags });
-    exe.addIncludePath(b.path("src/lib/"));
+    addGameSources(b, exe);
 
     const resolved_target = exe.root_module.resolved_target.?;
 
-    const assets = b.dependency("assets", .{
-        .target = resolved_target,
-        .optimize = .ReleaseFast,
-    });
-    exe.root_module.addImport("assets", assets.module("root"));
-    exe.step.dependOn(&assets.artifact("assets").step); // force the "assets" module to build
-
-    {
-        const sdl_dep = b.dependency("sdl", .{
-            .target = resolved_target,
-            .optimize = .ReleaseFast,
-            // .c_flags = c_flags,
-        });
-        exe.linkLibrary(sdl_dep.artifact("SDL2"));
-        exe.addIncludePath(sdl_dep.artifact("SDL2").getEmittedIncludeTree().path(b, "SDL2/"));
-        exe.root_module.addImport("sdl2", sdl_dep.module("sdl"));
-    }
-
     if (target_emscripten) {
         const link_step = try emLinkStep(b, emsdk_dep, .{
             .target = resolved_target,
@@ -109,9 +91,69 @@ pub fn build(b: *std.Build) !void {
 
         const run = b.step("run", "Run the demo for desktop");
         run.dependOn(&run_cmd.step);
+
+        // AI-vs-AI tournament runner.  Desktop only; it never opens a window.
+        const tournament = b.addExecutable(.{
+            .name = "destruct-tournament",
+            .root_module = b.createModule(.{
+                .root_source_file = b.path("src/tournament.zig"),
+                .target = target,
+                .optimize = optimize,
+            }),
+        });
+        addGameSources(b, tournament);
+        b.installArtifact(tournament);
+
+        const tournament_cmd = b.addRunArtifact(tournament);
+        tournament_cmd.step.dependOn(b.getInstallStep());
+        if (b.args) |args| {
+            tournament_cmd.addArgs(args);
+        }
+
+        const tournament_step = b.step("tournament", "Run an AI-vs-AI tournament on all cores");
+        tournament_step.dependOn(&tournament_cmd.step);
+
+        // Tests of the simulation, run headless against the C library
+        const tests = b.addTest(.{
+            .root_module = b.createModule(.{
+                .root_source_file = b.path("src/test.zig"),
+                .target = target,
+                .optimize = optimize,
+            }),
+        });
+        addGameSources(b, tests);
+
+        const tests_cmd = b.addRunArtifact(tests);
+
+        const test_step = b.step("test", "Run the tests of the simulation");
+        test_step.dependOn(&tests_cmd.step);
     }
 }
 
+// Adds the game's C sources, assets and SDL to an executable.
+fn addGameSources(b: *std.Build, exe: *std.Build.Step.Compile) void {
+    exe.addCSourceFiles(.{ .files = &tyrian_srcs, .flags = c_flags });
+    exe.addIncludePath(b.path("src/lib/"));
+
+    const resolved_target = exe.root_module.resolved_target.?;
+
+    const assets = b.dependency("assets", .{
+        .target = resolved_target,
+        .optimize = .ReleaseFast,
+    });
+    exe.root_module.addImport("assets", assets.module("root"));
+    exe.step.dependOn(&assets.artifact("assets").step); // force the "assets" module to build
+
+    const sdl_dep = b.dependency("sdl", .{
+        .target = resolved_target,
+        .optimize = .ReleaseFast,
+        // .c_flags = c_flags,
+    });
+    exe.linkLibrary(sdl_dep.artifact("SDL2"));
+    exe.addIncludePath(sdl_dep.artifact("SDL2").getEmittedIncludeTree().path(b, "SDL2/"));
+    exe.root_module.addImport("sdl2", sdl_dep.module("sdl"));
+}
+
 // Creates the static library to build a project for Emscripten.
 fn compileEmscripten(
     b: *std.Build,
@@ -129,7 +171,11 @@ fn compileEmscripten(
     for (target.result.cpu.arch.allFeaturesList(), 0..) |feature, index_usize| {
         const index = @as(std.Target.Cpu.Feature.Set.Index, @intCast(index_usize));
         if (feature.llvm_name) |llvm_name| {
-            if (std.mem.eql(u8, llvm_name, "atomics") or std.mem.eql(u8, llvm_name, "bulk-memory")) {
+            // simd128 gives the C code its vector kernels
+            if (std.mem.eql(u8, llvm_name, "atomics") or
+                std.mem.eql(u8, llvm_name, "bulk-memory") or
+                std.mem.eql(u8, llvm_name, "simd128"))
+            {
                 target_query.cpu_features_add.addFeature(index);
             }
         }
@@ -1,13 +1,15 @@
 const std = @import("std");
 const SDL = @import("sdl2");
 
-const c = @cImport({
+pub const c = @cImport({
     @cInclude("destruct.h");
     @cInclude("config.h");
     @cInclude("fonthand.h");
     @cInclude("keyboard.h");
     @cInclude("helptext.h");
+    @cInclude("nortsong.h");
     @cInclude("palette.h");
+    @cInclude("params.h");
     @cInclude("picload.h");
     @cInclude("sprite.h");
     @cInclude("video.h");
@@ -17,54 +19,31 @@ pub const assets = @import("assets");
 
 const Destruct = @This();
 
-config: c.destruct_config_s = .{
-    .max_shots = 40,
-    .min_walls = 20,
-    .max_walls = 20,
-    .max_explosions = 40,
-    .max_installations = 10,
-    .allow_custom = false,
-    .alwaysalias = false,
-    .jumper_straight = .{ true, false },
-    .ai = .{ true, false },
-},
-destruct_players: [c.MAX_PLAYERS]c.destruct_player_s = undefined,
-world: c.destruct_world_s = undefined,
-shotRec: *c.destruct_shot_s = undefined,
-exploRec: *c.destruct_explo_s = undefined,
-destructInternalScreen: *c.SDL_Surface = undefined,
-destructPrevScreen: *c.SDL_Surface = undefined,
-
-// Startup
-pub fn JE_destructGame() void {
+match: c.destruct_match_s = undefined,
+planner: Planner = .{},
+
+// Startup.  A non-null record_file gets an input log of everything played,
+// with world hashes if record_hashes is set.
+pub fn JE_destructGame(record_file: [*c]const u8, record_hashes: bool) void {
     var self = Destruct{};
 
     // This is the entry function.  Any one-time actions we need to perform can go in here.
     c.JE_clr256(c.VGAScreen);
     c.JE_showVGA();
 
-    c.load_destruct_config(&c.opentyrian_config, &self.config);
+    self.init(false, c.VGAScreen, c.game_screen, c.VGAScreen2);
+    defer self.deinit();
 
-    // malloc things that have customizable sizes
-    self.shotRec = @alignCast(@ptrCast(c.malloc(@sizeOf(c.destruct_shot_s) * self.config.max_shots).?));
-    defer c.free(self.shotRec);
-    self.exploRec = @alignCast(@ptrCast(c.malloc(@sizeOf(c.destruct_explo_s) * self.config.max_explosions).?));
-    defer c.free(self.exploRec);
-    self.world.mapWalls = @alignCast(@ptrCast(c.malloc(@sizeOf(c.destruct_wall_s) * self.config.max_walls).?));
-    defer c.free(self.world.mapWalls);
+    self.match.keysactive = &c.keysactive;
 
-    //Malloc enough structures to cover all of this session's possible needs.
-    for (0..10) |i| {
-        self.config.max_installations = c.MAX(self.config.max_installations, c.basetypes[i][0]);
+    var log: c.destruct_log_s = undefined;
+    if (record_file != null) {
+        c.DE_RecordLog(&self.match, &log, record_hashes);
+    }
+    defer if (record_file != null) {
+        saveLog(&log, record_file);
+        c.DE_FreeLog(&log);
     }
-    self.destruct_players[c.PLAYER_LEFT].unit = @alignCast(@ptrCast(c.malloc(@sizeOf(c.destruct_unit_s) * self.config.max_installations).?));
-    defer c.free(self.destruct_players[c.PLAYER_LEFT].unit);
-    self.destruct_players[c.PLAYER_RIGHT].unit = @alignCast(@ptrCast(c.malloc(@sizeOf(c.destruct_unit_s) * self.config.max_installations).?));
-    defer c.free(self.destruct_players[c.PLAYER_RIGHT].unit);
-
-    self.world.VGAScreen = c.VGAScreen;
-    self.destructInternalScreen = c.game_screen;
-    self.destructPrevScreen = c.VGAScreen2;
 
     c.JE_loadCompShapes(assets.game_sprites.ptr, assets.game_sprites.len, &c.destructSpriteSheet);
     defer c.free_sprite2s(&c.destructSpriteSheet);
@@ -74,58 +53,613 @@ pub fn JE_destructGame() void {
     self.JE_destructMain();
 }
 
+fn init(
+    self: *Destruct,
+    headless: bool,
+    screen: *c.SDL_Surface,
+    destructInternalScreen: *c.SDL_Surface,
+    destructPrevScreen: *c.SDL_Surface,
+) void {
+    const config = loadConfig(headless);
+
+    // Each match draws from its own generator, seeded off the global one.
+    c.DE_InitMatch(&self.match, &config, c.mt_rand(), screen, destructInternalScreen, destructPrevScreen);
+    startPlanner(&self.planner, &self.match);
+}
+
+// A match on its own has every core but its thread's to play rollouts on,
+// one tick behind it.
+fn startPlanner(planner: *Planner, match: *c.destruct_match_s) void {
+    const cores = std.Thread.getCpuCount() catch 1;
+    planner.start(match, @max(cores, 2) - 1, cores > 1);
+}
+
+// Reads the destruct settings out of the already loaded OpenTyrian config.
+// --players, --units, --world and --ai win over what the config file says.
+pub fn loadConfig(headless: bool) c.destruct_config_s {
+    var config: c.destruct_config_s = undefined;
+    c.DE_ResetConfig(&config);
+    c.load_destruct_config(&c.opentyrian_config, &config);
+    config.headless = headless;
+    if (c.battlePlayers != 0) {
+        config.players = c.battlePlayers;
+    }
+    if (c.battleUnits != 0) {
+        config.battle_units = c.battleUnits;
+    }
+    if (c.worldWidth != 0) {
+        config.world_width = c.worldWidth;
+        config.world_height = c.worldHeight;
+    }
+    if (c.aiLevelSet) {
+        config.ai_level = @intCast(c.aiLevel);
+    }
+    return config;
+}
+
+fn deinit(self: *Destruct) void {
+    self.planner.stop();
+    c.DE_FreeMatch(&self.match);
+}
+
+// Plays the rollout AI's candidate shots out for a match, spread over a pool
+// of threads if it has more than one worker.  Behind, the pool plays each
+// tick's slice of a search while the match thread gets on with the tick, and
+// the match only waits for it at the start of the next.  Matches without the
+// rollout AI don't get one.
+pub const Planner = struct {
+    planner: c.destruct_planner_s = undefined,
+    match: ?*c.destruct_match_s = null,
+    pool: std.Thread.Pool = undefined,
+    pooled: bool = false,
+    slice: std.Thread.WaitGroup = .{},
+
+    pub fn start(self: *Planner, match: *c.destruct_match_s, workers: usize, behind: bool) void {
+        if (match.config.ai_level != c.AI_ROLLOUT) {
+            return;
+        }
+        c.DE_InitPlanner(&self.planner, match, @intCast(workers));
+        if (behind or workers > 1) pooled: {
+            // Unless it's behind, the thread that runs the match plays its
+            // share too
+            const threads = if (behind) workers else workers - 1;
+            self.pool.init(.{ .allocator = std.heap.page_allocator, .n_jobs = threads }) catch break :pooled;
+            self.pooled = true;
+            self.planner.dispatch = &dispatch;
+            self.planner.context = self;
+            if (behind) {
+                self.planner.dispatch = &launch;
+                self.planner.wait = &wait;
+            }
+        }
+        match.planner = &self.planner;
+        self.match = match;
+    }
+
+    pub fn stop(self: *Planner) void {
+        const match = self.match orelse return;
+        match.planner = null;
+        if (self.pooled) {
+            self.slice.wait();
+            self.pool.deinit();
+            self.pooled = false;
+        }
+        c.DE_FreePlanner(&self.planner);
+        self.match = null;
+    }
+
+    pub fn logStats(self: *const Planner) void {
+        if (self.match == null) {
+            return;
+        }
+        var rollouts: c_ulong = 0;
+        var ticks: c_ulong = 0;
+        c.DE_PlannerStats(&self.planner, &rollouts, &ticks);
+        std.log.info("rollout AI: {d} searches, {d} rollouts, {d} ticks played out on {d} workers", .{
+            self.planner.searches,
+            rollouts,
+            ticks,
+            self.planner.workers,
+        });
+    }
+
+    fn dispatch(planner: [*c]c.destruct_planner_s) callconv(.C) void {
+        const self: *Planner = @ptrCast(@alignCast(planner.*.context.?));
+        var wait_group: std.Thread.WaitGroup = .{};
+        for (0..planner.*.jobs) |worker| {
+            self.pool.spawnWg(&wait_group, c.DE_RunPlanner, .{ planner, @as(c_uint, @intCast(worker)) });
+        }
+        self.pool.waitAndWork(&wait_group);
+    }
+
+    fn launch(planner: [*c]c.destruct_planner_s) callconv(.C) void {
+        const self: *Planner = @ptrCast(@alignCast(planner.*.context.?));
+        for (0..planner.*.jobs) |worker| {
+            self.pool.spawnWg(&self.slice, c.DE_RunPlanner, .{ planner, @as(c_uint, @intCast(worker)) });
+        }
+    }
+
+    fn wait(planner: [*c]c.destruct_planner_s) callconv(.C) void {
+        const self: *Planner = @ptrCast(@alignCast(planner.*.context.?));
+        self.slice.wait();
+        self.slice.reset();
+    }
+};
+
+pub fn createScreen() *c.SDL_Surface {
+    const surface = c.SDL_CreateRGBSurface(0, c.vga_width, c.vga_height, 8, 0, 0, 0, 0);
+    if (surface == null) {
+        std.log.err("Failed to create surface: {s}", .{c.SDL_GetError()});
+        std.process.exit(1);
+    }
+    return surface;
+}
+
+// Results go to stdout, one line each, where a script can read them apart from
+// the diagnostics std.log writes to stderr.  A line that can't be written is
+// dropped.
+pub fn printResult(comptime format: []const u8, args: anytype) void {
+    std.io.getStdOut().writer().print(format ++ "\n", args) catch {};
+}
+
+pub fn modeName(mode: c.de_mode_t) []const u8 {
+    if (mode < c.DESTRUCT_MODES) {
+        return std.mem.sliceTo(&c.destructModeName[@intCast(mode)], 0);
+    }
+    return "Custom";
+}
+
+// Decodes the in-game backdrop into a surface of its own.  Rounds start from
+// a copy of it, since JE_loadPic can't be called from two threads.
+pub fn loadBackdrop() *c.SDL_Surface {
+    const backdrop = createScreen();
+    c.JE_loadPic(assets.game_screen.ptr, assets.game_screen.len, backdrop, 11, false);
+    return backdrop;
+}
+
+pub const RoundResult = struct {
+    ticks: c_uint,
+    finished: bool,
+};
+
+// Plays one headless round of match on a fresh map.  A round still going
+// after max_ticks ticks (0 means no limit) is cut short and left unfinished.
+pub fn playRound(match: *c.destruct_match_s, backdrop: *const c.SDL_Surface, max_ticks: c_uint) RoundResult {
+    _ = c.memcpy(match.world.VGAScreen.*.pixels, backdrop.pixels, @intCast(backdrop.h * backdrop.pitch));
+
+    c.DE_ResetUnits(match);
+    c.DE_ResetLevel(match);
+
+    var ticks: c_uint = 0;
+    while (max_ticks == 0 or ticks < max_ticks) {
+        const curState = c.DE_RunTick(match);
+        ticks += 1;
+        if (curState != c.STATE_CONTINUE) {
+            return .{ .ticks = ticks, .finished = true };
+        }
+    }
+    return .{ .ticks = ticks, .finished = false };
+}
+
+fn saveLog(log: *const c.destruct_log_s, filename: [*c]const u8) void {
+    if (c.DE_SaveLog(log, filename)) {
+        std.log.info("input log: {d} ticks written to {s}", .{ log.ticks, std.mem.span(filename) });
+    } else {
+        std.log.err("Failed to write input log {s}", .{std.mem.span(filename)});
+    }
+}
+
+// Headless startup.  Plays CPU-vs-CPU rounds of one mode as fast as the CPU
+// allows and reports who won.  A max_rounds or max_ticks of 0 means no limit.
+// A non-null record_file gets an input log of the rounds played, with world
+// hashes if record_hashes is set.
+pub fn JE_destructHeadless(
+    mode: c.de_mode_t,
+    max_rounds: c_uint,
+    max_ticks: c_uint,
+    record_file: [*c]const u8,
+    record_hashes: bool,
+) void {
+    var self = Destruct{};
+
+    // Off-screen stand-ins for the video surfaces.  Terrain is still drawn on
+    // top of the backdrop picture, and the simulation reads it back from there.
+    const backdrop = loadBackdrop();
+    defer c.SDL_FreeSurface(backdrop);
+    const screen = createScreen();
+    defer c.SDL_FreeSurface(screen);
+    const destructInternalScreen = createScreen();
+    defer c.SDL_FreeSurface(destructInternalScreen);
+    const destructPrevScreen = createScreen();
+    defer c.SDL_FreeSurface(destructPrevScreen);
+
+    self.init(true, screen, destructInternalScreen, destructPrevScreen);
+    defer self.deinit();
+
+    const match = &self.match;
+
+    c.DE_ResetPlayers(match);
+    for (&match.destruct_player) |*player| {
+        player.is_cpu = true;
+    }
+    match.world.destructMode = mode;
+
+    var log: c.destruct_log_s = undefined;
+    if (record_file != null) {
+        c.DE_RecordLog(match, &log, record_hashes);
+    }
+    defer if (record_file != null) {
+        saveLog(&log, record_file);
+        c.DE_FreeLog(&log);
+    }
+
+    var rounds: c_uint = 0;
+    var ticks: c_uint = 0;
+    var wins = std.mem.zeroes([c.MAX_TEAMS]c_uint);
+    var draws: c_uint = 0;
+
+    const start_time = std.time.nanoTimestamp();
+
+    while (max_rounds == 0 or rounds < max_rounds) {
+        if (max_ticks != 0 and ticks >= max_ticks) {
+            break;
+        }
+
+        const round = playRound(match, backdrop, if (max_ticks != 0) max_ticks - ticks else 0);
+        ticks += round.ticks;
+        if (!round.finished) {
+            break; // the unfinished round is not counted
+        }
+        rounds += 1;
+
+        const left_alive = c.DE_TeamUnits(match, c.TEAM_LEFT) > 0;
+        const right_alive = c.DE_TeamUnits(match, c.TEAM_RIGHT) > 0;
+        const result = if (left_alive == right_alive) "draw" else if (left_alive) "left wins" else "right wins";
+        if (left_alive == right_alive) {
+            draws += 1;
+        } else {
+            const winner: usize = if (left_alive) c.TEAM_LEFT else c.TEAM_RIGHT;
+            wins[winner] += 1;
+        }
+
+        std.log.debug("round {d}: {s} after {d} ticks", .{ rounds, result, round.ticks });
+    }
+
+    const elapsed_ns = std.time.nanoTimestamp() - start_time;
+    const elapsed_s = @as(f64, @floatFromInt(elapsed_ns)) / std.time.ns_per_s;
+
+    printResult("mode: {s}", .{modeName(mode)});
+    printResult("rounds: {d} (left {d}, right {d}, draws {d})", .{ rounds, wins[c.TEAM_LEFT], wins[c.TEAM_RIGHT], draws });
+    printResult("score: left {d}, right {d}", .{
+        c.DE_TeamScore(match, c.TEAM_LEFT),
+        c.DE_TeamScore(match, c.TEAM_RIGHT),
+    });
+    printResult("ticks: {d} in {d:.3} s ({d:.0} ticks/s)", .{
+        ticks,
+        elapsed_s,
+        if (elapsed_s > 0) @as(f64, @floatFromInt(ticks)) / elapsed_s else 0,
+    });
+    logExplosions(match);
+    self.planner.logStats();
+}
+
+// How full the explosion pool got.  Explosions dropped at the limit change
+// how the round plays, so those get a warning.
+fn logExplosions(match: *const c.destruct_match_s) void {
+    const args = .{ match.exploPeak, match.exploCapacity, match.exploDropped };
+    const format = "explosions: at most {d} at once, pool of {d}, {d} dropped at the limit";
+    if (match.exploDropped > 0) {
+        std.log.warn(format, args);
+    } else {
+        std.log.info(format, args);
+    }
+}
+
+// Replay startup.  Re-simulates an input log headless and unthrottled, round
+// by round, and reports how each went.  If the log has world hashes, every
+// tick is checked against them.  Returns false if the log can't be read or
+// the replay stopped following it.
+pub fn JE_destructReplay(filename: [*c]const u8) bool {
+    var log: c.destruct_log_s = undefined;
+    if (!c.DE_LoadLog(&log, filename)) {
+        std.log.err("Failed to read input log {s}", .{std.mem.span(filename)});
+        return false;
+    }
+    defer c.DE_FreeLog(&log);
+
+    const backdrop = loadBackdrop();
+    defer c.SDL_FreeSurface(backdrop);
+    const screen = createScreen();
+    defer c.SDL_FreeSurface(screen);
+    const destructInternalScreen = createScreen();
+    defer c.SDL_FreeSurface(destructInternalScreen);
+    const destructPrevScreen = createScreen();
+    defer c.SDL_FreeSurface(destructPrevScreen);
+
+    var config = log.config;
+    config.headless = true;
+
+    var match: c.destruct_match_s = undefined;
+    c.DE_InitMatch(&match, &config, log.seed, screen, destructInternalScreen, destructPrevScreen);
+    defer c.DE_FreeMatch(&match);
+
+    // A rollout AI in the log has to plan the same way again
+    var planner: Planner = .{};
+    startPlanner(&planner, &match);
+    defer planner.stop();
+
+    c.DE_ResetPlayers(&match);
+    c.DE_ReplayLog(&match, &log);
+
+    var rounds: c_uint = 0;
+    const start_time = std.time.nanoTimestamp();
+
+    // Each round runs until the log starts the next one.  A round the game
+    // ended on its own must be followed by a new round (or the end of the
+    // log); anything else means the replay no longer matches the recording.
+    while (match.logTick < log.ticks) {
+        const first_tick = match.logTick;
+
+        _ = c.memcpy(match.world.VGAScreen.*.pixels, backdrop.pixels, @intCast(backdrop.h * backdrop.pitch));
+        c.DE_ResetUnits(&match);
+        c.DE_ResetLevel(&match);
+
+        var curState: c.de_state_t = undefined;
+        while (true) {
+            curState = c.DE_RunTick(&match);
+            if (match.desyncMask != 0) {
+                reportDesync(&match, rounds + 1);
+                return false;
+            }
+            if (curState != c.STATE_CONTINUE or match.logTick >= log.ticks or c.DE_LogRoundStart(&log, match.logTick)) {
+                break;
+            }
+        }
+        rounds += 1;
+
+        const finished = curState != c.STATE_CONTINUE;
+        if (finished and match.logTick < log.ticks and !c.DE_LogRoundStart(&log, match.logTick)) {
+            std.log.err("replay diverged: round {d} ended at tick {d}, but the log goes on", .{ rounds, match.logTick });
+            return false;
+        }
+
+        const left_alive = c.DE_TeamUnits(&match, c.TEAM_LEFT) > 0;
+        const right_alive = c.DE_TeamUnits(&match, c.TEAM_RIGHT) > 0;
+        const result = if (!finished) "cut short" else if (left_alive == right_alive) "draw" else if (left_alive) "left wins" else "right wins";
+        printResult("round {d} ({s}): {s} after {d} ticks", .{
+            rounds,
+            modeName(match.world.destructMode),
+            result,
+            match.logTick - first_tick,
+        });
+    }
+
+    const elapsed_ns = std.time.nanoTimestamp() - start_time;
+    const elapsed_s = @as(f64, @floatFromInt(elapsed_ns)) / std.time.ns_per_s;
+
+    printResult("score: left {d}, right {d}", .{
+        c.DE_TeamScore(&match, c.TEAM_LEFT),
+        c.DE_TeamScore(&match, c.TEAM_RIGHT),
+    });
+    printResult("ticks: {d} in {d:.3} s ({d:.0} ticks/s)", .{
+        log.ticks,
+        elapsed_s,
+        if (elapsed_s > 0) @as(f64, @floatFromInt(log.ticks)) / elapsed_s else 0,
+    });
+    logExplosions(&match);
+    if (log.hashes != null) {
+        printResult("hashes: all {d} ticks match", .{log.ticks});
+    }
+    return true;
+}
+
+fn reportDesync(match: *const c.destruct_match_s, round: c_uint) void {
+    std.log.err("replay out of sync at tick {d} (round {d}) in:", .{ match.desyncTick, round });
+    for (0..c.MAX_HASHES) |i| {
+        if (match.desyncMask & (@as(c_uint, 1) << @intCast(i)) != 0) {
+            std.log.err("  {s}", .{std.mem.sliceTo(&c.destructHashName[i], 0)});
+        }
+    }
+}
+
+// Bench startup.  Times the terrain pass, DE_FadeTerrain, under the worst load
+// it gets: everything below the HUD is somewhere in an explosion's fade, with
+// specks of dirt to anti-alias around.  The incremental pass, with its vector
+// kernel, runs against the whole-map scalar reference.  Returns false if the
+// two leave different terrain behind.
+pub fn JE_destructBench() bool {
+    const screen = createScreen();
+    defer c.SDL_FreeSurface(screen);
+    const destructInternalScreen = createScreen();
+    defer c.SDL_FreeSurface(destructInternalScreen);
+    const destructPrevScreen = createScreen();
+    defer c.SDL_FreeSurface(destructPrevScreen);
+
+    var config = loadConfig(true);
+    config.alwaysalias = true;
+
+    var match: c.destruct_match_s = undefined;
+    c.DE_InitMatch(&match, &config, 1, screen, destructInternalScreen, destructPrevScreen);
+    defer c.DE_FreeMatch(&match);
+
+    c.DE_ResetPlayers(&match);
+    c.DE_ResetLevel(&match);
+
+    // The explosions go into a snapshot, so that every run starts out from
+    // exactly the same terrain.
+    fillFadeLoad(&match);
+    const width: usize = match.terrain.width;
+    const height: usize = match.terrain.height;
+    var state: c.destruct_state_s = undefined;
+    c.DE_InitState(&state, &match);
+    defer c.DE_FreeState(&state);
+    c.DE_SaveState(&match, &state);
+
+    const passes = 15; // long enough for the brightest explosions to burn out
+    const runs = 100;
+    const bytes_per_pass: f64 = @floatFromInt((height - 12) * width);
+
+    const Kernel = struct {
+        name: []const u8,
+        reference: bool,
+        best_ns: u64 = std.math.maxInt(u64),
+        terrain: []u8 = &.{},
+        hash: u64 = 0,
+    };
+    var kernels = [_]Kernel{
+        .{ .name = "incremental", .reference = false },
+        .{ .name = "reference", .reference = true },
+    };
+    defer for (&kernels) |*kernel| {
+        std.heap.page_allocator.free(kernel.terrain);
+    };
+
+    for (&kernels) |*kernel| {
+        for (0..runs) |_| {
+            c.DE_RestoreState(&match, &state);
+
+            const start_time = std.time.nanoTimestamp();
+            for (0..passes) |_| {
+                c.DE_FadeTerrain(&match, kernel.reference);
+            }
+            const elapsed_ns: u64 = @intCast(std.time.nanoTimestamp() - start_time);
+            kernel.best_ns = @min(kernel.best_ns, elapsed_ns);
+        }
+
+        kernel.terrain = std.heap.page_allocator.alloc(u8, width * height) catch @panic("out of memory");
+        for (0..height) |y| {
+            for (0..width) |x| {
+                kernel.terrain[y * width + x] = c.DE_GetTerrainPixel(&match, @intCast(x), @intCast(y));
+            }
+        }
+        kernel.hash = match.hash[c.HASH_TERRAIN];
+
+        const pass_ns = @as(f64, @floatFromInt(kernel.best_ns)) / passes;
+        printResult("{s}: {d:.1} us per pass ({d:.0} MB/s)", .{
+            kernel.name,
+            pass_ns / std.time.ns_per_us,
+            if (pass_ns > 0) bytes_per_pass / pass_ns * std.time.ns_per_s / 1e6 else 0,
+        });
+    }
+
+    if (!std.mem.eql(u8, kernels[0].terrain, kernels[1].terrain) or kernels[0].hash != kernels[1].hash) {
+        std.log.err("the incremental and reference passes left different terrain behind", .{});
+        return false;
+    }
+    printResult("speedup: {d:.2}x", .{@as(f64, @floatFromInt(kernels[1].best_ns)) / @as(f64, @floatFromInt(kernels[0].best_ns))});
+    return true;
+}
+
+// Puts everything below the HUD somewhere in an explosion's fade, with specks
+// of dirt to anti-alias around.  The bench and the tests fade it away.
+pub fn fillFadeLoad(match: *c.destruct_match_s) void {
+    const pixel_dirt = 25;
+    const width: usize = match.terrain.width;
+    const height: usize = match.terrain.height;
+    for (12..height) |y| {
+        for (0..width) |x| {
+            const pixel: u8 = if ((x * 7 + y * 3) % 23 == 0) pixel_dirt else @intCast(241 + (x + y) % 15);
+            c.DE_PutTerrainPixel(match, @intCast(x), @intCast(y), pixel);
+        }
+    }
+}
+
+// Most ticks the simulation may fall behind before it stops trying to catch
+// up, e.g. after the pause or help screen held a tick up.
+const max_lag_ticks = 5;
+
+// Plays a round in the window until DE_RunTick says otherwise.  The world
+// ticks at the game's fixed rate (about 70 Hz) while frames go out at the
+// display's refresh rate, drawn in between ticks by DE_DrawFrame.  Neither
+// waits on the other, and the ticks come out the same at any frame rate.
+fn playWindowedRound(match: *c.destruct_match_s) c.de_state_t {
+    const frequency: f64 = @floatFromInt(c.SDL_GetPerformanceFrequency());
+    const tick_s: f64 = c.delayPeriod / 1000.0;
+    const frame_s: f64 = 1.0 / @as(f64, @floatFromInt(c.video_refresh_rate()));
+
+    var last = c.SDL_GetPerformanceCounter();
+    var lag: f64 = tick_s; // the first tick runs right away
+    while (true) {
+        while (lag >= tick_s) {
+            const curState = c.DE_RunTick(match);
+            if (curState != c.STATE_CONTINUE) {
+                return curState;
+            }
+            lag -= tick_s;
+        }
+
+        c.DE_DrawFrame(match, @floatCast(lag / tick_s));
+        c.JE_showVGA();
+
+        const elapsed_s = @as(f64, @floatFromInt(c.SDL_GetPerformanceCounter() - last)) / frequency;
+        if (elapsed_s < frame_s) {
+            c.SDL_Delay(@intFromFloat((frame_s - elapsed_s) * 1000));
+        }
+
+        const now = c.SDL_GetPerformanceCounter();
+        lag = @min(lag + @as(f64, @floatFromInt(now - last)) / frequency, max_lag_ticks * tick_s);
+        last = now;
+    }
+}
+
+// Builds the next round on a thread of its own while the main thread fades
+// the last one out.  Only the match is touched, and the backdrop read.
+fn prepareRound(match: *c.destruct_match_s, backdrop: *const c.SDL_Surface) void {
+    c.DE_ResetUnits(match);
+    c.DE_PrepareLevel(match, backdrop);
+}
+
 fn JE_destructMain(self: *Destruct) void {
+    const match = &self.match;
     var curState: c.de_state_t = c.STATE_INIT;
 
-    c.JE_loadPic(assets.game_screen.ptr, assets.game_screen.len, self.world.VGAScreen, 11, false);
-    c.JE_introScreen(self.world.VGAScreen, self.destructInternalScreen);
+    // Every round is drawn over the same picture, which only has to be
+    // decoded the once.
+    const backdrop = loadBackdrop();
+    defer c.SDL_FreeSurface(backdrop);
+
+    c.JE_loadPic(assets.game_screen.ptr, assets.game_screen.len, match.world.VGAScreen, 11, false);
+    c.JE_introScreen(match.world.VGAScreen, match.destructInternalScreen);
 
-    c.DE_ResetPlayers(&self.destruct_players);
+    c.DE_ResetPlayers(match);
 
-    self.destruct_players[c.PLAYER_LEFT].is_cpu = self.config.ai[c.PLAYER_LEFT];
-    self.destruct_players[c.PLAYER_RIGHT].is_cpu = self.config.ai[c.PLAYER_RIGHT];
+    match.destruct_player[c.PLAYER_LEFT].is_cpu = match.config.ai[c.PLAYER_LEFT];
+    match.destruct_player[c.PLAYER_RIGHT].is_cpu = match.config.ai[c.PLAYER_RIGHT];
 
     while (true) {
-        self.world.destructMode = JE_destructMenu(
-            self.world.VGAScreen,
-            self.destructInternalScreen,
-            self.destructPrevScreen,
-            &self.config,
-            &self.destruct_players,
+        match.world.destructMode = JE_destructMenu(
+            match.world.VGAScreen,
+            match.destructInternalScreen,
+            match.destructPrevScreen,
+            &match.config,
+            &match.destruct_player,
         );
-        if (self.world.destructMode == c.MODE_NONE) {
+        if (match.world.destructMode == c.MODE_NONE) {
             break; // User is quitting
         }
 
+        var prepared = false;
         while (true) {
-            c.destructFirstTime = true;
-            c.JE_loadPic(assets.game_screen.ptr, assets.game_screen.len, self.world.VGAScreen, 11, false);
-
-            c.DE_ResetUnits(&self.config, &self.destruct_players);
-            c.DE_ResetLevel(
-                &self.config,
-                &self.destruct_players,
-                self.shotRec,
-                self.exploRec,
-                &self.world,
-                self.destructInternalScreen,
-            );
+            _ = c.memcpy(match.world.VGAScreen.*.pixels, backdrop.pixels, @intCast(backdrop.h * backdrop.pitch));
+            if (!prepared) {
+                prepareRound(match, backdrop);
+            }
+            c.DE_ShowLevel(match);
 
-            while (true) {
-                curState = c.DE_RunTick(
-                    &self.config,
-                    &self.destruct_players,
-                    self.shotRec,
-                    self.exploRec,
-                    &self.world,
-                    self.destructInternalScreen,
-                    self.destructPrevScreen,
-                );
-                if (curState != c.STATE_CONTINUE) {
-                    break;
-                }
+            curState = playWindowedRound(match);
+
+            // Another round on the same settings gets made during the fade,
+            // so it's ready to go as soon as the screen is black.  Should
+            // there be no thread to make it on, it's made after the fade.
+            var preparer: ?std.Thread = null;
+            if (curState == c.STATE_RELOAD) {
+                preparer = std.Thread.spawn(.{}, prepareRound, .{ match, backdrop }) catch null;
             }
             c.fade_black(25);
+            if (preparer) |thread| {
+                thread.join();
+            }
+            prepared = preparer != null;
 
             if (curState != c.STATE_RELOAD) {
                 break;
@@ -395,7 +929,7 @@ const ControllerMenu = struct {
                 SDL.SDL_SCANCODE_F11 => {}, // reserved for toggling right player to be cpu/human
                 SDL.SDL_SCANCODE_BACKSPACE => {}, // reserved for starting new round
                 else => {
-                    for (0..c.MAX_PLAYERS) |curr_player| {
+                    for (0..c.DE_KEYBOARD_PLAYERS) |curr_player| {
                         for (0..c.MAX_KEY) |curr_key| {
                             if (destructPlayers[curr_player].keys.Config[curr_key] == c.lastkey_scan) {
                                 destructPlayers[curr_player].keys.Config[curr_key] = SDL.SDL_SCANCODE_UNKNOWN;
@@ -449,7 +983,7 @@ const ControllerMenu = struct {
         c.JE_outText(currScreen, 10, @intCast(25 + 8 * 12), "Change angle CCW", 1, 3);
         c.JE_outText(currScreen, 10, @intCast(25 + 9 * 12), "Change angle CW", 1, 3);
 
-        for (0.., 0..c.MAX_PLAYERS) |i, curr_player| {
+        for (0.., 0..c.DE_KEYBOARD_PLAYERS) |i, curr_player| {
             for (0.., KEY_ORDER) |j, curr_key| {
                 c.JE_textShade(
                     currScreen,
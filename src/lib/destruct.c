@@ -48,6 +48,7 @@
 #include "destruct.h"
 
 #include "config.h"
+#include "file.h"
 #include "fonthand.h"
 #include "helptext.h"
 #include "keyboard.h"
@@ -62,9 +63,37 @@
 #include "video.h"
 
 #include <assert.h>
+#include <limits.h>
 
 /*** Defines ***/
 #define UNIT_HEIGHT 12
+#define DE_SPRITE_WIDTH 12   /* every sprite in destructSpriteSheet fits in this */
+#define DE_SPRITE_HEIGHT 14
+#define DE_SHOT_WORDS(max_shots) (((max_shots) + 63) / 64)  /* of shotLive */
+#define DE_EXPLO_WORDS(capacity) (((capacity) + 63) / 64)  /* of exploLive */
+#define DE_RING_POINTS (49 * 49 * 2)  /* the most a ring of a map is drawn with */
+#define DE_AIM_ANGLES 24  /* angles the solver AI tries besides the one it has */
+#define DE_AIM_TRACES 6   /* of which it traces the flight of at most this many */
+#define DE_AIM_USES 35    /* ticks an aim is used for before it's checked again */
+#define DE_AIM_SOLVES 4   /* aims a player's volleys may work out each tick */
+#define DE_ROLLOUT_UNITS 3  /* units the rollout AI weighs shots for at once */
+#define DE_ROLLOUT_LEAD 20  /* ticks before it can fire that it plans a shot */
+#define DE_ROLLOUT_WORK (DE_ROLLOUT_SAMPLES * DE_ROLLOUT_TICKS)  /* rollout ticks a candidate takes */
+#define DE_ROLLOUT_STEP DE_ROLLOUT_LANES  /* a timed search's work between looks at the clock */
+
+/* The terrain pass has a vector kernel wherever the compiler can turn GNU
+ * vector types into real SIMD: SSE2 (AVX2 if enabled), NEON and SIMD128.
+ * The scalar one stays around as the reference. */
+#if defined(__SSE2__) || defined(__ARM_NEON) || defined(__wasm_simd128__)
+#define DE_VECTOR_KERNELS
+#ifdef __AVX2__
+#define DE_VECTOR_BYTES 32
+#else
+#define DE_VECTOR_BYTES 16
+#endif
+typedef Uint8  de_bytes_t __attribute__((vector_size(DE_VECTOR_BYTES)));
+typedef Uint64 de_words_t __attribute__((vector_size(DE_VECTOR_BYTES)));
+#endif
 
 /*** Enums ***/
 enum
@@ -115,109 +144,197 @@ enum de_mapflags_t
 static void JE_pauseScreen(SDL_Surface * screen, SDL_Surface * destructPrevScreen);
 
 // level generating functions
-static void JE_generateTerrain(const struct destruct_config_s * config,
-                               struct destruct_player_s * destruct_player,
-                               struct destruct_world_s * world,
-                               SDL_Surface * destructInternalScreen);
-static void DE_generateBaseTerrain(unsigned int, unsigned int *);
-static void DE_drawBaseTerrain(SDL_Surface * screen, unsigned int * baseWorld);
-static void DE_generateUnits(struct destruct_player_s * destruct_player, struct destruct_world_s * world);
-static void DE_generateWalls(const struct destruct_config_s * config,
-                             const struct destruct_player_s * destruct_player,
-                             struct destruct_world_s *);
-static void DE_generateRings(SDL_Surface *, Uint8);
-static unsigned int JE_placementPosition(unsigned int, unsigned int, unsigned int *);
+static void JE_generateTerrain(struct destruct_match_s * match, const SDL_Surface * backdrop);
+static void DE_generateBaseTerrain(struct destruct_match_s * match);
+static void DE_drawBaseTerrain(struct destruct_match_s * match);
+static void DE_generateUnits(struct destruct_match_s * match);
+static void DE_generateWalls(struct destruct_match_s * match);
+static void DE_generateRings(struct destruct_match_s * match, Uint8);
+static unsigned int DE_MapFlags(unsigned long, unsigned long, unsigned long);
+static void DE_LoadMap(struct destruct_match_s * match);
+static void DE_GenerateMap(struct destruct_map_s * map, unsigned long, unsigned int, unsigned int);
+static void DE_GenerateHeights(struct destruct_map_s * map, PhiloxStream *, unsigned int, unsigned int);
+static void DE_RasterizeRings(Uint64 *, Uint32 *, PhiloxStream *, unsigned int, unsigned int);
+static void DE_DrawPlane(struct destruct_match_s * match, const Uint64 *, Uint8);
+static bool DE_FetchMap(struct destruct_mapcache_s * cache, struct destruct_map_s * map, unsigned long, unsigned int, unsigned int);
+static void DE_StoreMap(struct destruct_mapcache_s * cache, const struct destruct_map_s * map, unsigned int, unsigned int);
+static inline enum de_stream_t DE_PlacementStream(const struct destruct_match_s * match);
+static unsigned int JE_placementPosition(struct destruct_world_s * world, unsigned int, unsigned int);
 
 // drawing functions
-static void JE_aliasDirt(SDL_Surface *);
-static void DE_RunTickDrawCrosshairs(struct destruct_player_s * destruct_player, SDL_Surface * screen);
-static void DE_RunTickDrawHUD(struct destruct_player_s * destruct_player, SDL_Surface * screen);
-static void DE_GravityDrawUnit(enum de_player_t team, struct destruct_unit_s * unit, SDL_Surface * screen);
-static void DE_RunTickAnimate(const struct destruct_config_s * config, struct destruct_player_s * destruct_player);
-static void DE_RunTickDrawWalls(const struct destruct_config_s * config, struct destruct_world_s * world);
-static void DE_DrawTrails(struct destruct_shot_s *, unsigned int, unsigned int, unsigned int, SDL_Surface * screen);
-static void JE_tempScreenChecking(const SDL_Surface * screen,
-                                  SDL_Surface * destructInternalScreen,
-                                  const struct destruct_config_s * config);
-static void JE_superPixel(const SDL_Surface * destructInternalScreen, unsigned int, unsigned int);
+static void JE_aliasDirt(struct destruct_match_s * match);
+static void DE_RunTickDrawCrosshairs(struct destruct_match_s * match, float alpha);
+static void DE_RunTickDrawHUD(struct destruct_match_s * match);
+static void DE_GravityDrawUnit(struct destruct_match_s * match, enum de_team_t team, const struct destruct_unit_s * unit);
+static void DE_RunTickAnimate(struct destruct_match_s * match);
+static void DE_RunTickDrawWalls(struct destruct_match_s * match);
+static void DE_DrawTrails(struct destruct_shot_s *, float, float, unsigned int, unsigned int, unsigned int);
+static void DE_DrawShot(struct destruct_match_s * match, unsigned int, float);
+static bool DE_DrawnRect(struct destruct_match_s * match, int, int, unsigned int, unsigned int);
+static void DE_RestoreFrame(struct destruct_match_s * match);
+static void DE_MoveView(struct destruct_match_s * match, bool);
+static void DE_SavePrevious(struct destruct_match_s * match);
+static void DE_LerpUnit(const struct destruct_unit_s *, const struct destruct_unit_s *, float, struct destruct_unit_s *);
+static void DE_FadeTerrainReference(struct destruct_match_s * match);
+static inline void DE_FadePixel(struct destruct_match_s * match, Uint8 *, unsigned int, unsigned int);
+static void DE_FadeLine(struct destruct_match_s * match, Uint8 *, unsigned int, unsigned int);
+static bool DE_ChunkFades(const Uint8 *, unsigned int);
+static void DE_AliasPending(struct destruct_match_s * match);
+static void JE_superPixel(struct destruct_match_s * match, unsigned int, unsigned int);
 static void JE_pixCool(unsigned int, unsigned int, Uint8, SDL_Surface * screen);
 
 // player functions
-static void DE_RunTickGetInput(struct destruct_player_s * destruct_player);
-static void DE_ProcessInput(const struct destruct_config_s * config,
-                            struct destruct_player_s * destruct_player,
-                            struct destruct_shot_s * shotRec,
-                            const SDL_Surface * destructInternalScreen);
-static void DE_ResetAI(const struct destruct_config_s * config,
-                       struct destruct_player_s * destruct_player,
-                       const struct destruct_world_s * world);
-static void DE_ResetActions(struct destruct_player_s * destruct_player);
-static void DE_RunTickAI(const struct destruct_config_s * config, struct destruct_player_s * destruct_player);
+static void DE_RunTickGetInput(struct destruct_match_s * match);
+static void DE_ProcessInput(struct destruct_match_s * match);
+static void DE_ResetAI(struct destruct_match_s * match);
+static void DE_ResetActions(struct destruct_match_s * match);
+static void DE_RunTickAI(struct destruct_match_s * match);
+static unsigned int DE_Opponent(const struct destruct_match_s * match, unsigned int);
+static void DE_RunTickVolleys(struct destruct_match_s * match);
+static inline bool DE_CanAim(const struct destruct_unit_s * unit);
+static int DE_FindTarget(const struct destruct_match_s * match, unsigned int, const struct destruct_unit_s * unit);
+static void DE_SolveAim(const struct destruct_match_s * match, const struct destruct_unit_s * unit, int, float, float, float, struct destruct_aim_s * aim);
+static float DE_MagnetDrift(const struct destruct_match_s * match, unsigned int);
+static const struct destruct_aim_s * DE_Aim(struct destruct_match_s * match, unsigned int, unsigned int, unsigned int *);
+static bool DE_SteerAim(struct destruct_match_s * match, unsigned int, const struct destruct_unit_s * unit, float, float);
+static bool DE_RunTickSolver(struct destruct_match_s * match, unsigned int);
+static int DE_TeamHealth(const struct destruct_match_s * match, enum de_team_t);
+static unsigned int DE_PlanCandidates(const struct destruct_match_s * match, unsigned int, struct destruct_plan_s *);
+static bool DE_PlayRollout(struct destruct_rollout_s * rollout, const struct destruct_search_s *, unsigned int, unsigned int);
+static unsigned int DE_CandidateWork(const struct destruct_search_s * search, unsigned int, unsigned long);
+static void DE_Plan(struct destruct_match_s * match, unsigned int);
+static void DE_PlayLane(struct destruct_search_s * search, unsigned int, unsigned int, unsigned long);
+static void DE_RunSlice(struct destruct_planner_s * planner, bool);
+static void DE_SliceDone(struct destruct_planner_s * planner);
+static void DE_EndSearch(struct destruct_match_s * match, unsigned int);
+static void DE_RunTickPlans(struct destruct_match_s * match);
+static bool DE_TimedSlices(const struct destruct_config_s * config);
+static unsigned int DE_PlanLead(const struct destruct_config_s * config);
+static bool DE_RunTickRollout(struct destruct_match_s * match, unsigned int);
 
 // unit functions
 static void DE_RaiseAngle(struct destruct_unit_s *);
 static void DE_LowerAngle(struct destruct_unit_s *);
 static void DE_RaisePower(struct destruct_unit_s *);
 static void DE_LowerPower(struct destruct_unit_s *);
-static void DE_CycleWeaponUp(struct destruct_unit_s *);
-static void DE_CycleWeaponDown(struct destruct_unit_s *);
-static void DE_RunMagnet(const struct destruct_config_s * config,
-                         struct destruct_player_s * destruct_player,
-                         struct destruct_shot_s * shotRec,
+static void DE_CycleWeaponUp(const struct destruct_config_s * config, struct destruct_unit_s *);
+static void DE_CycleWeaponDown(const struct destruct_config_s * config, struct destruct_unit_s *);
+static void DE_RunMagnet(struct destruct_match_s * match,
                          enum de_player_t curPlayer,
                          struct destruct_unit_s * magnet);
-static void DE_GravityFlyUnit(const SDL_Surface * destructInternalScreen, struct destruct_unit_s *);
-static void DE_GravityLowerUnit(const SDL_Surface * destructInternalScreen, struct destruct_unit_s *);
-static void DE_DestroyUnit(const struct destruct_config_s * config,
-                           struct destruct_player_s * destruct_player,
-                           struct destruct_explo_s * exploRec,
+static void DE_GravityFlyUnit(const struct destruct_match_s * match, struct destruct_unit_s *);
+static void DE_GravityLowerUnit(const struct destruct_match_s * match, struct destruct_unit_s *);
+static void DE_DestroyUnit(struct destruct_match_s * match,
                            enum de_player_t playerID,
                            struct destruct_unit_s * unit);
-static inline bool DE_isValidUnit(struct destruct_unit_s *);
+static inline bool DE_isValidUnit(const struct destruct_unit_s *);
+
+// broadphase functions
+static void DE_AllocGrid(struct destruct_grid_s * grid, unsigned int, unsigned int, unsigned int);
+static void DE_FreeGrid(struct destruct_grid_s * grid);
+static void DE_ClearGrid(struct destruct_grid_s * grid);
+static void DE_GridAdd(struct destruct_grid_s * grid, unsigned int, int, int, int, int);
+static inline unsigned int DE_GridCell(const struct destruct_grid_s * grid, int, int);
+static inline unsigned int DE_GridColumn(const struct destruct_match_s * match, float);
+static void DE_RunTickGrid(struct destruct_match_s * match);
+static void DE_PlaneRect(Uint64 *, const struct destruct_terrain_s * terrain, int, int, int, int, bool);
+static void DE_ListShots(struct destruct_match_s * match);
+static inline void DE_ListShot(struct destruct_match_s * match, unsigned int);
+
+// random number functions
+static inline unsigned long DE_Rand(struct destruct_match_s * match, enum de_stream_t);
+static inline float DE_RandLt1(struct destruct_match_s * match, enum de_stream_t);
+static void DE_RandFill(struct destruct_match_s * match, enum de_stream_t, Uint32 *, unsigned int);
+
+// shot pool functions
+static void DE_AllocMotion(struct destruct_motion_s * motion, unsigned int);
+static void DE_CopyMotion(struct destruct_motion_s * dst, const struct destruct_motion_s * src, unsigned int);
+static void DE_FreeMotion(struct destruct_motion_s * motion);
+static void DE_PoolShots(struct destruct_match_s * match);
+static int DE_AllocShot(struct destruct_match_s * match);
+static inline void DE_FreeShot(struct destruct_match_s * match, unsigned int);
+static void DE_MoveShots(struct destruct_match_s * match, const unsigned int *, unsigned int);
+static void DE_BounceShots(struct destruct_match_s * match, const unsigned int *, unsigned int);
+
+// explosion pool functions
+static unsigned int DE_ExploLimit(const struct destruct_config_s * config);
+static void DE_ResizeExplosions(struct destruct_match_s * match, unsigned int);
+static void DE_PoolExplosions(struct destruct_match_s * match);
+static int DE_AllocExplosion(struct destruct_match_s * match);
+static inline void DE_FreeExplosion(struct destruct_match_s * match, unsigned int);
+static void DE_UnlistExplosion(struct destruct_match_s * match, unsigned int);
 
 // weapon functions
-static void DE_ResetWeapons(const struct destruct_config_s * config,
-                            struct destruct_shot_s * shotRec,
-                            struct destruct_explo_s * exploRec);
-static void DE_RunTickShots(const struct destruct_config_s * config,
-                            struct destruct_player_s * destruct_player,
-                            struct destruct_shot_s * shotRec,
-                            struct destruct_explo_s * exploRec,
-                            struct destruct_world_s * world,
-                            const SDL_Surface * destructInternalScreen);
-static void DE_RunTickExplosions(const struct destruct_config_s * config,
-                                 struct destruct_player_s * destruct_player,
-                                 struct destruct_explo_s * exploRec,
-                                 const SDL_Surface * destructInternalScreen);
-static void DE_TestExplosionCollision(const struct destruct_config_s * config,
-                                      struct destruct_player_s * destruct_player,
-                                      struct destruct_explo_s * exploRec,
+static void DE_ResetWeapons(struct destruct_match_s * match);
+static void DE_RunTickShots(struct destruct_match_s * match);
+static void DE_RunTickExplosions(struct destruct_match_s * match);
+static void DE_RunTickFlares(struct destruct_match_s * match);
+static void DE_DrawFlare(struct destruct_match_s * match, enum de_expl_t, unsigned int, unsigned int);
+static void DE_TestExplosionCollision(struct destruct_match_s * match,
                                       unsigned int,
                                       unsigned int);
-static void JE_makeExplosion(const struct destruct_config_s * config,
-                             struct destruct_explo_s * exploRec,
+static void JE_makeExplosion(struct destruct_match_s * match,
                              unsigned int tempPosX,
                              unsigned int tempPosY,
                              enum de_shot_t shottype);
-static void DE_MakeShot(const struct destruct_config_s * config,
-                        struct destruct_player_s * destruct_player,
-                        struct destruct_shot_s * shotRec,
+static void DE_MakeShot(struct destruct_match_s * match,
                         enum de_player_t curPlayer,
                         const struct destruct_unit_s * curUnit,
                         int direction);
 
 // gameplay functions
-static void DE_RunTickCycleDeadUnits(const struct destruct_config_s * config, struct destruct_player_s * destruct_player);
-static void DE_RunTickGravity(const struct destruct_config_s * config,
-                              struct destruct_player_s * destruct_player,
-                              const SDL_Surface * destructInternalScreen,
-                              SDL_Surface * screen);
-static bool DE_RunTickCheckEndgame(struct destruct_player_s * destruct_player, struct destruct_world_s * world);
-static bool JE_stabilityCheck(const SDL_Surface * destructInternalScreen, unsigned int, unsigned int);
+static void DE_RunTickCycleDeadUnits(struct destruct_match_s * match);
+static void DE_RunTickGravity(struct destruct_match_s * match);
+static bool DE_RunTickCheckEndgame(struct destruct_match_s * match);
+static bool JE_stabilityCheck(const Uint64 * dirt, unsigned int, unsigned int, unsigned int);
 
 // sound
-static void DE_RunTickPlaySounds(void);
-static void JE_eSound(unsigned int);
+static void DE_RunTickPlaySounds(struct destruct_match_s * match);
+static void JE_eSound(struct destruct_match_s * match, unsigned int);
+
+// input log functions
+static void DE_ApplyLogFlags(struct destruct_match_s * match);
+static void DE_RunTickLog(struct destruct_match_s * match);
+
+// terrain functions
+static void DE_AllocTerrain(struct destruct_terrain_s * terrain, unsigned int, unsigned int);
+static void DE_FreeTerrain(struct destruct_terrain_s * terrain);
+static void DE_ClearTerrain(struct destruct_terrain_s * terrain);
+static void DE_SetBackdrop(struct destruct_terrain_s * terrain, const SDL_Surface * screen);
+static inline const Uint8 * DE_ReadChunk(const struct destruct_terrain_s * terrain, unsigned int, unsigned int);
+static inline Uint8 * DE_WriteChunk(struct destruct_terrain_s * terrain, unsigned int, unsigned int);
+static Uint8 * DE_NewChunk(struct destruct_terrain_s * terrain, unsigned int, unsigned int);
+static inline Uint8 * DE_TerrainAt(struct destruct_terrain_s * terrain, unsigned int, unsigned int);
+static void DE_CopyTerrainRow(const struct destruct_terrain_s * terrain, Uint8 *, unsigned int, unsigned int, unsigned int);
+
+// dirt plane functions
+static void DE_BuildDirt(struct destruct_match_s * match);
+static inline bool DE_IsDirt(const Uint64 * dirt, unsigned int, unsigned int, unsigned int);
+static inline void DE_SetSurface(struct destruct_match_s * match, unsigned int, unsigned int, bool);
+static inline void DE_SetOccupancy(struct destruct_match_s * match, unsigned int, unsigned int, bool);
+static inline unsigned int DE_EmptySquare(const struct destruct_match_s * match, unsigned int, unsigned int);
+static bool DE_SweepDirt(const struct destruct_match_s * match, float, float, float, float, unsigned int *, unsigned int *);
+static unsigned int DE_TraceFlight(const struct destruct_match_s * match, unsigned int, float, float, float, float, float, unsigned int, unsigned int *, unsigned int *);
+static inline void DE_SetDirt(Uint64 * dirt, size_t, Uint8);
+static inline Uint64 DE_DirtNeighbours(const Uint64 * dirt, const struct destruct_terrain_s * terrain, unsigned int, unsigned int);
+static inline void DE_MarkTile(const struct destruct_terrain_s * terrain, Uint64 * tiles, unsigned int, unsigned int);
+static inline void DE_MarkAlias(struct destruct_match_s * match, unsigned int, unsigned int);
+static void DE_FillTiles(const struct destruct_terrain_s * terrain, Uint64 * tiles);
+static void DE_MarkAllTiles(struct destruct_match_s * match);
+
+// hashing functions
+static inline Uint64 DE_HashPixel(size_t, Uint8);
+static inline void DE_SetTerrainPixel(struct destruct_match_s * match, Uint8 *, unsigned int, unsigned int, Uint8);
+static Uint64 DE_HashExplo(Uint64, const struct destruct_explo_s * explo);
+static void DE_HashTerrain(struct destruct_match_s * match);
+static void DE_RunTickHash(struct destruct_match_s * match);
+
+// snapshot functions
+static void DE_AllocState(struct destruct_state_s * state, const struct destruct_match_s * match, bool terrain);
+static void DE_SaveWorld(const struct destruct_match_s * match, struct destruct_state_s * state);
+static void DE_RestoreWorld(struct destruct_match_s * match, const struct destruct_state_s * state);
+static void DE_JournalPixel(struct destruct_history_s * history, size_t, Uint8);
+static void DE_ForgetJournaled(struct destruct_history_s * history);
 
 
 /*** Weapon configurations ***/
@@ -242,7 +359,7 @@ static const int       systemAngle[MAX_UNITS] = {true, true, true, false, false,
 static const int        baseDamage[MAX_UNITS] = {200, 120, 400, 300, 80, 150, 600, 40};
 static const int         systemAni[MAX_UNITS] = {false, false, false, true, false, false, false, true};
 
-static bool weaponSystems[MAX_UNITS][MAX_SHOT_TYPES] =
+static const bool defaultWeaponSystems[MAX_UNITS][MAX_SHOT_TYPES] =
 {
     {1, 1, 1, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, // normal
     {0, 0, 0, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0}, // nuke
@@ -259,7 +376,7 @@ static bool weaponSystems[MAX_UNITS][MAX_SHOT_TYPES] =
 static const JE_byte goodsel[14] /*[1..14]*/ = {1, 2, 6, 12, 13, 14, 17, 23, 24, 26, 28, 29, 32, 33};
 
 /* Unit creation.  Need to move this later: Doesn't belong here */
-JE_byte basetypes[10][11] /*[1..8, 1..11]*/ = /* [0] is amount of units*/
+static const JE_byte defaultBasetypes[10][11] /*[1..8, 1..11]*/ = /* [0] is amount of units*/
 {
     {5, UNIT_TANK, UNIT_TANK, UNIT_NUKE, UNIT_DIRT,      UNIT_DIRT,   UNIT_SATELLITE, UNIT_MAGNET, UNIT_LASER,  UNIT_JUMPER, UNIT_HELI},   /*Normal*/
     {1, UNIT_TANK, UNIT_TANK, UNIT_TANK, UNIT_TANK,      UNIT_TANK,   UNIT_TANK,      UNIT_TANK,   UNIT_TANK,   UNIT_TANK,   UNIT_TANK},   /*Traditional*/
@@ -273,25 +390,25 @@ JE_byte basetypes[10][11] /*[1..8, 1..11]*/ = /* [0] is amount of units*/
     {5, UNIT_TANK, UNIT_TANK, UNIT_NUKE, UNIT_DIRT,      UNIT_DIRT,   UNIT_SATELLITE, UNIT_MAGNET, UNIT_LASER,  UNIT_JUMPER, UNIT_HELI},   /*Right custom*/
 };
 
-static const unsigned int baseLookup[MAX_PLAYERS][MAX_MODES] =
+static const unsigned int baseLookup[MAX_TEAMS][MAX_MODES] =
 {
     {0, 1, 3, 4, 6, 8},
     {0, 1, 2, 5, 7, 9}
 };
 
-static const JE_byte GraphicBase[MAX_PLAYERS][MAX_UNITS] =
+static const JE_byte GraphicBase[MAX_TEAMS][MAX_UNITS] =
 {
     {  1,   6,  11,  58,  63,  68,  96, 153},
     { 20,  25,  30,  77,  82,  87, 115, 172}
 };
 
-static const JE_byte ModeScore[MAX_PLAYERS][MAX_MODES] =
+static const JE_byte ModeScore[MAX_TEAMS][MAX_MODES] =
 {
     {1, 0, 0, 5, 0, 1},
     {1, 0, 5, 0, 1, 1}
 };
 
-static SDL_Scancode defaultKeyConfig[MAX_PLAYERS][MAX_KEY] =
+static const SDL_Scancode defaultKeyConfig[DE_KEYBOARD_PLAYERS][MAX_KEY] =
 {
     {
         SDL_SCANCODE_F,         // LEFT
@@ -345,12 +462,6 @@ static const char *const unit_names[] =
     "heli",
 };
 
-/*** Globals ***/
-JE_boolean destructFirstTime;
-
-/* Sound Effects Queue */
-JE_byte soundQueue[8]; /* [0..7] */
-
 static enum de_unit_t get_unit_by_name(const char *unit_name)
 {
     for (enum de_unit_t unit = UNIT_FIRST; unit < MAX_UNITS; ++unit)
@@ -364,6 +475,40 @@ static enum de_unit_t get_unit_by_name(const char *unit_name)
     return UNIT_NONE;
 }
 
+/* DE_ResetConfig
+ *
+ * Fills in the settings a match uses when there is no config file to
+ * read them from.  load_destruct_config starts from these too.
+ */
+void DE_ResetConfig(struct destruct_config_s * config)
+{
+    config->max_shots = 40;
+    config->min_walls = 20;
+    config->max_walls = 20;
+    config->max_explosions = 40;
+    config->explosion_limit = 1024;
+    config->max_installations = 10;
+    config->players = 2;
+    config->battle_units = 0;
+    config->world_width = vga_width;
+    config->world_height = vga_height;
+    config->allow_custom = false;
+    config->alwaysalias = false;
+    config->jumper_straight[0] = true;
+    config->jumper_straight[1] = false;
+    config->ai[0] = true;
+    config->ai[1] = false;
+    config->ai_level = AI_ORIGINAL;
+    config->ai_budget = DE_ROLLOUT_BUDGET;
+    config->ai_time = DE_ROLLOUT_TIME;
+    config->headless = false;
+    config->rules = RULES_CURRENT;
+
+    memcpy(config->weaponSystems, defaultWeaponSystems, sizeof(config->weaponSystems));
+    memcpy(config->basetypes, defaultBasetypes, sizeof(config->basetypes));
+    memcpy(config->keys, defaultKeyConfig, sizeof(config->keys));
+}
+
 void load_destruct_config(Config *config_, struct destruct_config_s * config)
 {
     ConfigSection *section;
@@ -374,21 +519,29 @@ void load_destruct_config(Config *config_, struct destruct_config_s * config)
 
     config->alwaysalias = config_get_or_set_bool_option(section, "antialias craters", true, NO_YES);
 
-    weaponSystems[UNIT_LASER][SHOT_LASERTRACER] = config_get_or_set_bool_option(section, "tracer laser", false, OFF_ON);
+    config->weaponSystems[UNIT_LASER][SHOT_LASERTRACER] = config_get_or_set_bool_option(section, "tracer laser", false, OFF_ON);
 
     config->max_shots = config_get_or_set_int_option(section, "max shots", 40);
     config->max_explosions = config_get_or_set_int_option(section, "max explosions", 40);
+    config->explosion_limit = config_get_or_set_int_option(section, "explosion limit", 1024);
     config->min_walls = config_get_or_set_int_option(section, "min walls", 20);
     config->max_walls = config_get_or_set_int_option(section, "max walls", 20);
+    config->players = config_get_or_set_int_option(section, "players", 2);
+    config->battle_units = config_get_or_set_int_option(section, "battle units", 0);
+    config->world_width = config_get_or_set_int_option(section, "world width", vga_width);
+    config->world_height = config_get_or_set_int_option(section, "world height", vga_height);
 
     config->ai[0] = config_get_or_set_bool_option(section, "left ai", true, NO_YES);
     config->jumper_straight[0] = config_get_or_set_bool_option(section, "left jumper fires straight", false, NO_YES);
     config->ai[1] = config_get_or_set_bool_option(section, "right ai", false, NO_YES);
     config->jumper_straight[1] = config_get_or_set_bool_option(section, "right jumper fires straight", false, NO_YES);
+    config->ai_level = config_get_or_set_int_option(section, "ai level", AI_ORIGINAL);
+    config->ai_budget = config_get_or_set_int_option(section, "ai budget", DE_ROLLOUT_BUDGET);
+    config->ai_time = config_get_or_set_int_option(section, "ai time", DE_ROLLOUT_TIME);
 
     // keyboard controls
 
-    for (int p = 0; p < MAX_PLAYERS; ++p)
+    for (int p = 0; p < DE_KEYBOARD_PLAYERS; ++p)
     {
         section = config_find_section(config_, "destruct keyboard", player_names[p]);
         if (section == NULL)
@@ -413,7 +566,7 @@ void load_destruct_config(Config *config_, struct destruct_config_s * config)
                 SDL_Scancode key = SDL_GetScancodeFromName(value);
                 if (key != SDL_SCANCODE_UNKNOWN && i < 1)
                 {
-                    defaultKeyConfig[p][k] = key;
+                    config->keys[p].Config[k] = key;
                 }
                 else  // invalid or excess
                 {
@@ -427,7 +580,7 @@ void load_destruct_config(Config *config_, struct destruct_config_s * config)
                 // unset remaining defaults
                 for (unsigned int i = config_get_value_count(option); i < 1; ++i)
                 {
-                    defaultKeyConfig[p][k] = SDL_SCANCODE_UNKNOWN;
+                    config->keys[p].Config[k] = SDL_SCANCODE_UNKNOWN;
                 }
             }
             else
@@ -435,9 +588,9 @@ void load_destruct_config(Config *config_, struct destruct_config_s * config)
                 // set defaults
                 for (unsigned int i = 0; i < 1; ++i)
                 {
-                    if (defaultKeyConfig[p][k] != SDL_SCANCODE_UNKNOWN)
+                    if (config->keys[p].Config[k] != SDL_SCANCODE_UNKNOWN)
                     {
-                        config_add_value(option, SDL_GetScancodeName(defaultKeyConfig[p][k]));
+                        config_add_value(option, SDL_GetScancodeName(config->keys[p].Config[k]));
                     }
                 }
             }
@@ -455,10 +608,10 @@ void load_destruct_config(Config *config_, struct destruct_config_s * config)
 
     char buffer[15 + 1];
 
-    for (int p = 0; p < MAX_PLAYERS; ++p)
+    for (int p = 0; p < MAX_TEAMS; ++p)
     {
         snprintf(buffer, sizeof(buffer), "%s num units", player_names[p]);
-        basetypes[8 + p][0] = config_get_or_set_int_option(section, buffer, basetypes[8 + p][0]);
+        config->basetypes[8 + p][0] = config_get_or_set_int_option(section, buffer, config->basetypes[8 + p][0]);
 
         ConfigOption *option;
 
@@ -469,9 +622,9 @@ void load_destruct_config(Config *config_, struct destruct_config_s * config)
         foreach_option_i_value(i, value, option)
         {
             enum de_unit_t unit = get_unit_by_name(value);
-            if (unit != UNIT_NONE && 1 + i < COUNTOF(basetypes[8 + p]))
+            if (unit != UNIT_NONE && 1 + i < COUNTOF(config->basetypes[8 + p]))
             {
-                basetypes[8 + p][1 + i] = unit;
+                config->basetypes[8 + p][1 + i] = unit;
             }
             else  // invalid or excess
             {
@@ -483,17 +636,17 @@ void load_destruct_config(Config *config_, struct destruct_config_s * config)
         if (config_get_value_count(option) > 0)
         {
             // set remaining units to tank
-            for (unsigned int i = config_get_value_count(option); 1 + i < COUNTOF(basetypes[8 + p]); ++i)
+            for (unsigned int i = config_get_value_count(option); 1 + i < COUNTOF(config->basetypes[8 + p]); ++i)
             {
-                basetypes[8 + p][1 + i] = UNIT_TANK;
+                config->basetypes[8 + p][1 + i] = UNIT_TANK;
                 config_add_value(option, unit_names[UNIT_TANK]);
             }
         }
         else
         {
             // set defaults
-            for (unsigned int i = 0; 1 + i < COUNTOF(basetypes[8 + p]); ++i)
-                config_add_value(option, unit_names[basetypes[8 + p][1 + i]]);
+            for (unsigned int i = 0; 1 + i < COUNTOF(config->basetypes[8 + p]); ++i)
+                config_add_value(option, unit_names[config->basetypes[8 + p][1 + i]]);
         }
     }
 }
@@ -519,10 +672,7 @@ void JE_introScreen(SDL_Surface * screen, SDL_Surface * destructInternalScreen)
     JE_showVGA();
 }
 
-static void JE_generateTerrain(const struct destruct_config_s * config,
-                               struct destruct_player_s * destruct_player,
-                               struct destruct_world_s * world,
-                               SDL_Surface * destructInternalScreen)
+static void JE_generateTerrain(struct destruct_match_s * match, const SDL_Surface * backdrop)
 {
     /* The unique modifiers:
         Altered generation (really tall)
@@ -533,48 +683,65 @@ static void JE_generateTerrain(const struct destruct_config_s * config,
         Rings of not dirt (holes)
         Walls
     */
+    const struct destruct_config_s * config = &match->config;
+    struct destruct_world_s * world = &match->world;
+    unsigned long walls, holes, shape;
 
-    world->mapFlags = MAP_NORMAL;
+    DE_SetBackdrop(&match->terrain, backdrop);
+    DE_ClearTerrain(&match->terrain);
 
-    if (mt_rand() % 2 == 0)
-        world->mapFlags |= MAP_WALLS;
-    if (mt_rand() % 4 == 0)
-        world->mapFlags |= MAP_HOLES;
-    switch (mt_rand() % 4)
+    if (config->rules >= RULES_MAP_SEEDS)
     {
-    case 0:
-        world->mapFlags |= MAP_FUZZY;
-        break;
-
-    case 1:
-        world->mapFlags |= MAP_TALL;
-        break;
-
-    case 2:
-        world->mapFlags |= MAP_RINGS;
-        break;
+        DE_LoadMap(match);
+        world->mapFlags = match->map.mapFlags;
+        world->song = match->map.song;
+    }
+    else
+    {
+        walls = DE_Rand(match, STREAM_LEVEL);
+        holes = DE_Rand(match, STREAM_LEVEL);
+        shape = DE_Rand(match, STREAM_LEVEL);
+        world->mapFlags = DE_MapFlags(walls, holes, shape);
+        /* The song is always picked so that a headless match draws the
+         * same random numbers as a windowed one. */
+        world->song = goodsel[DE_Rand(match, STREAM_LEVEL) % 14] - 1;
     }
 
-    play_song(goodsel[mt_rand() % 14] - 1);
+    if (config->rules < RULES_MAP_SEEDS)
+        DE_generateBaseTerrain(match);
+    DE_generateUnits(match);
+    DE_generateWalls(match);
+    DE_drawBaseTerrain(match);
 
-    DE_generateBaseTerrain(world->mapFlags, world->baseMap);
-    DE_generateUnits(destruct_player, world);
-    DE_generateWalls(config, destruct_player, world);
-    DE_drawBaseTerrain(world->VGAScreen, world->baseMap);
+    if (config->rules >= RULES_MAP_SEEDS)
+    {
+        DE_DrawPlane(match, match->map.rings, PIXEL_DIRT);
+        DE_DrawPlane(match, match->map.holes, PIXEL_BLACK);
+    }
+    else
+    {
+        if (world->mapFlags & MAP_RINGS)
+            DE_generateRings(match, PIXEL_DIRT);
+        if (world->mapFlags & MAP_HOLES)
+            DE_generateRings(match, PIXEL_BLACK);
+    }
 
-    if (world->mapFlags & MAP_RINGS)
-        DE_generateRings(world->VGAScreen, PIXEL_DIRT);
-    if (world->mapFlags & MAP_HOLES)
-        DE_generateRings(world->VGAScreen, PIXEL_BLACK);
+    /* Aliasing only ever paints black pixels, so the dirt is final by now */
+    DE_BuildDirt(match);
+    JE_aliasDirt(match);
 
-    JE_aliasDirt(world->VGAScreen);
-    JE_showVGA();
+    DE_HashTerrain(match);
+    DE_MarkAllTiles(match);
+    if (match->history != NULL)
+        DE_ClearHistory(match->history);  /* there's no undoing a new map */
 
-    memcpy(destructInternalScreen->pixels, world->VGAScreen->pixels, destructInternalScreen->pitch * destructInternalScreen->h);
+    match->viewShot = -1;
 }
 
-static void DE_generateBaseTerrain(unsigned int mapFlags, unsigned int * baseWorld)
+static void DE_generateBaseTerrain(struct destruct_match_s * match)
 {
+    const unsigned int mapFlags = match->world.mapFlags;
+    unsigned int * baseWorld = match->world.baseMap;
     unsigned int i;
     unsigned int HeightMul;
     float sinewave, sinewave2, cosinewave, cosinewave2;
@@ -584,25 +751,26 @@ static void DE_generateBaseTerrain(unsigned int mapFlags, unsigned int * baseWor
      * brown pixels are what we check for collisions with. */
 
     /* The ranges here are between .01 and roughly 0.07283...*/
-    sinewave    = mt_rand_lt1() * M_PI / 50 + 0.01f;
-    sinewave2   = mt_rand_lt1() * M_PI / 50 + 0.01f;
-    cosinewave  = mt_rand_lt1() * M_PI / 50 + 0.01f;
-    cosinewave2 = mt_rand_lt1() * M_PI / 50 + 0.01f;
+    sinewave    = DE_RandLt1(match, STREAM_LEVEL) * M_PI / 50 + 0.01f;
+    sinewave2   = DE_RandLt1(match, STREAM_LEVEL) * M_PI / 50 + 0.01f;
+    cosinewave  = DE_RandLt1(match, STREAM_LEVEL) * M_PI / 50 + 0.01f;
+    cosinewave2 = DE_RandLt1(match, STREAM_LEVEL) * M_PI / 50 + 0.01f;
     HeightMul = 20;
 
     /* This block just exists to mix things up. */
     if (mapFlags & MAP_FUZZY)
     {
-        sinewave  = M_PI - mt_rand_lt1() * 0.3f;
-        sinewave2 = M_PI - mt_rand_lt1() * 0.3f;
+        sinewave  = M_PI - DE_RandLt1(match, STREAM_LEVEL) * 0.3f;
+        sinewave2 = M_PI - DE_RandLt1(match, STREAM_LEVEL) * 0.3f;
     }
     if (mapFlags & MAP_TALL)
     {
         HeightMul = 100;
     }
 
-    /* Now compute a height for each of our lines. */
-    for (i = 1; i <= 318; i++)
+    /* Now compute a height for each of our lines.  On a map taller than the
+     * screen the hills keep to the bottom of it, with sky above. */
+    for (i = 1; i <= match->world.width - 2; i++)
     {
         newheight = roundf(sinf(sinewave   * i) * HeightMul + sinf(sinewave2   * i) * 15 +
                            cosf(cosinewave * i) * 10        + sinf(cosinewave2 * i) * 15) + 130;
@@ -616,50 +784,65 @@ static void DE_generateBaseTerrain(unsigned int mapFlags, unsigned int * baseWor
         {
             newheight = 195;
         }
-        baseWorld[i] = (unsigned int) newheight;
+        baseWorld[i] = (unsigned int) newheight + (match->world.height - vga_height);
     }
     /* The base world has been created. */
 }
 
-static void DE_drawBaseTerrain(SDL_Surface * screen, unsigned int * baseWorld)
+static void DE_drawBaseTerrain(struct destruct_match_s * match)
 {
-    unsigned int i;
+    const struct destruct_world_s * world = &match->world;
+    unsigned int x, y;
 
-    for (i = 1; i <= 318; i++)
+    for (x = 1; x <= world->width - 2; x++)
     {
-        JE_rectangle(screen, i, baseWorld[i], i, 199, PIXEL_DIRT);
+        for (y = world->baseMap[x]; y < world->height; y++)
+            *DE_TerrainAt(&match->terrain, x, y) = PIXEL_DIRT;
     }
 }
 
-static void DE_generateUnits(struct destruct_player_s * destruct_player, struct destruct_world_s * world)
+static void DE_generateUnits(struct destruct_match_s * match)
 {
+    const struct destruct_config_s * config = &match->config;
+    const enum de_stream_t stream = DE_PlacementStream(match);
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    struct destruct_world_s * world = &match->world;
     unsigned int i, j, numSatellites;
+    unsigned int team, fleet, units, stripStart, stripWidth;
 
-    for (i = 0; i < MAX_PLAYERS; i++)
+    for (i = 0; i < config->players; i++)
     {
         numSatellites = 0;
         destruct_player[i].unitsRemaining = 0;
 
-        for (j = 0; j < basetypes[baseLookup[i][world->destructMode]][0]; j++)
+        /* A team's side, 120 columns of a screen-wide map, is split evenly
+         * between its players */
+        team = destruct_player[i].team;
+        fleet = baseLookup[team][world->destructMode];
+        units = (config->battle_units > 0) ? config->battle_units : config->basetypes[fleet][0];
+        stripWidth = (world->width * 3 / 8) / ((config->players + MAX_TEAMS - 1 - team) / MAX_TEAMS);
+        stripStart = (i / MAX_TEAMS) * stripWidth;
+
+        for (j = 0; j < units; j++)
         {
             /* Not everything is the same between players */
-            if (i == PLAYER_LEFT)
+            if (team == TEAM_LEFT)
             {
-                destruct_player[i].unit[j].unitX = (mt_rand() % 120) + 10;
+                destruct_player[i].unit[j].unitX = stripStart + (DE_Rand(match, stream) % stripWidth) + 10;
             }
             else
             {
-                destruct_player[i].unit[j].unitX = vga_width - ((mt_rand() % 120) + 22);
+                destruct_player[i].unit[j].unitX = world->width - (stripStart + (DE_Rand(match, stream) % stripWidth) + 22);
             }
 
-            destruct_player[i].unit[j].unitY = JE_placementPosition(destruct_player[i].unit[j].unitX - 1, 14, world->baseMap);
-            destruct_player[i].unit[j].unitType = basetypes[baseLookup[i][world->destructMode]][(mt_rand() % 10) + 1];
+            destruct_player[i].unit[j].unitY = JE_placementPosition(world, destruct_player[i].unit[j].unitX - 1, 14);
+            destruct_player[i].unit[j].unitType = config->basetypes[fleet][(DE_Rand(match, stream) % 10) + 1];
 
             /* Sats are special cases since they are useless.  They don't count
              * as active units and we can't have a team of all sats */
             if (destruct_player[i].unit[j].unitType == UNIT_SATELLITE)
             {
-                if (numSatellites == basetypes[baseLookup[i][world->destructMode]][0])
+                if (numSatellites == units)
                 {
                     destruct_player[i].unit[j].unitType = UNIT_TANK;
                     destruct_player[i].unitsRemaining++;
@@ -672,7 +855,7 @@ static void DE_generateUnits(struct destruct_player_s * destruct_player, struct
                      * and there is a clearing underneath it.  This CAN
                      * be fixed but won't be for classic.
                      */
-                    destruct_player[i].unit[j].unitY = 30 + (mt_rand() % 40);
+                    destruct_player[i].unit[j].unitY = 30 + (DE_Rand(match, stream) % 40) + (world->height - vga_height);
                     numSatellites++;
                 }
             }
@@ -690,14 +873,17 @@ static void DE_generateUnits(struct destruct_player_s * destruct_player, struct
             destruct_player[i].unit[j].shotType = defaultWeapon[destruct_player[i].unit[j].unitType];
             destruct_player[i].unit[j].health = baseDamage[destruct_player[i].unit[j].unitType];
             destruct_player[i].unit[j].ani_frame = 0;
+            destruct_player[i].unit[j].shotDelay = 0;
         }
     }
 }
 
-static void DE_generateWalls(const struct destruct_config_s * config,
-                             const struct destruct_player_s * destruct_player,
-                             struct destruct_world_s * gameWorld)
+static void DE_generateWalls(struct destruct_match_s * match)
 {
+    const struct destruct_config_s * config = &match->config;
+    const enum de_stream_t stream = DE_PlacementStream(match);
+    const struct destruct_player_s * destruct_player = match->destruct_player;
+    struct destruct_world_s * gameWorld = &match->world;
     unsigned int i, j, wallX;
     unsigned int wallHeight, remainWalls;
     unsigned int tries;
@@ -713,12 +899,16 @@ static void DE_generateWalls(const struct destruct_config_s * config,
         return;
     }
 
-    remainWalls = (rand() % (config->max_walls - config->min_walls + 1)) + config->min_walls;
+    /* Only roll when there's a choice, so the default config draws exactly
+     * the numbers it always has. */
+    remainWalls = config->min_walls;
+    if (config->max_walls > config->min_walls)
+        remainWalls += DE_Rand(match, stream) % (config->max_walls - config->min_walls + 1);
 
     do
     {
         /* Create a wall.  Decide how tall the wall will be */
-        wallHeight = (mt_rand() % 5) + 1;
+        wallHeight = (DE_Rand(match, stream) % 5) + 1;
         if (wallHeight > remainWalls)
         {
             wallHeight = remainWalls;
@@ -729,7 +919,7 @@ static void DE_generateWalls(const struct destruct_config_s * config,
         do
         {
             isGood = true;
-            wallX = (mt_rand() % 300) + 10;
+            wallX = (DE_Rand(match, stream) % (gameWorld->width - 20)) + 10;
 
             /* Is this X already occupied?  In the original Tyrian we only
              * checked to make sure four units on each side were unobscured.
@@ -738,7 +928,7 @@ static void DE_generateWalls(const struct destruct_config_s * config,
              * After that we'll cover up what may; having a few units
              * stuck behind walls makes things mildly interesting.
              */
-            for (i = 0; i < MAX_PLAYERS; i++)
+            for (i = 0; i < config->players; i++)
             {
                 for (j = 0; j < config->max_installations; j++)
                 {
@@ -761,7 +951,7 @@ label_outer_break:
         {
             gameWorld->mapWalls[remainWalls - i].wallExist = true;
             gameWorld->mapWalls[remainWalls - i].wallX = wallX;
-            gameWorld->mapWalls[remainWalls - i].wallY = JE_placementPosition(wallX, 12, gameWorld->baseMap) - 14 * i;
+            gameWorld->mapWalls[remainWalls - i].wallY = JE_placementPosition(gameWorld, wallX, 12) - 14 * i;
         }
 
         remainWalls -= wallHeight;
@@ -769,45 +959,433 @@ label_outer_break:
     } while (remainWalls != 0);
 }
 
-static void DE_generateRings(SDL_Surface * screen, Uint8 pixel)
+static void DE_generateRings(struct destruct_match_s * match, Uint8 pixel)
 {
+    const int width = match->world.width, height = match->world.height;
     unsigned int i, j, tempSize, rings;
     int tempPosX1, tempPosY1, tempPosX2, tempPosY2;
     float tempRadian;
 
-    rings = mt_rand() % 6 + 1;
+    /* As many again for every screen's worth of map */
+    rings = DE_Rand(match, STREAM_LEVEL) % 6 + 1;
+    rings *= MAX(width * height / (vga_width * vga_height), 1);
     for (i = 1; i <= rings; i++)
     {
-        tempPosX1 = (mt_rand() % vga_width);
-        tempPosY1 = (mt_rand() % (vga_height - 40)) + 20;
-        tempSize = (mt_rand() % 40) + 10;  /*Size*/
+        tempPosX1 = (DE_Rand(match, STREAM_LEVEL) % width);
+        tempPosY1 = (DE_Rand(match, STREAM_LEVEL) % (height - 40)) + 20;
+        tempSize = (DE_Rand(match, STREAM_LEVEL) % 40) + 10;  /*Size*/
 
         for (j = 1; j <= tempSize * tempSize * 2; j++)
         {
-            tempRadian = mt_rand_lt1() * (2 * M_PI);
-            tempPosY2 = tempPosY1 + roundf(cosf(tempRadian) * (mt_rand_lt1() * 0.1f + 0.9f) * tempSize);
-            tempPosX2 = tempPosX1 + roundf(sinf(tempRadian) * (mt_rand_lt1() * 0.1f + 0.9f) * tempSize);
-            if ((tempPosY2 > 12) && (tempPosY2 < vga_height) && (tempPosX2 > 0) && (tempPosX2 < vga_width - 1))
+            tempRadian = DE_RandLt1(match, STREAM_LEVEL) * (2 * M_PI);
+            tempPosY2 = tempPosY1 + roundf(cosf(tempRadian) * (DE_RandLt1(match, STREAM_LEVEL) * 0.1f + 0.9f) * tempSize);
+            tempPosX2 = tempPosX1 + roundf(sinf(tempRadian) * (DE_RandLt1(match, STREAM_LEVEL) * 0.1f + 0.9f) * tempSize);
+            if ((tempPosY2 > 12) && (tempPosY2 < height) && (tempPosX2 > 0) && (tempPosX2 < width - 1))
             {
-                ((Uint8 *)screen->pixels)[tempPosX2 + tempPosY2 * screen->pitch] = pixel;
+                *DE_TerrainAt(&match->terrain, tempPosX2, tempPosY2) = pixel;
             }
         }
     }
 }
 
-static unsigned int aliasDirtPixel(const SDL_Surface * screen, unsigned int x, unsigned int y, const Uint8 * s)
+static unsigned int DE_MapFlags(unsigned long walls, unsigned long holes, unsigned long shape)
+{
+    /* Three numbers, one for each of the map's rolls */
+    unsigned int mapFlags = MAP_NORMAL;
+
+    if (walls % 2 == 0)
+        mapFlags |= MAP_WALLS;
+    if (holes % 4 == 0)
+        mapFlags |= MAP_HOLES;
+    switch (shape % 4)
+    {
+    case 0:
+        mapFlags |= MAP_FUZZY;
+        break;
+
+    case 1:
+        mapFlags |= MAP_TALL;
+        break;
+
+    case 2:
+        mapFlags |= MAP_RINGS;
+        break;
+    }
+    return mapFlags;
+}
+
+/* Where the units and walls are placed from: since RULES_MAP_SEEDS a stream
+ * of their own, started from the round's map seed. */
+static inline enum de_stream_t DE_PlacementStream(const struct destruct_match_s * match)
+{
+    return (match->config.rules >= RULES_MAP_SEEDS) ? STREAM_PLACEMENT : STREAM_LEVEL;
+}
+
+/* DE_LoadMap
+ *
+ * Since RULES_MAP_SEEDS the level stream only draws each round's map seed.
+ * The map comes out of the cache if it has been made before, and is made
+ * (and kept) otherwise.  The units and walls go on it from a stream of the
+ * same seed, so a round is all down to its seed and the mode.
+ */
+static void DE_LoadMap(struct destruct_match_s * match)
+{
+    const unsigned int width = match->world.width, height = match->world.height;
+    struct destruct_mapcache_s * cache = match->mapCache;
+    const unsigned long seed = DE_Rand(match, STREAM_LEVEL);
+
+    if (cache == NULL || DE_FetchMap(cache, &match->map, seed, width, height) == false)
+    {
+        DE_GenerateMap(&match->map, seed, width, height);
+        if (cache != NULL)
+            DE_StoreMap(cache, &match->map, width, height);
+    }
+    memcpy(match->world.baseMap, match->map.heights, sizeof(*match->world.baseMap) * width);
+    philox_init(&match->stream[STREAM_PLACEMENT], seed, STREAM_PLACEMENT);
+}
+
+/* sinf, near enough for making maps, in a form that a loop over many angles
+ * vectorizes: no calls and no branches.  The angle is folded into
+ * [-pi/2, pi/2], where the series to x^9 is good to 4e-6. */
+static inline float DE_Sine(float x)
+{
+    float t, t2;
+
+    t = x * (float)(1 / (2 * M_PI));
+    t -= (int)(t + (t >= 0 ? 0.5f : -0.5f));
+    t = (t > 0.25f) ? 0.5f - t : (t < -0.25f) ? -0.5f - t : t;
+    x = t * (float)(2 * M_PI);
+    t2 = x * x;
+    return x * (1 + t2 * (-1.0f / 6 + t2 * (1.0f / 120 + t2 * (-1.0f / 5040 + t2 * (1.0f / 362880)))));
+}
+
+/* roundf, the same way */
+static inline int DE_Round(float x)
+{
+    return (int)(x + (x >= 0 ? 0.5f : -0.5f));
+}
+
+/* DE_GenerateMap
+ *
+ * Makes the map for seed on a width by height world.  It rolls the same
+ * things JE_generateTerrain always has, in the same order, but out of a
+ * stream of its own and with whole columns and rings worked out at a time.
+ */
+static void DE_GenerateMap(struct destruct_map_s * map, unsigned long seed, unsigned int width, unsigned int height)
+{
+    PhiloxStream stream;
+    unsigned long walls, holes, shape;
+
+    philox_init(&stream, seed, STREAM_LEVEL);
+    walls = philox_rand(&stream);
+    holes = philox_rand(&stream);
+    shape = philox_rand(&stream);
+    map->seed = seed;
+    map->mapFlags = DE_MapFlags(walls, holes, shape);
+    map->song = goodsel[philox_rand(&stream) % 14] - 1;
+
+    DE_GenerateHeights(map, &stream, width, height);
+
+    memset(map->rings, 0, sizeof(*map->rings) * (width * height / 64 + 1));
+    memset(map->holes, 0, sizeof(*map->holes) * (width * height / 64 + 1));
+    if (map->mapFlags & MAP_RINGS)
+        DE_RasterizeRings(map->rings, map->draws, &stream, width, height);
+    if (map->mapFlags & MAP_HOLES)
+        DE_RasterizeRings(map->holes, map->draws, &stream, width, height);
+}
+
+/* The same hills as DE_generateBaseTerrain, every column in one loop. */
+static void DE_GenerateHeights(struct destruct_map_s * map, PhiloxStream * stream, unsigned int width, unsigned int height)
+{
+    const int ground = height - vga_height, right = width - 2;
+    unsigned int * restrict heights = map->heights;
+    float sinewave, sinewave2, cosinewave, cosinewave2;
+    float heightMul, newheight;
+    int i;
+
+    sinewave    = philox_rand_lt1(stream) * M_PI / 50 + 0.01f;
+    sinewave2   = philox_rand_lt1(stream) * M_PI / 50 + 0.01f;
+    cosinewave  = philox_rand_lt1(stream) * M_PI / 50 + 0.01f;
+    cosinewave2 = philox_rand_lt1(stream) * M_PI / 50 + 0.01f;
+    heightMul = 20;
+
+    if (map->mapFlags & MAP_FUZZY)
+    {
+        sinewave  = M_PI - philox_rand_lt1(stream) * 0.3f;
+        sinewave2 = M_PI - philox_rand_lt1(stream) * 0.3f;
+    }
+    if (map->mapFlags & MAP_TALL)
+    {
+        heightMul = 100;
+    }
+
+    heights[0] = heights[width - 1] = 0;
+    for (i = 1; i <= right; i++)
+    {
+        newheight = DE_Sine(sinewave    * i) * heightMul + DE_Sine(sinewave2   * i) * 15 +
+                    DE_Sine(cosinewave  * i + (float)M_PI_2) * 10 + DE_Sine(cosinewave2 * i) * 15 + 130;
+        newheight = MIN(MAX(newheight, 40.0f), 195.0f);
+        heights[i] = DE_Round(newheight) + ground;
+    }
+}
+
+/* The rings (or holes) of a map, set in plane: as many of them, with as
+ * many points each, as DE_generateRings draws.  A ring's random numbers are
+ * drawn at once, and its points worked out from them in one loop. */
+static void DE_RasterizeRings(Uint64 * plane, Uint32 * draws, PhiloxStream * stream, unsigned int width, unsigned int height)
+{
+    Uint32 * restrict points = draws + 3 * DE_RING_POINTS;
+    unsigned int i, rings, size, count;
+    int j, centerX, centerY, x, y;
+    float angle, scale;
+
+    rings = philox_rand(stream) % 6 + 1;
+    rings *= MAX(width * height / (vga_width * vga_height), 1u);
+    for (i = 0; i < rings; i++)
+    {
+        centerX = philox_rand(stream) % width;
+        centerY = philox_rand(stream) % (height - 40) + 20;
+        size = philox_rand(stream) % 40 + 10;
+        count = size * size * 2;
+
+        philox_fill(stream, draws, 3 * count);
+        scale = size * (0.1f / 16777216);
+        for (j = 0; j < (int)count; j++)
+        {
+            angle = (int)(draws[3 * j] >> 8) * (float)(2 * M_PI / 16777216);
+            y = centerY + DE_Round(DE_Sine(angle + (float)M_PI_2) * ((int)(draws[3 * j + 1] >> 8) * scale + 0.9f * size));
+            x = centerX + DE_Round(DE_Sine(angle) * ((int)(draws[3 * j + 2] >> 8) * scale + 0.9f * size));
+            points[j] = (y > 12 && y < (int)height && x > 0 && x < (int)width - 1) ? y * width + x : UINT32_MAX;
+        }
+        for (j = 0; j < (int)count; j++)
+        {
+            if (points[j] != UINT32_MAX)
+                plane[points[j] / 64] |= 1ULL << (points[j] % 64);
+        }
+    }
+}
+
+/* Draws pixel into the terrain wherever plane, laid out like the dirt
+ * plane, has a bit set. */
+static void DE_DrawPlane(struct destruct_match_s * match, const Uint64 * plane, Uint8 pixel)
+{
+    struct destruct_terrain_s * terrain = &match->terrain;
+    unsigned int y, tx;
+    Uint8 * line;
+    Uint64 bits;
+
+    for (y = 0; y < terrain->height; y++)
+    {
+        for (tx = 0; tx < terrain->columns; tx++)
+        {
+            bits = plane[(size_t)y * terrain->columns + tx];
+            if (bits == 0)
+                continue;
+
+            line = DE_WriteChunk(terrain, tx, y / DE_TILE_HEIGHT) + (y % DE_TILE_HEIGHT) * DE_TILE_WIDTH;
+            for (; bits != 0; bits &= bits - 1)
+                line[__builtin_ctzll(bits)] = pixel;
+        }
+    }
+}
+
+/* DE_InitMapCache
+ *
+ * Starts a cache of up to capacity maps, for any matches on this thread to
+ * share through their mapCache.  A tournament plays every mode from the
+ * same seeds, so its rounds come back to the same maps.
+ */
+void DE_InitMapCache(struct destruct_mapcache_s * cache, unsigned int capacity)
+{
+    cache->capacity = MAX(capacity, 1u);
+    cache->count = 0;
+    cache->next = 0;
+    cache->hits = cache->misses = 0;
+    cache->entries = calloc(cache->capacity, sizeof(*cache->entries));
+    if (cache->entries == NULL)
+        exit(EXIT_FAILURE);  // out of memory
+}
+
+void DE_FreeMapCache(struct destruct_mapcache_s * cache)
+{
+    unsigned int i;
+
+    for (i = 0; i < cache->count; i++)
+        free(cache->entries[i].data);
+    free(cache->entries);
+    cache->entries = NULL;
+    cache->capacity = cache->count = cache->next = 0;
+}
+
+/* A map is packed as varints: the flags, the song, each column's height
+ * less the last's (zigzagged), then the rings' and the holes' planes as
+ * lengths of runs of clear and set bits in turn. */
+struct destruct_packer_s
+{
+    Uint8 * data;
+    size_t size, capacity;
+};
+
+static void DE_PackVarint(struct destruct_packer_s * packer, size_t value)
+{
+    Uint8 * data;
+
+    if (packer->size + 10 > packer->capacity)
+    {
+        packer->capacity = MAX(2 * packer->capacity, (size_t)4096);
+        data = realloc(packer->data, packer->capacity);
+        if (data == NULL)
+            exit(EXIT_FAILURE);  // out of memory
+        packer->data = data;
+    }
+    for (; value >= 0x80; value >>= 7)
+        packer->data[packer->size++] = (Uint8)value | 0x80;
+    packer->data[packer->size++] = (Uint8)value;
+}
+
+static const Uint8 * DE_UnpackVarint(const Uint8 * data, size_t * value)
+{
+    unsigned int shift = 0;
+
+    *value = 0;
+    do
+    {
+        *value |= (size_t)(*data & 0x7f) << shift;
+        shift += 7;
+    } while (*data++ & 0x80);
+    return data;
+}
+
+/* Where the run of bits equal to set that starts at at ends */
+static size_t DE_RunEnd(const Uint64 * plane, size_t at, size_t bits, bool set)
+{
+    Uint64 differ;
+
+    while (at < bits)
+    {
+        differ = (set ? ~plane[at / 64] : plane[at / 64]) & (~0ULL << (at % 64));
+        if (differ != 0)
+            return MIN(at / 64 * 64 + __builtin_ctzll(differ), bits);
+        at = at / 64 * 64 + 64;
+    }
+    return bits;
+}
+
+static void DE_PackPlane(struct destruct_packer_s * packer, const Uint64 * plane, size_t bits)
+{
+    size_t at, end;
+    bool set = false;
+
+    for (at = 0; at < bits; at = end, set = !set)
+    {
+        end = DE_RunEnd(plane, at, bits, set);
+        DE_PackVarint(packer, end - at);
+    }
+}
+
+static const Uint8 * DE_UnpackPlane(const Uint8 * data, Uint64 * plane, size_t bits)
+{
+    size_t at, run, i;
+    bool set = false;
+
+    memset(plane, 0, sizeof(*plane) * (bits / 64 + 1));
+    for (at = 0; at < bits; at += run, set = !set)
+    {
+        data = DE_UnpackVarint(data, &run);
+        if (set == true)
+        {
+            for (i = at; i < at + run; i++)
+                plane[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+    return data;
+}
+
+static bool DE_FetchMap(struct destruct_mapcache_s * cache, struct destruct_map_s * map, unsigned long seed, unsigned int width, unsigned int height)
+{
+    const struct destruct_mapentry_s * entry;
+    const Uint8 * data;
+    unsigned int i;
+    size_t value;
+    int last = 0;
+
+    for (i = 0; i < cache->count; i++)
+    {
+        entry = &cache->entries[i];
+        if (entry->seed == seed && entry->width == width && entry->height == height)
+            break;
+    }
+    if (i == cache->count)
+    {
+        cache->misses++;
+        return false;
+    }
+    cache->hits++;
+
+    data = DE_UnpackVarint(entry->data, &value);
+    map->seed = seed;
+    map->mapFlags = value;
+    data = DE_UnpackVarint(data, &value);
+    map->song = value;
+    for (i = 0; i < width; i++)
+    {
+        data = DE_UnpackVarint(data, &value);
+        last += (value & 1) ? -(int)(value >> 1) - 1 : (int)(value >> 1);
+        map->heights[i] = last;
+    }
+    data = DE_UnpackPlane(data, map->rings, (size_t)width * height);
+    DE_UnpackPlane(data, map->holes, (size_t)width * height);
+    return true;
+}
+
+static void DE_StoreMap(struct destruct_mapcache_s * cache, const struct destruct_map_s * map, unsigned int width, unsigned int height)
+{
+    struct destruct_mapentry_s * entry = &cache->entries[cache->next];
+    struct destruct_packer_s packer = {0};
+    unsigned int i;
+    int delta, last = 0;
+
+    DE_PackVarint(&packer, map->mapFlags);
+    DE_PackVarint(&packer, map->song);
+    for (i = 0; i < width; i++)
+    {
+        delta = (int)map->heights[i] - last;
+        last = map->heights[i];
+        DE_PackVarint(&packer, (delta < 0) ? 2 * (size_t)(-delta - 1) + 1 : 2 * (size_t)delta);
+    }
+    DE_PackPlane(&packer, map->rings, (size_t)width * height);
+    DE_PackPlane(&packer, map->holes, (size_t)width * height);
+
+    /* The oldest entry makes way once the cache is full */
+    if (cache->next < cache->count)
+        free(entry->data);
+    else
+        cache->count++;
+    cache->next = (cache->next + 1) % cache->capacity;
+
+    entry->seed = map->seed;
+    entry->width = width;
+    entry->height = height;
+    entry->size = packer.size;
+    entry->data = realloc(packer.data, packer.size);
+    if (entry->data == NULL)
+        exit(EXIT_FAILURE);  // out of memory
+}
+
+static unsigned int aliasDirtPixel(const Uint64 * dirt, const struct destruct_terrain_s * terrain, unsigned int x, unsigned int y)
 {
     //A helper function used when aliasing dirt.  That's a messy process;
     //let's contain the mess here.
+    const unsigned int width = terrain->width;
     unsigned int newColor = PIXEL_BLACK;
 
-    if ((y > 0) && (*(s - screen->pitch) == PIXEL_DIRT)) // look up
+    if ((y > 0) && DE_IsDirt(dirt, width, x, y - 1)) // look up
         newColor += 1;
-    if ((y < screen->h - 1u) && (*(s + screen->pitch) == PIXEL_DIRT)) // look down
+    if ((y < terrain->height - 1) && DE_IsDirt(dirt, width, x, y + 1)) // look down
         newColor += 3;
-    if ((x > 0) && (*(s - 1) == PIXEL_DIRT)) // look left
+    if ((x > 0) && DE_IsDirt(dirt, width, x - 1, y)) // look left
         newColor += 2;
-    if ((x < screen->pitch - 1u) && (*(s + 1) == PIXEL_DIRT)) // look right
+    if ((x < width - 1) && DE_IsDirt(dirt, width, x + 1, y)) // look right
         newColor += 2;
     if (newColor != PIXEL_BLACK)
         return newColor + 16; // 16 must be the start of the brown pixels.
@@ -815,32 +1393,39 @@ static unsigned int aliasDirtPixel(const SDL_Surface * screen, unsigned int x, u
     return PIXEL_BLACK;
 }
 
-static void JE_aliasDirt(SDL_Surface * screen)
+static void JE_aliasDirt(struct destruct_match_s * match)
 {
-    /* This complicated looking function goes through the whole screen
-     * looking for brown pixels which just happen to be next to non-brown
-     * pixels.  It's an aliaser, just like it says. */
-    unsigned int x, y;
-
-    /* This is a pointer to a screen.  If you don't like pointer arithmetic,
-     * you won't like this function. */
-    Uint8 *s = screen->pixels;
-    s += 12 * screen->pitch;
-
-    for (y = 12; y < (unsigned int)screen->h; y++)
+    /* This function goes through the whole map looking for black pixels
+     * which just happen to be next to brown ones.  It's an aliaser, just
+     * like it says.  The dirt plane has the brown pixels' neighbours a word
+     * at a time, so only those get looked at. */
+    struct destruct_terrain_s * terrain = &match->terrain;
+    const Uint64 * dirt = match->dirt;
+    Uint64 bits;
+    unsigned int x, y, color;
+
+    for (y = 12; y < terrain->height; y++)
     {
-        for (x = 0; x < (unsigned int)screen->pitch; x++)
+        for (x = 0; x < terrain->width; x += 64)
         {
-            if (*s == PIXEL_BLACK)
-                *s = aliasDirtPixel(screen, x, y, s);
+            for (bits = DE_DirtNeighbours(dirt, terrain, x, y); bits != 0; bits &= bits - 1)
+            {
+                const unsigned int i = __builtin_ctzll(bits);
 
-            s++;
+                if (DE_ReadChunk(terrain, x / DE_TILE_WIDTH, y / DE_TILE_HEIGHT)[(y % DE_TILE_HEIGHT) * DE_TILE_WIDTH + i] != PIXEL_BLACK)
+                    continue;
+
+                color = aliasDirtPixel(dirt, terrain, x + i, y);
+                if (color != PIXEL_BLACK)
+                    *DE_TerrainAt(terrain, x + i, y) = color;
+            }
         }
     }
 }
 
-static unsigned int JE_placementPosition(unsigned int passed_x, unsigned int width, unsigned int * world)
+static unsigned int JE_placementPosition(struct destruct_world_s * gameWorld, unsigned int passed_x, unsigned int width)
 {
+    unsigned int * world = gameWorld->baseMap;
     unsigned int i, new_y;
 
     /* This is the function responsible for carving out chunks of land.
@@ -851,13 +1436,13 @@ static unsigned int JE_placementPosition(unsigned int passed_x, unsigned int wid
      * I wondered if it might be better to not carve out land at all.
      * On testing I determined that was distracting and added nothing. */
     new_y = 0;
-    for (i = passed_x; i <= passed_x + width - 1 && i <= 318; i++)
+    for (i = passed_x; i <= passed_x + width - 1 && i <= gameWorld->width - 2; i++)
     {
         if (new_y < world[i])
             new_y = world[i];
     }
 
-    for (i = passed_x; i <= passed_x + width - 1 && i <= 318; i++)
+    for (i = passed_x; i <= passed_x + width - 1 && i <= gameWorld->width - 2; i++)
     {
         world[i] = new_y;
     }
@@ -865,84 +1450,244 @@ static unsigned int JE_placementPosition(unsigned int passed_x, unsigned int wid
     return new_y;
 }
 
-static bool JE_stabilityCheck(const SDL_Surface * destructInternalScreen, unsigned int x, unsigned int y)
+static bool JE_stabilityCheck(const Uint64 * dirt, unsigned int width, unsigned int x, unsigned int y)
 {
-    unsigned int i, numDirtPixels;
-    Uint8 * s;
+    /* Check the 12 pixels on the bottom border of our object, from one left
+     * of x.  Like the pixels they may run on into the next row. */
+    const size_t index = x + (size_t)y * width - 1;
+    const unsigned int shift = index % 64;
+    Uint64 bits;
+
+    bits = dirt[index / 64] >> shift;
+    if (shift > 64 - 12)
+        bits |= dirt[index / 64 + 1] << (64 - shift);
+
+    /* If there are fewer than 10 brown pixels we don't consider it a solid base */
+    return (__builtin_popcountll(bits & 0xfff) < 10);
+}
 
-    numDirtPixels = 0;
-    s = destructInternalScreen->pixels;
-    s += x + (y * destructInternalScreen->pitch) - 1;
+/* DE_FadeTerrain
+ *
+ * The terrain's part of a tick: explosions fade out a colour at a time and,
+ * if the config says so, black pixels next to dirt get anti-aliased.  Only
+ * tiles with something fading and pixels whose aliasing may be out of date
+ * get looked at.  reference has it go over every pixel below the HUD one at
+ * a time instead, the way JE_tempScreenChecking used to; both leave exactly
+ * the same terrain behind.
+ */
+void DE_FadeTerrain(struct destruct_match_s * match, bool reference)
+{
+    struct destruct_terrain_s * terrain = &match->terrain;
+    Uint8 * chunk;
+    Uint64 bits;
+    unsigned int w, tile, tx, ty, y, first;
+
+    if (reference == true)
+    {
+        DE_FadeTerrainReference(match);
+        return;
+    }
 
-    /* Check the 12 pixels on the bottom border of our object */
-    for (i = 0; i < 12; i++)
+    /* Whatever is still fading afterwards marks its tile busy again.  That
+     * can only be the tile being faded, whose bit is already taken. */
+    for (w = 0; w < DE_TILE_WORDS(terrain); w++)
     {
-        if (*s == PIXEL_DIRT)
-            numDirtPixels++;
+        bits = match->busyTiles[w];
+        match->busyTiles[w] = 0;
+        for (; bits != 0; bits &= bits - 1)
+        {
+            tile = w * 64 + __builtin_ctzll(bits);
+            tx = tile % terrain->columns;
+            ty = tile / terrain->columns;
+            if (ty < 12 / DE_TILE_HEIGHT)
+                continue;
+
+            /* A new map marks every tile, but the backdrop hardly fades */
+            first = MAX(12u, ty * DE_TILE_HEIGHT);
+            if (terrain->chunk[tile] == NULL && DE_ChunkFades(DE_ReadChunk(terrain, tx, ty), first % DE_TILE_HEIGHT) == false)
+                continue;
 
-        s++;
+            chunk = DE_WriteChunk(terrain, tx, ty);
+            for (y = first; y < (ty + 1) * DE_TILE_HEIGHT; y++)
+                DE_FadeLine(match, chunk + (y % DE_TILE_HEIGHT) * DE_TILE_WIDTH, tx * DE_TILE_WIDTH, y);
+        }
     }
 
-    /* If there are fewer than 10 brown pixels we don't consider it a solid base */
-    return (numDirtPixels < 10);
+    /* Fading may have left black pixels next to dirt, so this goes last */
+    DE_AliasPending(match);
 }
 
-static void JE_tempScreenChecking(const SDL_Surface * screen,
-                                  SDL_Surface * destructInternalScreen,
-                                  const struct destruct_config_s * config) /* and copy to vgascreen */
+static void DE_FadeTerrainReference(struct destruct_match_s * match)
 {
-    Uint8 *s = screen->pixels;
-    s += 12 * screen->pitch;
+    const bool alias = match->config.alwaysalias;
+    struct destruct_terrain_s * terrain = &match->terrain;
+    Uint8 * s;
+    unsigned int x, y;
 
-    Uint8 *temps = destructInternalScreen->pixels;
-    temps += 12 * destructInternalScreen->pitch;
+    /* Everything gets looked at anyway, and given a chunk to do it in */
+    memset(match->busyTiles, 0, sizeof(*match->busyTiles) * DE_TILE_WORDS(terrain));
+    memset(match->aliasPending, 0, sizeof(*match->aliasPending) * DE_PLANE_WORDS(terrain));
+    memset(match->aliasTiles, 0, sizeof(*match->aliasTiles) * DE_TILE_WORDS(terrain));
 
-    for (int y = 12; y < screen->h; y++)
+    for (y = 12; y < terrain->height; y++)
     {
-        for (int x = 0; x < screen->pitch; x++)
+        for (x = 0; x < terrain->width; x++)
         {
-            // This block is what fades out explosions. The palette from 241
-            // to 255 fades from a very dark red to a very bright yellow.
-            if (*temps >= 241)
-            {
-                if (*temps == 241)
-                    *temps = PIXEL_BLACK;
-                else
-                    (*temps)--;
-            }
+            s = DE_TerrainAt(terrain, x, y);
+            DE_FadePixel(match, s, x, y);
 
             // This block is for aliasing dirt.  Computers are fast these days,
             // and it's fun.
-            if (config->alwaysalias == true && *temps == PIXEL_BLACK) 
-            {
-                *temps = aliasDirtPixel(screen, x, y, temps);
-            }
+            if (alias == true && *s == PIXEL_BLACK)
+                DE_SetTerrainPixel(match, s, x, y, aliasDirtPixel(match->dirt, terrain, x, y));
+        }
+    }
+}
+
+static inline void DE_FadePixel(struct destruct_match_s * match, Uint8 * s, unsigned int x, unsigned int y)
+{
+    // This block is what fades out explosions. The palette from 241
+    // to 255 fades from a very dark red to a very bright yellow.
+    if (*s >= 241)
+    {
+        if (*s == 241)
+            DE_SetTerrainPixel(match, s, x, y, PIXEL_BLACK);
+        else
+            DE_SetTerrainPixel(match, s, x, y, *s - 1);
+    }
+}
+
+/* Whether any of a chunk's pixels from line on are fading */
+static bool DE_ChunkFades(const Uint8 * chunk, unsigned int line)
+{
+    unsigned int i;
+
+    for (i = line * DE_TILE_WIDTH; i < DE_CHUNK_SIZE; i++)
+    {
+        if (chunk[i] >= 241)
+            return true;
+    }
+    return false;
+}
+
+#ifndef DE_VECTOR_KERNELS
+/* Fades the 64 pixels from temps, which are the map's from (x, y) on.  Only
+ * pixels from 241 up fade, so eight at a time can be skipped when none of
+ * them is even 128. */
+static void DE_FadeLine(struct destruct_match_s * match, Uint8 * temps, unsigned int x, unsigned int y)
+{
+    Uint64 bright;
+    unsigned int i, end;
+
+    for (end = x + DE_TILE_WIDTH; x < end; x += 8, temps += 8)
+    {
+        memcpy(&bright, temps, sizeof(bright));
+        if ((bright & 0x8080808080808080ULL) == 0)
+            continue;
+
+        for (i = 0; i < 8; i++)
+            DE_FadePixel(match, &temps[i], x + i, y);
+    }
+}
+#else
+/* The same, DE_VECTOR_BYTES pixels at a time: a compare finds the fading
+ * pixels and a masked decrement fades them. */
+static void DE_FadeLine(struct destruct_match_s * match, Uint8 * temps, unsigned int x, unsigned int y)
+{
+    de_bytes_t v, fading, faded;
+    Uint64 any;
+    unsigned int i, j;
+
+    for (j = 0; j < DE_TILE_WIDTH; j += DE_VECTOR_BYTES)
+    {
+        memcpy(&v, temps + j, sizeof(v));
+
+        fading = (de_bytes_t)(v >= 241);
+        any = 0;
+        for (i = 0; i < DE_VECTOR_BYTES / 8; i++)
+            any |= ((de_words_t)fading)[i];
+        if (any == 0)
+            continue;
+
+        faded = (v - (fading & 1)) & ~(de_bytes_t)(v == 241);
+        for (i = 0; i < DE_VECTOR_BYTES; i++)
+        {
+            if (fading[i] != 0)
+                DE_SetTerrainPixel(match, &temps[j + i], x + j + i, y, faded[i]);
+        }
+    }
+}
+#endif
 
-            /* This is copying from our temp screen to VGAScreen */
-            *s = *temps;
+/* DE_AliasPending
+ *
+ * Anti-aliases the pending pixels that turn out to be black and next to
+ * dirt.  A pixel's alias colour only depends on the dirt around it, and only
+ * black pixels get one, so these are the only pixels whose aliasing can be
+ * out of date: DE_SetTerrainPixel marks every pixel that turns black and
+ * every neighbour of dirt that comes or goes.  The work is proportional to
+ * the outline of whatever changed.  Without alwaysalias the marks are just
+ * cleared.
+ */
+static void DE_AliasPending(struct destruct_match_s * match)
+{
+    const bool alias = match->config.alwaysalias;
+    const Uint64 * dirt = match->dirt;
+    struct destruct_terrain_s * terrain = &match->terrain;
+    Uint64 bits, tiles;
+    size_t word;
+    unsigned int w, tile, tx, ty, x, y, i, color;
+
+    /* A tile's line is one word of the bit planes */
+    for (w = 0; w < DE_TILE_WORDS(terrain); w++)
+    {
+        for (tiles = match->aliasTiles[w]; tiles != 0; tiles &= tiles - 1)
+        {
+            tile = w * 64 + __builtin_ctzll(tiles);
+            tx = tile % terrain->columns;
+            ty = tile / terrain->columns;
+            x = tx * DE_TILE_WIDTH;
+
+            for (y = ty * DE_TILE_HEIGHT; y < (ty + 1) * DE_TILE_HEIGHT; y++)
+            {
+                word = (size_t)y * terrain->columns + tx;
+                bits = match->aliasPending[word];
+                match->aliasPending[word] = 0;
+                if (alias == false || y < 12)
+                    continue;  /* the HUD is left alone */
 
-            s++;
-            temps++;
+                for (bits &= DE_DirtNeighbours(dirt, terrain, x, y); bits != 0; bits &= bits - 1)
+                {
+                    i = __builtin_ctzll(bits);
+                    if (DE_ReadChunk(terrain, tx, ty)[(y % DE_TILE_HEIGHT) * DE_TILE_WIDTH + i] != PIXEL_BLACK)
+                        continue;
+
+                    /* Most stay black, and those needn't get a chunk */
+                    color = aliasDirtPixel(dirt, terrain, x + i, y);
+                    if (color != PIXEL_BLACK)
+                        DE_SetTerrainPixel(match, DE_TerrainAt(terrain, x + i, y), x + i, y, color);
+                }
+            }
         }
+        match->aliasTiles[w] = 0;
     }
 }
 
-static void JE_makeExplosion(const struct destruct_config_s * config,
-                             struct destruct_explo_s * exploRec,
+static void JE_makeExplosion(struct destruct_match_s * match,
                              unsigned int tempPosX,
                              unsigned int tempPosY,
                              enum de_shot_t shottype)
 {
-    unsigned int i, tempExploSize;
+    struct destruct_explo_s * exploRec;
+    unsigned int tempExploSize;
+    int i;
 
     /* First find an open explosion. If we can't find one, return.*/
-    for (i = 0; i < config->max_explosions; i++)
-        if (exploRec[i].isAvailable == true)
-            break;
-    if (i == config->max_explosions) /* No empty slots */
+    i = DE_AllocExplosion(match);
+    if (i < 0) /* No empty slots */
         return;
 
-    exploRec[i].isAvailable = false;
+    exploRec = match->exploRec; /* the pool may have grown */
     exploRec[i].x = tempPosX;
     exploRec[i].y = tempPosY;
     exploRec[i].explowidth = 2;
@@ -951,17 +1696,17 @@ static void JE_makeExplosion(const struct destruct_config_s * config,
     {
         tempExploSize = exploSize[shottype];
         if (tempExploSize < 5)
-            JE_eSound(3);
+            JE_eSound(match, 3);
         else if (tempExploSize < 15)
-            JE_eSound(4);
+            JE_eSound(match, 4);
         else if (tempExploSize < 20)
-            JE_eSound(12);
+            JE_eSound(match, 12);
         else if (tempExploSize < 40)
-            JE_eSound(11);
+            JE_eSound(match, 11);
         else
         {
-            JE_eSound(12);
-            JE_eSound(11);
+            JE_eSound(match, 12);
+            JE_eSound(match, 11);
         }
 
         exploRec[i].explomax  = tempExploSize;
@@ -970,25 +1715,24 @@ static void JE_makeExplosion(const struct destruct_config_s * config,
     }
     else
     {
-        JE_eSound(4);
-        exploRec[i].explomax  = (mt_rand() % 40) + 10;
-        exploRec[i].explofill = (mt_rand() % 60) + 20;
+        JE_eSound(match, 4);
+        exploRec[i].explomax  = (DE_Rand(match, STREAM_EXPLOSIONS) % 40) + 10;
+        exploRec[i].explofill = (DE_Rand(match, STREAM_EXPLOSIONS) % 60) + 20;
         exploRec[i].exploType = EXPL_NORMAL;
     }
 }
 
-static void JE_eSound(unsigned int sound)
+static void JE_eSound(struct destruct_match_s * match, unsigned int sound)
 {
-    static int exploSoundChannel = 0;
-
-    if (++exploSoundChannel > 5)
-        exploSoundChannel = 1;
+    if (++match->exploSoundChannel > 5)
+        match->exploSoundChannel = 1;
 
-    soundQueue[exploSoundChannel] = sound;
+    match->soundQueue[match->exploSoundChannel] = sound;
 }
 
-static void JE_superPixel(const SDL_Surface * destructInternalScreen, unsigned int tempPosX, unsigned int tempPosY)
+static void JE_superPixel(struct destruct_match_s * match, unsigned int tempPosX, unsigned int tempPosY)
 {
+    struct destruct_terrain_s * terrain = &match->terrain;
     const unsigned int starPattern[5][5] =
     {
         {   0,   0, 246,   0,   0 },
@@ -1006,44 +1750,36 @@ static void JE_superPixel(const SDL_Surface * destructInternalScreen, unsigned i
         {   0,   0,   1,   0,   0 }
     };
 
-    int x, y, maxX, maxY;
-    unsigned int rowLen;
+    int x, y, maxX, maxY, posX, posY;
     Uint8 *s;
 
-    maxX = destructInternalScreen->pitch;
-    maxY = destructInternalScreen->h;
+    maxX = terrain->width;
+    maxY = terrain->height;
 
-    rowLen = destructInternalScreen->pitch;
-    s = destructInternalScreen->pixels;
-    s += (rowLen * (tempPosY - 2)) + (tempPosX - 2);
-
-    for (y = 0; y < 5; y++, s += rowLen - 5)
+    for (y = 0; y < 5; y++)
     {
-        if ((signed)tempPosY + y - 2 < 0 ||    /* would be out of bounds */
-            (signed)tempPosY + y - 2 >= maxY)
-        {
+        posY = (signed)tempPosY + y - 2;
+        if (posY < 0 || posY >= maxY)  /* would be out of bounds */
             continue;
-        }
 
-        for (x = 0; x < 5; x++, s++)
+        for (x = 0; x < 5; x++)
         {
-            if ((signed)tempPosX + x - 2 < 0 ||
-                (signed)tempPosX + x - 2 >= maxX)
-            {
+            posX = (signed)tempPosX + x - 2;
+            if (posX < 0 || posX >= maxX)
                 continue;
-            }
 
             if (starPattern[y][x] == 0)
                 continue;  /* this is just to speed it up */
 
             /* at this point *s is our pixel.  Our constant arrays tell us what
              * to do with it. */
+            s = DE_TerrainAt(terrain, posX, posY);
             if (*s < starPattern[y][x])
-                *s = starPattern[y][x];
+                DE_SetTerrainPixel(match, s, posX, posY, starPattern[y][x]);
             else if (*s + starIntensity[y][x] > 255)
-                *s = 255;
+                DE_SetTerrainPixel(match, s, posX, posY, 255);
             else
-                *s += starIntensity[y][x];
+                DE_SetTerrainPixel(match, s, posX, posY, *s + starIntensity[y][x]);
         }
     }
 }
@@ -1070,15 +1806,235 @@ static void JE_pauseScreen(SDL_Surface * screen, SDL_Surface * destructPrevScree
     set_volume(tyrMusicVolume, fxVolume);
 }
 
-/* DE_ResetX
+/* DE_InitMatch
  *
- * The reset functions clear the state of whatever they are assigned to.
+ * Sets up a match to be played with the given config.  The match keeps
+ * its own copy of the config and its own random number generator, so
+ * matches with the same config and seed play out exactly the same.
+ * Pass a NULL screen to have VGAScreen set up later, as long as it's set
+ * before the first call to DE_ResetLevel.
  */
-void DE_ResetUnits(const struct destruct_config_s * config, struct destruct_player_s * destruct_player)
+void DE_InitMatch(struct destruct_match_s * match,
+                  const struct destruct_config_s * config,
+                  unsigned long seed,
+                  SDL_Surface * screen,
+                  SDL_Surface * destructInternalScreen,
+                  SDL_Surface * destructPrevScreen)
 {
-    unsigned int p, u;
+    unsigned int i;
+
+    memset(match, 0, sizeof(*match));
+    match->config = *config;
 
-    for (p = 0; p < MAX_PLAYERS; ++p)
+    /* Malloc enough structures to cover all of this session's possible needs.
+     * In a massive battle every unit fires on its own, so each gets a shot. */
+    match->config.players = MIN(MAX(match->config.players, 2u), (unsigned int)MAX_PLAYERS);
+    match->config.ai_level = MIN((unsigned int)match->config.ai_level, (unsigned int)MAX_AI - 1);
+    for (i = 0; i < COUNTOF(match->config.basetypes); i++)
+    {
+        match->config.max_installations = MAX(match->config.max_installations, match->config.basetypes[i][0]);
+    }
+    match->config.battle_units = MIN(match->config.battle_units, (unsigned int)DE_MAX_BATTLE_UNITS);
+    match->config.max_installations = MAX(match->config.max_installations, match->config.battle_units);
+    match->config.max_shots = MAX(match->config.max_shots, match->config.players * match->config.battle_units);
+
+    /* The map is a whole number of tiles, and no smaller than the screen */
+    match->config.world_width = MIN(MAX(match->config.world_width, (unsigned int)vga_width), DE_MAX_WORLD_WIDTH);
+    match->config.world_width = (match->config.world_width + DE_TILE_WIDTH - 1) / DE_TILE_WIDTH * DE_TILE_WIDTH;
+    match->config.world_height = MIN(MAX(match->config.world_height, (unsigned int)vga_height), DE_MAX_WORLD_HEIGHT);
+    match->config.world_height = (match->config.world_height + DE_TILE_HEIGHT - 1) / DE_TILE_HEIGHT * DE_TILE_HEIGHT;
+
+    /* calloc, not malloc: wall placement looks at every unit slot, even the
+     * ones this map never filled in, so they had better not be garbage. */
+    match->shotRec = calloc(match->config.max_shots, sizeof(*match->shotRec));
+    DE_AllocMotion(&match->shotMotion, match->config.max_shots);
+    match->world.mapWalls = calloc(match->config.max_walls, sizeof(*match->world.mapWalls));
+    for (i = 0; i < match->config.players; i++)
+    {
+        match->destruct_player[i].unit = calloc(match->config.max_installations, sizeof(*match->destruct_player[i].unit));
+        if (match->destruct_player[i].unit == NULL)
+            exit(EXIT_FAILURE);  // out of memory
+    }
+    if (match->shotRec == NULL || match->world.mapWalls == NULL)
+        exit(EXIT_FAILURE);  // out of memory
+
+    match->world.width = match->config.world_width;
+    match->world.height = match->config.world_height;
+    match->world.baseMap = calloc(match->world.width, sizeof(*match->world.baseMap));
+    DE_AllocTerrain(&match->terrain, match->world.width, match->world.height);
+    match->dirt = calloc(DE_PLANE_WORDS(&match->terrain), sizeof(*match->dirt));
+    match->surface = calloc(match->world.width, sizeof(*match->surface));
+    match->dirtBlocks = calloc(DE_BLOCK_WORDS(&match->terrain), sizeof(*match->dirtBlocks));
+    match->dirtRegions = calloc(DE_REGION_WORDS(&match->terrain), sizeof(*match->dirtRegions));
+    match->aliasPending = calloc(DE_PLANE_WORDS(&match->terrain), sizeof(*match->aliasPending));
+    match->unitPlane = calloc(DE_PLANE_WORDS(&match->terrain), sizeof(*match->unitPlane));
+    match->busyTiles = calloc(DE_TILE_WORDS(&match->terrain), sizeof(*match->busyTiles));
+    match->aliasTiles = calloc(DE_TILE_WORDS(&match->terrain), sizeof(*match->aliasTiles));
+    match->frameTiles = calloc(DE_TILE_WORDS(&match->terrain), sizeof(*match->frameTiles));
+    if (match->world.baseMap == NULL || match->dirt == NULL || match->surface == NULL || match->dirtBlocks == NULL || match->dirtRegions == NULL ||
+        match->aliasPending == NULL || match->unitPlane == NULL || match->busyTiles == NULL || match->aliasTiles == NULL || match->frameTiles == NULL)
+        exit(EXIT_FAILURE);  // out of memory
+
+    /* A map is made in these before it goes on the terrain; mapCache is the
+     * caller's to set, after this. */
+    match->map.heights = calloc(match->world.width, sizeof(*match->map.heights));
+    match->map.rings = calloc(DE_PLANE_WORDS(&match->terrain), sizeof(*match->map.rings));
+    match->map.holes = calloc(DE_PLANE_WORDS(&match->terrain), sizeof(*match->map.holes));
+    match->map.draws = malloc(4 * DE_RING_POINTS * sizeof(*match->map.draws));
+    if (match->map.heights == NULL || match->map.rings == NULL || match->map.holes == NULL || match->map.draws == NULL)
+        exit(EXIT_FAILURE);  // out of memory
+    match->mapCache = NULL;
+
+    DE_ResizeExplosions(match, match->config.max_explosions);
+
+    DE_AllocGrid(&match->unitGrid, match->config.players * match->config.max_installations, match->world.width, match->world.height);
+    match->gridUnit = malloc(MAX(match->config.players * match->config.max_installations, 1u) * sizeof(*match->gridUnit));
+    if (match->gridUnit == NULL)
+        exit(EXIT_FAILURE);  // out of memory
+    for (i = 0; i < match->config.players * match->config.max_installations; i++)
+        match->gridUnit[i] = &match->destruct_player[i / match->config.max_installations].unit[i % match->config.max_installations];
+    DE_AllocGrid(&match->wallGrid, match->config.max_walls, match->world.width, match->world.height);
+    match->shotColumn = malloc(match->unitGrid.columns * sizeof(*match->shotColumn));
+    match->shotNext = malloc(match->config.max_shots * sizeof(*match->shotNext));
+    match->shotLive = malloc(DE_SHOT_WORDS(match->config.max_shots) * sizeof(*match->shotLive));
+    match->shotBatch = malloc(MAX(match->config.max_shots, 1u) * sizeof(*match->shotBatch));
+    match->shotFloor = malloc(MAX(match->config.max_shots, 1u) * sizeof(*match->shotFloor));
+    match->shotFromX = malloc(MAX(match->config.max_shots, 1u) * sizeof(*match->shotFromX));
+    match->shotFromY = malloc(MAX(match->config.max_shots, 1u) * sizeof(*match->shotFromY));
+    if (match->shotColumn == NULL || match->shotNext == NULL || match->shotLive == NULL || match->shotBatch == NULL || match->shotFloor == NULL ||
+        match->shotFromX == NULL || match->shotFromY == NULL)
+        exit(EXIT_FAILURE);  // out of memory
+    DE_PoolShots(match);
+    DE_ListShots(match);
+
+    match->flareCapacity = MAX(match->config.max_explosions, 1u) * DE_MAX_FLARE_FILL;
+    match->flares = malloc(match->flareCapacity * sizeof(*match->flares));
+    match->sortedFlares = malloc(match->flareCapacity * sizeof(*match->sortedFlares));
+    match->flareDraws = malloc(match->flareCapacity * sizeof(*match->flareDraws));
+    if (match->flares == NULL || match->sortedFlares == NULL || match->flareDraws == NULL)
+        exit(EXIT_FAILURE);  // out of memory
+    for (i = 0; i < COUNTOF(match->flareSin); i++)
+    {
+        match->flareSin[i] = sinf(i * (2 * M_PI / DE_FLARE_ANGLES));
+    }
+
+    /* Only DE_DrawFrame needs these, and nothing draws a headless match. */
+    if (match->config.headless == false)
+    {
+        for (i = 0; i < match->config.players; i++)
+        {
+            match->prevUnit[i] = calloc(match->config.max_installations, sizeof(*match->prevUnit[i]));
+            if (match->prevUnit[i] == NULL)
+                exit(EXIT_FAILURE);  // out of memory
+        }
+        match->prevShotRec = calloc(match->config.max_shots, sizeof(*match->prevShotRec));
+        DE_AllocMotion(&match->prevShotMotion, match->config.max_shots);
+
+        /* Walls, units, shots with three trails each, crosshairs and HUD icons */
+        match->drawnCapacity = match->config.max_walls + match->config.players * match->config.max_installations +
+                               4 * match->config.max_shots + 2 * match->config.players;
+        match->drawnRects = malloc(match->drawnCapacity * sizeof(*match->drawnRects));
+        if (match->prevShotRec == NULL || match->drawnRects == NULL)
+            exit(EXIT_FAILURE);  // out of memory
+    }
+
+    match->world.VGAScreen = screen;
+    match->destructInternalScreen = destructInternalScreen;
+    match->destructPrevScreen = destructPrevScreen;
+    match->keysactive = NULL;
+    match->viewShot = -1;
+
+    match->seed = seed;
+    mt_srand_r(&match->rng, seed);
+    for (i = 0; i < MAX_STREAMS; i++)
+    {
+        philox_init(&match->stream[i], seed, i);
+    }
+}
+
+void DE_FreeMatch(struct destruct_match_s * match)
+{
+    unsigned int i;
+
+    for (i = 0; i < MAX_PLAYERS; i++)
+    {
+        free(match->destruct_player[i].unit);
+        free(match->prevUnit[i]);
+        match->destruct_player[i].unit = NULL;
+        match->prevUnit[i] = NULL;
+    }
+    free(match->prevShotRec);
+    DE_FreeMotion(&match->prevShotMotion);
+    free(match->drawnRects);
+    match->prevShotRec = NULL;
+    match->drawnRects = NULL;
+    DE_FreeGrid(&match->unitGrid);
+    free(match->gridUnit);
+    match->gridUnit = NULL;
+    DE_FreeGrid(&match->wallGrid);
+    free(match->shotColumn);
+    free(match->shotNext);
+    free(match->shotLive);
+    free(match->shotBatch);
+    free(match->shotFloor);
+    free(match->shotFromX);
+    free(match->shotFromY);
+    match->shotLive = NULL;
+    match->shotBatch = NULL;
+    match->shotFloor = NULL;
+    match->shotFromX = match->shotFromY = NULL;
+    free(match->flares);
+    free(match->sortedFlares);
+    free(match->flareDraws);
+    match->flares = match->sortedFlares = NULL;
+    match->flareDraws = NULL;
+    match->shotColumn = match->shotNext = NULL;
+    free(match->world.mapWalls);
+    free(match->world.baseMap);
+    DE_FreeTerrain(&match->terrain);
+    free(match->dirt);
+    free(match->surface);
+    free(match->dirtBlocks);
+    free(match->dirtRegions);
+    free(match->aliasPending);
+    free(match->unitPlane);
+    free(match->busyTiles);
+    free(match->aliasTiles);
+    free(match->frameTiles);
+    match->world.baseMap = NULL;
+    match->dirt = match->dirtBlocks = match->dirtRegions = match->aliasPending = match->unitPlane = NULL;
+    match->surface = NULL;
+    match->busyTiles = match->aliasTiles = match->frameTiles = NULL;
+    free(match->map.heights);
+    free(match->map.rings);
+    free(match->map.holes);
+    free(match->map.draws);
+    match->map.heights = NULL;
+    match->map.rings = match->map.holes = NULL;
+    match->map.draws = NULL;
+    free(match->exploRec);
+    free(match->exploLive);
+    free(match->exploActive);
+    free(match->shotRec);
+    DE_FreeMotion(&match->shotMotion);
+    match->world.mapWalls = NULL;
+    match->exploRec = NULL;
+    match->exploLive = NULL;
+    match->exploActive = NULL;
+    match->shotRec = NULL;
+}
+
+/* DE_ResetX
+ *
+ * The reset functions clear the state of whatever they are assigned to.
+ */
+void DE_ResetUnits(struct destruct_match_s * match)
+{
+    const struct destruct_config_s * config = &match->config;
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    unsigned int p, u;
+
+    for (p = 0; p < match->config.players; ++p)
     {
         for (u = 0; u < config->max_installations; ++u)
         {
@@ -1087,13 +2043,15 @@ void DE_ResetUnits(const struct destruct_config_s * config, struct destruct_play
     }
 }
 
-void DE_ResetPlayers(struct destruct_player_s * destruct_player)
+void DE_ResetPlayers(struct destruct_match_s * match)
 {
+    struct destruct_player_s * destruct_player = match->destruct_player;
     unsigned int i;
 
     for (i = 0; i < MAX_PLAYERS; ++i)
     {
-        destruct_player[i].is_cpu = false;
+        destruct_player[i].is_cpu = (i >= DE_KEYBOARD_PLAYERS);
+        destruct_player[i].team = i % MAX_TEAMS;
         destruct_player[i].unitSelected = 0;
         destruct_player[i].shotDelay = 0;
         destruct_player[i].score = 0;
@@ -1101,51 +2059,348 @@ void DE_ResetPlayers(struct destruct_player_s * destruct_player)
         destruct_player[i].aiMemory.c_Power = 0;
         destruct_player[i].aiMemory.c_Fire = 0;
         destruct_player[i].aiMemory.c_noDown = 0;
-        memcpy(destruct_player[i].keys.Config, defaultKeyConfig[i], sizeof(destruct_player[i].keys.Config));
+        destruct_player[i].aiMemory.plan.valid = false;
+        if (i < DE_KEYBOARD_PLAYERS)
+            destruct_player[i].keys = match->config.keys[i];
     }
 }
 
-static void DE_ResetWeapons(const struct destruct_config_s * config,
-                            struct destruct_shot_s * shotRec,
-                            struct destruct_explo_s * exploRec)
+/* DE_AllocMotion
+ *
+ * Sets motion up for count shots, all of them standing still at 0, 0.
+ */
+static void DE_AllocMotion(struct destruct_motion_s * motion, unsigned int count)
+{
+    motion->x = calloc(4 * MAX(count, 1u), sizeof(*motion->x));
+    if (motion->x == NULL)
+        exit(EXIT_FAILURE);  // out of memory
+
+    motion->y = motion->x + count;
+    motion->xmov = motion->y + count;
+    motion->ymov = motion->xmov + count;
+}
+
+static void DE_CopyMotion(struct destruct_motion_s * dst, const struct destruct_motion_s * src, unsigned int count)
+{
+    memcpy(dst->x, src->x, 4 * count * sizeof(*dst->x));
+}
+
+static void DE_FreeMotion(struct destruct_motion_s * motion)
+{
+    free(motion->x);
+    motion->x = motion->y = motion->xmov = motion->ymov = NULL;
+}
+
+/* DE_PoolShots
+ *
+ * Brings shotLive back in line with isAvailable, after shotRec has been
+ * written over wholesale.
+ */
+static void DE_PoolShots(struct destruct_match_s * match)
 {
     unsigned int i;
 
-    for (i = 0; i < config->max_shots; i++)
+    memset(match->shotLive, 0, DE_SHOT_WORDS(match->config.max_shots) * sizeof(*match->shotLive));
+    for (i = 0; i < match->config.max_shots; i++)
+    {
+        if (match->shotRec[i].isAvailable == false)
+            match->shotLive[i / 64] |= 1ULL << (i % 64);
+    }
+    match->shotFreeWord = 0;
+}
+
+/* DE_AllocShot
+ *
+ * Takes the lowest free slot, the one a search through shotRec would have
+ * found, or returns -1 if they are all in use.  Whole words of shots in use
+ * are skipped over, and the ones below shotFreeWord aren't looked at at all.
+ */
+static int DE_AllocShot(struct destruct_match_s * match)
+{
+    const unsigned int words = DE_SHOT_WORDS(match->config.max_shots);
+    unsigned int w, i;
+    Uint64 bits;
+
+    for (w = match->shotFreeWord; w < words; w++)
     {
-        shotRec[i].isAvailable = true;
+        bits = ~match->shotLive[w];
+        if (bits == 0)
+            continue;
+
+        i = w * 64 + __builtin_ctzll(bits);
+        if (i >= match->config.max_shots)
+            break;
+
+        match->shotFreeWord = w;
+        match->shotLive[w] |= 1ULL << (i % 64);
+        match->shotRec[i].isAvailable = false;
+        return i;
     }
+    match->shotFreeWord = words;
+    return -1;
+}
+
+static inline void DE_FreeShot(struct destruct_match_s * match, unsigned int index)
+{
+    match->shotRec[index].isAvailable = true;
+    match->shotLive[index / 64] &= ~(1ULL << (index % 64));
+    match->shotFreeWord = MIN(match->shotFreeWord, index / 64);
+}
+
+/* DE_ExploLimit
+ *
+ * How many explosions there may be at once.  Before RULES_EXPLO_POOL any
+ * more than max_explosions were thrown away.
+ */
+static unsigned int DE_ExploLimit(const struct destruct_config_s * config)
+{
+    if (config->rules < RULES_EXPLO_POOL)
+        return config->max_explosions;
+    return MAX(config->max_explosions, config->explosion_limit);
+}
+
+/* DE_ResizeExplosions
+ *
+ * Gives the explosion pool capacity slots, the new ones free.  It never
+ * shrinks; explosions already going keep their slots.
+ */
+static void DE_ResizeExplosions(struct destruct_match_s * match, unsigned int capacity)
+{
+    const unsigned int words = DE_EXPLO_WORDS(match->exploCapacity);
+    struct destruct_explo_s * exploRec;
+    Uint64 * exploLive;
+    unsigned int * exploActive;
+    unsigned int i;
+
+    if (capacity <= match->exploCapacity && match->exploRec != NULL)
+        return;
+
+    exploRec = realloc(match->exploRec, MAX(capacity, 1u) * sizeof(*exploRec));
+    exploLive = realloc(match->exploLive, MAX(DE_EXPLO_WORDS(capacity), 1u) * sizeof(*exploLive));
+    exploActive = realloc(match->exploActive, MAX(capacity, 1u) * sizeof(*exploActive));
+    if (exploRec == NULL || exploLive == NULL || exploActive == NULL)
+        exit(EXIT_FAILURE);  // out of memory
 
-    for (i = 0; i < config->max_explosions; i++)
+    for (i = match->exploCapacity; i < capacity; i++)
     {
+        memset(&exploRec[i], 0, sizeof(exploRec[i]));
         exploRec[i].isAvailable = true;
     }
+    for (i = words; i < DE_EXPLO_WORDS(capacity); i++)
+    {
+        exploLive[i] = 0;
+    }
+
+    match->exploRec = exploRec;
+    match->exploLive = exploLive;
+    match->exploActive = exploActive;
+    match->exploFreeWord = MIN(match->exploFreeWord, match->exploCapacity / 64);
+    match->exploCapacity = capacity;
+}
+
+/* DE_PoolExplosions
+ *
+ * Brings exploLive back in line with isAvailable, after exploRec has been
+ * written over wholesale.  exploActive is left to the caller.
+ */
+static void DE_PoolExplosions(struct destruct_match_s * match)
+{
+    unsigned int i;
+
+    memset(match->exploLive, 0, DE_EXPLO_WORDS(match->exploCapacity) * sizeof(*match->exploLive));
+    for (i = 0; i < match->exploCapacity; i++)
+    {
+        if (match->exploRec[i].isAvailable == false)
+            match->exploLive[i / 64] |= 1ULL << (i % 64);
+    }
+    match->exploFreeWord = 0;
+}
+
+/* DE_AllocExplosion
+ *
+ * Takes the lowest free slot, the one a search through exploRec would have
+ * found, and puts it on the active list.  When every slot is in use the
+ * pool doubles, up to DE_ExploLimit; past that the explosion is dropped and
+ * counted, and -1 returned.
+ */
+static int DE_AllocExplosion(struct destruct_match_s * match)
+{
+    unsigned int words, w, i, j;
+    Uint64 bits;
+
+    for (;;)
+    {
+        words = DE_EXPLO_WORDS(match->exploCapacity);
+        for (w = match->exploFreeWord; w < words; w++)
+        {
+            bits = ~match->exploLive[w];
+            if (bits == 0)
+                continue;
+
+            i = w * 64 + __builtin_ctzll(bits);
+            if (i >= match->exploCapacity)
+                break;
+
+            match->exploFreeWord = w;
+            match->exploLive[w] |= 1ULL << (i % 64);
+            match->exploRec[i].isAvailable = false;
+
+            /* The old rules went through the explosions by slot */
+            j = match->exploCount++;
+            if (match->config.rules < RULES_EXPLO_POOL)
+            {
+                for (; j > 0 && match->exploActive[j - 1] > i; j--)
+                    match->exploActive[j] = match->exploActive[j - 1];
+            }
+            match->exploActive[j] = i;
+            match->exploPeak = MAX(match->exploPeak, match->exploCount);
+            return i;
+        }
+        match->exploFreeWord = words;
+
+        if (match->exploCapacity >= DE_ExploLimit(&match->config))
+            break;
+        DE_ResizeExplosions(match, MIN(MAX(2 * match->exploCapacity, 64u), DE_ExploLimit(&match->config)));
+    }
+
+    match->exploDropped++;
+    return -1;
+}
+
+/* Frees the slot only; whoever goes through exploActive takes it off */
+static inline void DE_FreeExplosion(struct destruct_match_s * match, unsigned int index)
+{
+    match->exploRec[index].isAvailable = true;
+    match->exploLive[index / 64] &= ~(1ULL << (index % 64));
+    match->exploFreeWord = MIN(match->exploFreeWord, index / 64);
+}
+
+static void DE_UnlistExplosion(struct destruct_match_s * match, unsigned int index)
+{
+    unsigned int j;
+
+    for (j = 0; j < match->exploCount && match->exploActive[j] != index; j++)
+        ;
+    assert(j < match->exploCount);
+    memmove(&match->exploActive[j], &match->exploActive[j + 1], (match->exploCount - j - 1) * sizeof(*match->exploActive));
+    match->exploCount--;
+}
+
+static void DE_ResetWeapons(struct destruct_match_s * match)
+{
+    unsigned int i;
+
+    for (i = 0; i < match->config.max_shots; i++)
+    {
+        match->shotRec[i].isAvailable = true;
+    }
+    DE_PoolShots(match);
+
+    for (i = 0; i < match->exploCapacity; i++)
+    {
+        match->exploRec[i].isAvailable = true;
+    }
+    DE_PoolExplosions(match);
+    match->exploCount = 0;
+}
+
+/* DE_ResetLevel
+ *
+ * Starts a new round on a new map, drawn over whatever is on screen now.
+ */
+void DE_ResetLevel(struct destruct_match_s * match)
+{
+    DE_PrepareLevel(match, match->world.VGAScreen);
+    DE_ShowLevel(match);
 }
 
-void DE_ResetLevel(const struct destruct_config_s * config,
-                   struct destruct_player_s * destruct_player,
-                   struct destruct_shot_s * shotRec,
-                   struct destruct_explo_s * exploRec,
-                   struct destruct_world_s * world,
-                   SDL_Surface * destructInternalScreen)
+/* DE_PrepareLevel
+ *
+ * The part of DE_ResetLevel that only touches the match: the new map, drawn
+ * over backdrop, and everything on it.  It reads no screen but backdrop and
+ * plays no sound, so it can run on another thread while this one is busy
+ * with something else, such as fading out the last round.  Call
+ * DE_ShowLevel on the main thread once it's done.
+ */
+void DE_PrepareLevel(struct destruct_match_s * match, const SDL_Surface * backdrop)
 {
     /* Okay, let's prep the arena */
+    match->destructFirstTime = true;
+
+    /* A replayed round gets its mode and its humans and CPUs from the log */
+    if (match->log != NULL && match->replaying == true)
+        DE_ApplyLogFlags(match);
+    else
+        match->logRoundStart = true;
+
+    DE_ResetWeapons(match);
+
+    JE_generateTerrain(match, backdrop);
+    DE_ResetAI(match);
+}
+
+/* DE_ShowLevel
+ *
+ * Starts the map's song and puts the map on screen, for a level that
+ * DE_PrepareLevel has just made.  Nothing to do for a headless match.
+ */
+void DE_ShowLevel(struct destruct_match_s * match)
+{
+    if (match->config.headless == true)
+        return;
+
+    play_song(match->world.song);
+    DE_MoveView(match, true);
+    DE_RestoreFrame(match);
+    JE_showVGA();
+}
+
+/* DE_TeamUnits
+ *
+ * How many units the players of a team have left between them.
+ */
+unsigned int DE_TeamUnits(const struct destruct_match_s * match, enum de_team_t team)
+{
+    unsigned int i, units = 0;
+
+    for (i = 0; i < match->config.players; i++)
+    {
+        if (match->destruct_player[i].team == team)
+            units += match->destruct_player[i].unitsRemaining;
+    }
+    return units;
+}
 
-    DE_ResetWeapons(config, shotRec, exploRec);
+/* DE_TeamScore
+ *
+ * The points the players of a team have scored between them.
+ */
+unsigned int DE_TeamScore(const struct destruct_match_s * match, enum de_team_t team)
+{
+    unsigned int i, score = 0;
 
-    JE_generateTerrain(config, destruct_player, world, destructInternalScreen);
-    DE_ResetAI(config, destruct_player, world);
+    for (i = 0; i < match->config.players; i++)
+    {
+        if (match->destruct_player[i].team == team)
+            score += match->destruct_player[i].score;
+    }
+    return score;
 }
 
-static void DE_ResetAI(const struct destruct_config_s * config,
-                       struct destruct_player_s * destruct_player,
-                       const struct destruct_world_s * world)
+static void DE_ResetAI(struct destruct_match_s * match)
 {
+    const struct destruct_config_s * config = &match->config;
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    const struct destruct_world_s * world = &match->world;
     unsigned int i, j;
     struct destruct_unit_s * ptr;
 
-    for (i = PLAYER_LEFT; i < MAX_PLAYERS; i++)
+    /* Plans, and any search still going, were made for the last map */
+    if (match->planner != NULL)
+        match->planner->stale = true;
+    for (i = PLAYER_LEFT; i < match->config.players; i++)
     {
+        destruct_player[i].aiMemory.plan.valid = false;
         if (destruct_player[i].is_cpu == false)
             continue;
         ptr = destruct_player[i].unit;
@@ -1161,20 +2416,26 @@ static void DE_ResetAI(const struct destruct_config_s * config,
                 ptr->angle = 0;
 
             ptr->power = (ptr->unitType == UNIT_LASER) ? 6 : 4;
+            ptr->aim.uses = 0;  /* nothing worked out on this map yet */
 
             if (world->mapFlags & MAP_WALLS)
                 ptr->shotType = defaultCpuWeaponB[ptr->unitType];
             else
                 ptr->shotType = defaultCpuWeapon[ptr->unitType];
+
+            /* Spread a massive battle's first volley out */
+            if (config->battle_units > 0)
+                ptr->shotDelay = 1 + DE_Rand(match, STREAM_AI + i) % (shotDelay[ptr->shotType] + 1);
         }
     }
 }
 
-static void DE_ResetActions(struct destruct_player_s * destruct_player)
+static void DE_ResetActions(struct destruct_match_s * match)
 {
+    struct destruct_player_s * destruct_player = match->destruct_player;
     unsigned int i;
 
-    for (i = 0; i < MAX_PLAYERS; i++)
+    for (i = 0; i < match->config.players; i++)
     {   /* Zero it all.  A memset would do the trick */
         memset(&(destruct_player[i].moves), 0, sizeof(destruct_player[i].moves));
     }
@@ -1182,197 +2443,454 @@ static void DE_ResetActions(struct destruct_player_s * destruct_player)
 
 /* DE_RunTick
  *
- * Runs one tick.  One tick involves handling physics, drawing crap,
- * moving projectiles and explosions, and getting input.
- * Returns true while the game is running or false if the game is
- * to be terminated.
- */
-enum de_state_t DE_RunTick(const struct destruct_config_s * config,
-                           struct destruct_player_s * destruct_player,
-                           struct destruct_shot_s * shotRec,
-                           struct destruct_explo_s * exploRec,
-                           struct destruct_world_s * world,
-                           SDL_Surface * destructInternalScreen,
-                           SDL_Surface * destructPrevScreen)
-{
-    static unsigned int endDelay;
-
-    setDelay(1);
-
-    memset(soundQueue, 0, sizeof(soundQueue));
-    JE_tempScreenChecking(world->VGAScreen, destructInternalScreen, config);
-
-    DE_ResetActions(destruct_player);
-    DE_RunTickCycleDeadUnits(config, destruct_player);
-
-    DE_RunTickGravity(config, destruct_player, destructInternalScreen, world->VGAScreen);
-    DE_RunTickAnimate(config, destruct_player);
-    DE_RunTickDrawWalls(config, world);
-    DE_RunTickExplosions(config, destruct_player, exploRec, destructInternalScreen);
-    DE_RunTickShots(config, destruct_player, shotRec, exploRec, world, destructInternalScreen);
-    DE_RunTickAI(config, destruct_player);
-    DE_RunTickDrawCrosshairs(destruct_player, world->VGAScreen);
-    DE_RunTickDrawHUD(destruct_player, world->VGAScreen);
-    JE_showVGA();
+ * Runs one tick.  One tick involves handling physics, moving projectiles
+ * and explosions, and getting input.  Drawing is left to DE_DrawFrame and
+ * pacing to the caller, so a tick takes as long as the CPU needs and any
+ * number of frames may be drawn in between.
+ * Returns STATE_CONTINUE while the round is running, STATE_RELOAD for a
+ * new round and STATE_INIT to go back to the mode select.
+ *
+ * A headless tick (config->headless) skips everything that only exists for
+ * the player's benefit: fading, sound and keyboard input.  Everything that
+ * touches the world runs in the same order either way, so both paths stay
+ * in lockstep.
+ *
+ * While replaying an input log the moves come from the log instead of from
+ * the keyboard; see DE_RunTickLog.  Every tick ends by hashing the world;
+ * see DE_RunTickHash.
+ */
+enum de_state_t DE_RunTick(struct destruct_match_s * match)
+{
+    const struct destruct_config_s * config = &match->config;
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    struct destruct_world_s * world = &match->world;
+    Uint8 * keys = match->keysactive;
+    bool roundOver;
+
+    DE_RunTickPlans(match);
+
+    if (config->headless == false)
+        DE_SavePrevious(match);
+
+    memset(match->soundQueue, 0, sizeof(match->soundQueue));
+    DE_FadeTerrain(match, false);
 
-    if (destructFirstTime)
+    if (match->log != NULL && match->replaying == true)
+        DE_ApplyLogFlags(match);
+
+    DE_ResetActions(match);
+    DE_RunTickCycleDeadUnits(match);
+
+    DE_RunTickGravity(match);
+    DE_RunTickAnimate(match);
+    DE_RunTickGrid(match);
+    DE_RunTickExplosions(match);
+    DE_RunTickShots(match);
+    DE_RunTickAI(match);
+    DE_RunTickVolleys(match);
+
+    if (match->destructFirstTime)
     {
-        fade_palette(colors, 25, 0, 255);
-        destructFirstTime = false;
-        endDelay = 0;
+        if (config->headless == false)
+        {
+            DE_DrawFrame(match, 1);
+            fade_palette(colors, 25, 0, 255);
+        }
+        match->destructFirstTime = false;
+        match->endDelay = 0;
     }
 
-    DE_RunTickGetInput(destruct_player);
-    DE_ProcessInput(config, destruct_player, shotRec, destructInternalScreen);
+    if (config->headless == false)
+        DE_RunTickGetInput(match);
+    if (match->log != NULL)
+        DE_RunTickLog(match);
+    DE_ProcessInput(match);
 
-    if (endDelay > 0)
+    roundOver = false;
+    if (match->endDelay > 0)
     {
-        if (--endDelay == 0)
-            return STATE_RELOAD;
+        roundOver = (--match->endDelay == 0);
     }
-    else if (DE_RunTickCheckEndgame(destruct_player, world) == true)
+    else if (DE_RunTickCheckEndgame(match) == true)
     {
-        endDelay = 80;
+        match->endDelay = 80;
     }
 
-    DE_RunTickPlaySounds();
+    /* The world is done changing for this tick */
+    DE_RunTickHash(match);
+
+    if (roundOver == true)
+        return STATE_RELOAD;
+
+    if (config->headless == true)
+        return STATE_CONTINUE; /* Nobody to listen to or take keys from */
+
+    DE_RunTickPlaySounds(match);
+
+    if (keys == NULL)
+        return STATE_CONTINUE;
 
     /* The rest of this cruft needs to be put in appropriate sections */
-    if (keysactive[SDL_SCANCODE_F10])
+    if (keys[SDL_SCANCODE_F10])
     {
         destruct_player[PLAYER_LEFT].is_cpu = !destruct_player[PLAYER_LEFT].is_cpu;
-        keysactive[SDL_SCANCODE_F10] = false;
+        keys[SDL_SCANCODE_F10] = false;
     }
-    if (keysactive[SDL_SCANCODE_F11])
+    if (keys[SDL_SCANCODE_F11])
     {
         destruct_player[PLAYER_RIGHT].is_cpu = !destruct_player[PLAYER_RIGHT].is_cpu;
-        keysactive[SDL_SCANCODE_F11] = false;
+        keys[SDL_SCANCODE_F11] = false;
     }
-    if (keysactive[SDL_SCANCODE_P])
+    if (keys[SDL_SCANCODE_P])
     {
-        JE_pauseScreen(world->VGAScreen, destructPrevScreen);
-        keysactive[lastkey_scan] = false;
+        JE_pauseScreen(world->VGAScreen, match->destructPrevScreen);
+        keys[lastkey_scan] = false;
     }
 
-    if (keysactive[SDL_SCANCODE_F1])
+    if (keys[SDL_SCANCODE_F1])
     {
-        JE_helpScreen(world->VGAScreen, destructPrevScreen, destruct_player);
-        keysactive[lastkey_scan] = false;
+        JE_helpScreen(world->VGAScreen, match->destructPrevScreen, destruct_player);
+        keys[lastkey_scan] = false;
     }
 
-    wait_delay();
-
-    if (keysactive[SDL_SCANCODE_ESCAPE])
+    if (keys[SDL_SCANCODE_ESCAPE])
     {
-        keysactive[SDL_SCANCODE_ESCAPE] = false;
+        keys[SDL_SCANCODE_ESCAPE] = false;
         return STATE_INIT; /* STATE_INIT drops us to the mode select */
     }
 
-    if (keysactive[SDL_SCANCODE_BACKSPACE])
+    if (keys[SDL_SCANCODE_BACKSPACE])
     {
-        keysactive[SDL_SCANCODE_BACKSPACE] = false;
+        keys[SDL_SCANCODE_BACKSPACE] = false;
         return STATE_RELOAD; /* STATE_RELOAD creates a new map */
     }
 
     return STATE_CONTINUE;
 }
 
-/* DE_RunTickX
+/* DE_DrawFrame
  *
- * Handles something that we do once per tick, such as
- * track ammo and move explosions.
+ * Draws the world onto VGAScreen without presenting it.  alpha says how far
+ * into the next tick the frame is shown, from 0 (the start of the last tick)
+ * to 1 (its end); units, shots and crosshairs are drawn that far between
+ * where the last tick found them and where it left them.  Ticks can then
+ * run at their fixed rate while frames go out at whatever rate the display
+ * wants, at the cost of showing the world up to one tick late.
+ * Only the picture depends on alpha; the world is left alone.
  */
-static void DE_RunTickCycleDeadUnits(const struct destruct_config_s * config, struct destruct_player_s * destruct_player)
+void DE_DrawFrame(struct destruct_match_s * match, float alpha)
 {
-    unsigned int i;
+    const struct destruct_config_s * config = &match->config;
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    unsigned int i, j;
     struct destruct_unit_s * unit;
+    struct destruct_unit_s lerpUnit;
 
-    /* This code automatically switches the active unit if it is destroyed
-     * and skips over the useless satellite */
-    for (i = 0; i < MAX_PLAYERS; i++)
-    {
-        if (destruct_player[i].unitsRemaining == 0)
-            continue;
-
-        unit = &(destruct_player[i].unit[destruct_player[i].unitSelected]);
-        while (DE_isValidUnit(unit) == false ||
-               unit->shotType == SHOT_INVALID)
-        {
-            destruct_player[i].unitSelected++;
-            unit++;
-            if (destruct_player[i].unitSelected >= config->max_installations)
-            {
-                destruct_player[i].unitSelected = 0;
-                unit = destruct_player[i].unit;
-            }
-        }
-    }
-}
+    DE_MoveView(match, false);
+    DE_RestoreFrame(match);
 
-static void DE_RunTickGravity(const struct destruct_config_s * config,
-                              struct destruct_player_s * destruct_player,
-                              const SDL_Surface * destructInternalScreen,
-                              SDL_Surface * screen)
-{
-    unsigned int i, j;
-    struct destruct_unit_s * unit;
+    DE_RunTickDrawWalls(match);
 
-    for (i = 0; i < MAX_PLAYERS; i++)
+    for (i = 0; i < match->config.players; i++)
     {
         unit = destruct_player[i].unit;
         for (j = 0; j < config->max_installations; j++, unit++)
         {
-            if (DE_isValidUnit(unit) == false) /* invalid unit */
+            if (DE_isValidUnit(unit) == false)
                 continue;
 
-            switch (unit->unitType)
-            {
-            case UNIT_SATELLITE: /* satellites don't fall down */
-                break;
-
-            case UNIT_HELI:
-            case UNIT_JUMPER:
-                if (unit->isYInAir == true) /* unit is falling down, at least in theory */
-                {
-                    DE_GravityFlyUnit(destructInternalScreen, unit);
-                    break;
-                }
-                /* else treat as a normal unit */
-                /* fall through */
-            default:
-                DE_GravityLowerUnit(destructInternalScreen, unit);
-            }
-
-            /* Draw the unit. */
-            DE_GravityDrawUnit(i, unit, screen);
+            DE_LerpUnit(&match->prevUnit[i][j], unit, alpha, &lerpUnit);
+            DE_GravityDrawUnit(match, destruct_player[i].team, &lerpUnit);
         }
     }
-}
-
-static void DE_GravityDrawUnit(enum de_player_t team, struct destruct_unit_s * unit, SDL_Surface * screen)
-{
-    unsigned int anim_index;
 
-    anim_index = GraphicBase[team][unit->unitType] + unit->ani_frame;
-    if (unit->unitType == UNIT_HELI)
-    {
-        /* Adjust animation index if we are traveling right or left. */
-        if (unit->lastMove < -2)
-            anim_index += 5;
-        else if (unit->lastMove > 2)
-            anim_index += 10;
-    }
-    else /* This handles our cannons and the like */
+    for (i = 0; i < config->max_shots; i++)
     {
-        anim_index += floorf(unit->angle * 9.99f / M_PI);
+        if (match->shotRec[i].isAvailable == true)
+            continue;
+
+        DE_DrawShot(match, i, alpha);
     }
 
-    blit_sprite2(screen, unit->unitX, roundf(unit->unitY) - 13, destructSpriteSheet, anim_index);
+    DE_RunTickDrawCrosshairs(match, alpha);
+    DE_RunTickDrawHUD(match);
 }
 
-static void DE_GravityLowerUnit(const SDL_Surface * destructInternalScreen, struct destruct_unit_s * unit)
+/* Puts the terrain in view back on VGAScreen where the last frame drew over
+ * it or where it has changed since.  The HUD covers the top 12 rows and
+ * paints its own background. */
+static void DE_RestoreFrame(struct destruct_match_s * match)
 {
-    /* units fall at a constant speed.  The heli is an odd case though;
+    SDL_Surface * screen = match->world.VGAScreen;
+    const struct destruct_terrain_s * terrain = &match->terrain;
+    Uint8 * dst = screen->pixels;
+    const struct destruct_rect_s * rect;
+    unsigned int i, w, tile, tx, ty, y;
+    int x1, x2, y1, y2;
+    Uint64 tiles;
+
+    if (match->redrawFrame == true)
+    {
+        for (y = 12; y < vga_height; y++)
+            DE_CopyTerrainRow(terrain, dst + y * screen->pitch, match->viewX, match->viewY + y, vga_width);
+        match->redrawFrame = false;
+        memset(match->frameTiles, 0, sizeof(*match->frameTiles) * DE_TILE_WORDS(terrain));
+        match->drawnCount = 0;
+        return;
+    }
+
+    for (i = 0; i < match->drawnCount; i++)
+    {
+        rect = &match->drawnRects[i];
+        for (y = MAX(rect->y, 12); y < rect->y + rect->height; y++)
+        {
+            DE_CopyTerrainRow(terrain, dst + y * screen->pitch + rect->x,
+                              match->viewX + rect->x, match->viewY + y, rect->width);
+        }
+    }
+    match->drawnCount = 0;
+
+    for (w = 0; w < DE_TILE_WORDS(terrain); w++)
+    {
+        for (tiles = match->frameTiles[w]; tiles != 0; tiles &= tiles - 1)
+        {
+            tile = w * 64 + __builtin_ctzll(tiles);
+            tx = tile % terrain->columns;
+            ty = tile / terrain->columns;
+
+            /* The part of the tile in view, on the screen */
+            x1 = MAX((int)(tx * DE_TILE_WIDTH) - match->viewX, 0);
+            x2 = MIN((int)((tx + 1) * DE_TILE_WIDTH) - match->viewX, vga_width);
+            y1 = MAX((int)(ty * DE_TILE_HEIGHT) - match->viewY, 12);
+            y2 = MIN((int)((ty + 1) * DE_TILE_HEIGHT) - match->viewY, vga_height);
+            if (x1 >= x2)
+                continue;  /* out of view */
+            for (; y1 < y2; y1++)
+                DE_CopyTerrainRow(terrain, dst + y1 * screen->pitch + x1, match->viewX + x1, match->viewY + y1, x2 - x1);
+        }
+    }
+    memset(match->frameTiles, 0, sizeof(*match->frameTiles) * DE_TILE_WORDS(terrain));
+}
+
+/* Notes that the frame being drawn covers a width by height block of the
+ * screen from (x, y), to be put back before the next one.  Returns false if
+ * none of it is on the screen. */
+static bool DE_DrawnRect(struct destruct_match_s * match, int x, int y, unsigned int width, unsigned int height)
+{
+    struct destruct_rect_s * rect;
+    const int x1 = MAX(x, 0), x2 = MIN(x + (int)width, vga_width);
+    const int y1 = MAX(y, 0), y2 = MIN(y + (int)height, vga_height);
+
+    if (x1 >= x2 || y1 >= y2)
+        return false;
+
+    if (match->drawnCount == match->drawnCapacity)
+    {
+        match->redrawFrame = true;  /* can't happen, but just in case */
+        return true;
+    }
+
+    rect = &match->drawnRects[match->drawnCount++];
+    rect->x = x1;
+    rect->y = y1;
+    rect->width = x2 - x1;
+    rect->height = y2 - y1;
+    return true;
+}
+
+/* DE_MoveView
+ *
+ * Scrolls the view toward the action: the last shot a keyboard player fired
+ * while it's in the air, otherwise the unit the first human player has
+ * selected.  It eases an eighth of the way there each frame unless snap is
+ * true, and never leaves the world.  A view that moves is redrawn whole.
+ */
+static void DE_MoveView(struct destruct_match_s * match, bool snap)
+{
+    const struct destruct_terrain_s * terrain = &match->terrain;
+    const struct destruct_unit_s * unit;
+    unsigned int i, player = PLAYER_LEFT;
+    float x, y;
+    int viewX, viewY;
+
+    if (match->viewShot >= 0 && match->shotRec[match->viewShot].isAvailable == false)
+    {
+        x = match->shotMotion.x[match->viewShot];
+        y = match->shotMotion.y[match->viewShot];
+    }
+    else
+    {
+        match->viewShot = -1;
+        for (i = 0; i < DE_KEYBOARD_PLAYERS; i++)
+        {
+            if (match->destruct_player[i].is_cpu == false)
+            {
+                player = i;
+                break;
+            }
+        }
+        unit = &match->destruct_player[player].unit[match->destruct_player[player].unitSelected];
+        x = unit->unitX + DE_SPRITE_WIDTH / 2;
+        y = unit->unitY;
+    }
+
+    viewX = roundf(x) - vga_width / 2;
+    viewY = roundf(y) - vga_height / 2;
+    if (snap == false)
+    {
+        viewX = match->viewX + (int)roundf((viewX - match->viewX) * 0.125f);
+        viewY = match->viewY + (int)roundf((viewY - match->viewY) * 0.125f);
+    }
+    viewX = MIN(MAX(viewX, 0), (int)(terrain->width - vga_width));
+    viewY = MIN(MAX(viewY, 0), (int)(terrain->height - vga_height));
+
+    if (viewX != match->viewX || viewY != match->viewY)
+    {
+        match->viewX = viewX;
+        match->viewY = viewY;
+        match->redrawFrame = true;
+    }
+}
+
+/* Keeps a copy of what DE_DrawFrame interpolates from. */
+static void DE_SavePrevious(struct destruct_match_s * match)
+{
+    const struct destruct_config_s * config = &match->config;
+    unsigned int i;
+
+    for (i = 0; i < match->config.players; i++)
+    {
+        memcpy(match->prevUnit[i], match->destruct_player[i].unit, sizeof(*match->prevUnit[i]) * config->max_installations);
+        match->prevUnitSelected[i] = match->destruct_player[i].unitSelected;
+    }
+    memcpy(match->prevShotRec, match->shotRec, sizeof(*match->prevShotRec) * config->max_shots);
+    DE_CopyMotion(&match->prevShotMotion, &match->shotMotion, config->max_shots);
+}
+
+/* Fills out with cur, moved alpha of the way from prev.  A unit that only
+ * just showed up, turned into something else or jumped (a new round, a
+ * restored snapshot) is left where it is. */
+static void DE_LerpUnit(const struct destruct_unit_s * prev,
+                        const struct destruct_unit_s * cur,
+                        float alpha,
+                        struct destruct_unit_s * out)
+{
+    int dx;
+
+    *out = *cur;
+    if (DE_isValidUnit(prev) == false || prev->unitType != cur->unitType)
+        return;
+
+    dx = (int)cur->unitX - (int)prev->unitX;
+    if (abs(dx) > 16 || fabsf(cur->unitY - prev->unitY) > 16)
+        return;
+
+    out->unitX = prev->unitX + (int)roundf(dx * alpha);
+    out->unitY = prev->unitY + (cur->unitY - prev->unitY) * alpha;
+    out->angle = prev->angle + (cur->angle - prev->angle) * alpha;
+    out->power = prev->power + (cur->power - prev->power) * alpha;
+}
+
+/* DE_RunTickX
+ *
+ * Handles something that we do once per tick, such as
+ * track ammo and move explosions.
+ */
+static void DE_RunTickCycleDeadUnits(struct destruct_match_s * match)
+{
+    const struct destruct_config_s * config = &match->config;
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    unsigned int i;
+    struct destruct_unit_s * unit;
+
+    /* This code automatically switches the active unit if it is destroyed
+     * and skips over the useless satellite */
+    for (i = 0; i < match->config.players; i++)
+    {
+        if (destruct_player[i].unitsRemaining == 0)
+            continue;
+
+        unit = &(destruct_player[i].unit[destruct_player[i].unitSelected]);
+        while (DE_isValidUnit(unit) == false ||
+               unit->shotType == SHOT_INVALID)
+        {
+            destruct_player[i].unitSelected++;
+            unit++;
+            if (destruct_player[i].unitSelected >= config->max_installations)
+            {
+                destruct_player[i].unitSelected = 0;
+                unit = destruct_player[i].unit;
+            }
+        }
+    }
+}
+
+static void DE_RunTickGravity(struct destruct_match_s * match)
+{
+    const struct destruct_config_s * config = &match->config;
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    unsigned int i, j;
+    struct destruct_unit_s * unit;
+
+    for (i = 0; i < match->config.players; i++)
+    {
+        unit = destruct_player[i].unit;
+        for (j = 0; j < config->max_installations; j++, unit++)
+        {
+            if (DE_isValidUnit(unit) == false) /* invalid unit */
+                continue;
+
+            switch (unit->unitType)
+            {
+            case UNIT_SATELLITE: /* satellites don't fall down */
+                break;
+
+            case UNIT_HELI:
+            case UNIT_JUMPER:
+                if (unit->isYInAir == true) /* unit is falling down, at least in theory */
+                {
+                    DE_GravityFlyUnit(match, unit);
+                    break;
+                }
+                /* else treat as a normal unit */
+                /* fall through */
+            default:
+                DE_GravityLowerUnit(match, unit);
+            }
+        }
+    }
+}
+
+static void DE_GravityDrawUnit(struct destruct_match_s * match, enum de_team_t team, const struct destruct_unit_s * unit)
+{
+    const int x = unit->unitX - match->viewX, y = roundf(unit->unitY) - 13 - match->viewY;
+    unsigned int anim_index;
+
+    if (DE_DrawnRect(match, x, y, DE_SPRITE_WIDTH, DE_SPRITE_HEIGHT) == false)
+        return;  /* out of view */
+
+    anim_index = GraphicBase[team][unit->unitType] + unit->ani_frame;
+    if (unit->unitType == UNIT_HELI)
+    {
+        /* Adjust animation index if we are traveling right or left. */
+        if (unit->lastMove < -2)
+            anim_index += 5;
+        else if (unit->lastMove > 2)
+            anim_index += 10;
+    }
+    else /* This handles our cannons and the like */
+    {
+        anim_index += floorf(unit->angle * 9.99f / M_PI);
+    }
+
+    blit_sprite2_clip(match->world.VGAScreen, x, y, destructSpriteSheet, anim_index);
+}
+
+static void DE_GravityLowerUnit(const struct destruct_match_s * match, struct destruct_unit_s * unit)
+{
+    const unsigned int width = match->terrain.width, bottom = match->terrain.height - 1;
+
+    /* units fall at a constant speed.  The heli is an odd case though;
      * we simply give it a downward velocity, but due to a buggy implementation
      * the chopper didn't lower until you tried to fly it up.  Tyrian 2000 fixes
      * this by not making the chopper a special case.  I've decided to actually
@@ -1380,9 +2898,9 @@ static void DE_GravityLowerUnit(const SDL_Surface * destructInternalScreen, stru
      * a 'rocky' takeoff), and it is lowered like a regular unit, but not as
      * quickly.
      */
-    if (unit->unitY < 199)  /* checking takes time, don't check if it's at the bottom */
+    if (unit->unitY < bottom)  /* checking takes time, don't check if it's at the bottom */
     {
-        if (JE_stabilityCheck(destructInternalScreen, unit->unitX, roundf(unit->unitY)))
+        if (JE_stabilityCheck(match->dirt, width, unit->unitX, roundf(unit->unitY)))
         {
             switch (unit->unitType)
             {
@@ -1395,17 +2913,19 @@ static void DE_GravityLowerUnit(const SDL_Surface * destructInternalScreen, stru
                 unit->unitY += 1;
             }
 
-            if (unit->unitY > 199) /* could be possible */
-                unit->unitY = 199;
+            if (unit->unitY > bottom) /* could be possible */
+                unit->unitY = bottom;
         }
     }
 }
 
-static void DE_GravityFlyUnit(const SDL_Surface * destructInternalScreen, struct destruct_unit_s * unit)
+static void DE_GravityFlyUnit(const struct destruct_match_s * match, struct destruct_unit_s * unit)
 {
-    if (unit->unitY + unit->unitYMov > 199) /* would hit bottom of screen */
+    const unsigned int bottom = match->terrain.height - 1;
+
+    if (unit->unitY + unit->unitYMov > bottom) /* would hit bottom of the map */
     {
-        unit->unitY = 199;
+        unit->unitY = bottom;
         unit->unitYMov = 0;
         unit->isYInAir = false;
         return;
@@ -1424,19 +2944,21 @@ static void DE_GravityFlyUnit(const SDL_Surface * destructInternalScreen, struct
     else
         unit->unitYMov += 0.03f;
 
-    if (!JE_stabilityCheck(destructInternalScreen, unit->unitX, roundf(unit->unitY)))
+    if (!JE_stabilityCheck(match->dirt, match->terrain.width, unit->unitX, roundf(unit->unitY)))
     {
         unit->unitYMov = 0;
         unit->isYInAir = false;
     }
 }
 
-static void DE_RunTickAnimate(const struct destruct_config_s * config, struct destruct_player_s * destruct_player)
+static void DE_RunTickAnimate(struct destruct_match_s * match)
 {
+    const struct destruct_config_s * config = &match->config;
+    struct destruct_player_s * destruct_player = match->destruct_player;
     unsigned int p, u;
     struct destruct_unit_s * ptr;
 
-    for (p = 0; p < MAX_PLAYERS; ++p)
+    for (p = 0; p < match->config.players; ++p)
     {
         ptr = destruct_player[p].unit;
         for (u = 0; u < config->max_installations; ++u, ++ptr)
@@ -1454,30 +2976,45 @@ static void DE_RunTickAnimate(const struct destruct_config_s * config, struct de
     }
 }
 
-static void DE_RunTickDrawWalls(const struct destruct_config_s * config, struct destruct_world_s * world)
+static void DE_RunTickDrawWalls(struct destruct_match_s * match)
 {
+    const struct destruct_config_s * config = &match->config;
+    const struct destruct_world_s * world = &match->world;
     unsigned int i;
+    int x, y;
 
     for (i = 0; i < config->max_walls; i++)
     {
         if (world->mapWalls[i].wallExist)
         {
-            blit_sprite2(world->VGAScreen, world->mapWalls[i].wallX, world->mapWalls[i].wallY, destructSpriteSheet, 42);
+            x = world->mapWalls[i].wallX - match->viewX;
+            y = world->mapWalls[i].wallY - match->viewY;
+            if (DE_DrawnRect(match, x, y, DE_SPRITE_WIDTH, DE_SPRITE_HEIGHT) == true)
+                blit_sprite2_clip(world->VGAScreen, x, y, destructSpriteSheet, 42);
         }
     }
 }
 
-static void DE_RunTickExplosions(const struct destruct_config_s * config,
-                                 struct destruct_player_s * destruct_player,
-                                 struct destruct_explo_s * exploRec,
-                                 const SDL_Surface * destructInternalScreen)
+static void DE_RunTickExplosions(struct destruct_match_s * match)
 {
+    const struct destruct_config_s * config = &match->config;
+    struct destruct_explo_s * exploRec = match->exploRec;
+    const unsigned int width = match->terrain.width, height = match->terrain.height;
     unsigned int i, j;
     int tempPosX, tempPosY;
     float tempRadian;
 
-    /* Run through all open explosions.  They are not sorted in any way */
-    for (i = 0; i < config->max_explosions; i++)
+    if (config->rules >= RULES_FLARE_TABLES)
+    {
+        DE_RunTickFlares(match);
+        return;
+    }
+
+    /* Run through all open explosions.  They are not sorted in any way.
+     * This goes by slot rather than down exploActive, as ones set off by a
+     * flare join in if they land in a later slot; the pool doesn't grow
+     * under these rules, so exploRec stays put. */
+    for (i = 0; i < match->exploCapacity; i++)
     {
         if (exploRec[i].isAvailable == true)
             continue;  /* Nothing to do */
@@ -1486,269 +3023,579 @@ static void DE_RunTickExplosions(const struct destruct_config_s * config,
         {
             /* An explosion is comprised of multiple 'flares' that fan out.
                Calculate where this 'flare' will end up */
-            tempRadian = mt_rand_lt1() * (2 * M_PI);
-            tempPosY = exploRec[i].y + roundf(cosf(tempRadian) * mt_rand_lt1() * exploRec[i].explowidth);
-            tempPosX = exploRec[i].x + roundf(sinf(tempRadian) * mt_rand_lt1() * exploRec[i].explowidth);
+            tempRadian = DE_RandLt1(match, STREAM_EXPLOSIONS) * (2 * M_PI);
+            tempPosY = exploRec[i].y + roundf(cosf(tempRadian) * DE_RandLt1(match, STREAM_EXPLOSIONS) * exploRec[i].explowidth);
+            tempPosX = exploRec[i].x + roundf(sinf(tempRadian) * DE_RandLt1(match, STREAM_EXPLOSIONS) * exploRec[i].explowidth);
 
             /* Our game allows explosions to wrap around.  This looks to have
              * originally been a bug that was left in as being fun, but we are
              * going to replicate it w/o risking out of bound arrays. */
 
             while (tempPosX < 0)
-                tempPosX += vga_width;
-            while (tempPosX > vga_width)
-                tempPosX -= vga_width;
+                tempPosX += (int)width;
+            while (tempPosX > (int)width)
+                tempPosX -= (int)width;
 
             /* We don't draw our explosion if it's out of bounds vertically */
-            if (tempPosY >= vga_height || tempPosY <= 15)
+            if (tempPosY >= (int)height || tempPosY <= 15)
                 continue;
 
-            /* And now the drawing.  There are only two types of explosions
-             * right now; dirt and flares.  Dirt simply draws a brown pixel;
-             * flares explode and have a star formation. */
-            switch (exploRec[i].exploType)
-            {
-                case EXPL_DIRT:
-                    ((Uint8 *)destructInternalScreen->pixels)[tempPosX + tempPosY * destructInternalScreen->pitch] = PIXEL_DIRT;
-                    break;
-
-                case EXPL_NORMAL:
-                    JE_superPixel(destructInternalScreen, tempPosX, tempPosY);
-                    DE_TestExplosionCollision(config, destruct_player, exploRec, tempPosX, tempPosY);
-                    break;
-
-                default:
-                    assert(false);
-                    break;
-            }
+            DE_DrawFlare(match, exploRec[i].exploType, tempPosX, tempPosY);
         }
 
         /* Widen the explosion and delete it if necessary. */
         exploRec[i].explowidth++;
         if (exploRec[i].explowidth == exploRec[i].explomax)
         {
-            exploRec[i].isAvailable = true;
+            DE_FreeExplosion(match, i);
+            DE_UnlistExplosion(match, i);
         }
     }
 }
 
-static void DE_TestExplosionCollision(const struct destruct_config_s * config,
-                                      struct destruct_player_s * destruct_player,
-                                      struct destruct_explo_s * exploRec,
+/* DE_RunTickFlares
+ *
+ * DE_RunTickExplosions the way the rules have it since RULES_FLARE_TABLES:
+ * every live explosion's flares for the tick are placed in one go, then
+ * drawn in another.  A flare takes a single draw from the generator, split
+ * into a direction out of the table and a distance each way.  The drawing
+ * goes a band of rows at a time, top to bottom, keeping the order flares
+ * came in within a band.  Explosions set off along the way (units blowing
+ * up) start flaring on the next tick.
+ *
+ * The explosions are gone through down exploActive, which is packed
+ * together again as the finished ones drop out of it.
+ */
+static void DE_RunTickFlares(struct destruct_match_s * match)
+{
+    struct destruct_explo_s * exploRec = match->exploRec;
+    unsigned int * exploActive = match->exploActive;
+    struct destruct_flare_s * flares, * sortedFlares;
+    const float * flareSin = match->flareSin;
+    const Uint32 * draws;
+    const unsigned int worldWidth = match->terrain.width, worldHeight = match->terrain.height;
+    const unsigned int bands = match->terrain.rows;
+    unsigned int bandStart[DE_MAX_WORLD_HEIGHT / DE_TILE_HEIGHT + 1];
+    unsigned int i, j, k, live, count, band;
+    Uint32 r;
+    int tempPosX, tempPosY;
+    float width;
+
+    /* The generator gets a loop to itself, for every flare at once */
+    count = 0;
+    for (k = 0; k < match->exploCount; k++)
+    {
+        count += exploRec[exploActive[k]].explofill;
+    }
+    if (count > match->flareCapacity)
+    {
+        match->flareCapacity = MAX(count, 2 * match->flareCapacity);
+        free(match->flares);
+        free(match->sortedFlares);
+        free(match->flareDraws);
+        match->flares = malloc(match->flareCapacity * sizeof(*match->flares));
+        match->sortedFlares = malloc(match->flareCapacity * sizeof(*match->sortedFlares));
+        match->flareDraws = malloc(match->flareCapacity * sizeof(*match->flareDraws));
+        if (match->flares == NULL || match->sortedFlares == NULL || match->flareDraws == NULL)
+            exit(EXIT_FAILURE);  // out of memory
+    }
+    flares = match->flares;
+    sortedFlares = match->sortedFlares;
+    draws = match->flareDraws;
+    DE_RandFill(match, STREAM_EXPLOSIONS, match->flareDraws, count);
+
+    count = 0;
+    live = 0;
+    for (k = 0; k < match->exploCount; k++)
+    {
+        i = exploActive[k];
+        width = exploRec[i].explowidth * (1.0f / 2048);
+        for (j = 0; j < exploRec[i].explofill; j++)
+        {
+            /* 10 bits of direction and 11 bits of distance each way */
+            r = *draws++;
+            tempPosY = exploRec[i].y + roundf(flareSin[(r & (DE_FLARE_ANGLES - 1)) + DE_FLARE_ANGLES / 4] * ((r >> 10) & 0x7ff) * width);
+            tempPosX = exploRec[i].x + roundf(flareSin[r & (DE_FLARE_ANGLES - 1)] * (r >> 21) * width);
+
+            /* Wrapped around and kept off the top and bottom, as before */
+            while (tempPosX < 0)
+                tempPosX += (int)worldWidth;
+            while (tempPosX > (int)worldWidth)
+                tempPosX -= (int)worldWidth;
+            if (tempPosY >= (int)worldHeight || tempPosY <= 15)
+                continue;
+
+            flares[count].x = tempPosX;
+            flares[count].y = tempPosY;
+            flares[count].exploType = exploRec[i].exploType;
+            count++;
+        }
+
+        /* Widen the explosion and delete it if necessary. */
+        exploRec[i].explowidth++;
+        if (exploRec[i].explowidth == exploRec[i].explomax)
+            DE_FreeExplosion(match, i);
+        else
+            exploActive[live++] = i;
+    }
+    match->exploCount = live;
+
+    if (count == 0)
+        return;
+
+    /* Counting sort into bands of DE_TILE_HEIGHT rows, so the stars go down
+     * the screen instead of all over it */
+    memset(bandStart, 0, sizeof(*bandStart) * (bands + 1));
+    for (i = 0; i < count; i++)
+        bandStart[flares[i].y / DE_TILE_HEIGHT + 1]++;
+    for (band = 0; band < bands; band++)
+        bandStart[band + 1] += bandStart[band];
+    for (i = 0; i < count; i++)
+        sortedFlares[bandStart[flares[i].y / DE_TILE_HEIGHT]++] = flares[i];
+
+    for (i = 0; i < count; i++)
+        DE_DrawFlare(match, sortedFlares[i].exploType, sortedFlares[i].x, sortedFlares[i].y);
+}
+
+/* And now the drawing.  There are only two types of explosions right now;
+ * dirt and flares.  Dirt simply draws a brown pixel; flares explode and
+ * have a star formation. */
+static void DE_DrawFlare(struct destruct_match_s * match, enum de_expl_t exploType, unsigned int x, unsigned int y)
+{
+    struct destruct_terrain_s * terrain = &match->terrain;
+
+    switch (exploType)
+    {
+        case EXPL_DIRT:
+            /* A flare on the right edge lands on the start of the next row,
+             * as it always has */
+            if (x == terrain->width)
+            {
+                x = 0;
+                y++;
+            }
+            if (y < terrain->height)
+                DE_SetTerrainPixel(match, DE_TerrainAt(terrain, x, y), x, y, PIXEL_DIRT);
+            break;
+
+        case EXPL_NORMAL:
+            JE_superPixel(match, x, y);
+            DE_TestExplosionCollision(match, x, y);
+            break;
+
+        default:
+            assert(false);
+            break;
+    }
+}
+
+static void DE_TestExplosionCollision(struct destruct_match_s * match,
                                       unsigned int PosX,
                                       unsigned int PosY)
 {
-    unsigned int i, j;
+    const struct destruct_config_s * config = &match->config;
+    const struct destruct_grid_s * grid = &match->unitGrid;
+    int e;
     struct destruct_unit_s * unit;
 
-    for (i = PLAYER_LEFT; i < MAX_PLAYERS; i++)
+    /* Only the units in this square can be hit, and the grid lists them in
+     * the same order as looping over all of them would. */
+    if (DE_IsDirt(match->unitPlane, match->terrain.width, PosX, PosY) == false)
+        return;
+    for (e = grid->head[DE_GridCell(grid, PosX, PosY)]; e >= 0; e = grid->next[e])
     {
-        unit = destruct_player[i].unit;
-        for (j = 0; j < config->max_installations; j++, unit++)
+        unit = match->gridUnit[grid->item[e]];
+        if (DE_isValidUnit(unit) == true &&
+            PosX > unit->unitX && PosX < unit->unitX + 11 &&
+            PosY < unit->unitY && PosY > unit->unitY - 11)
         {
-            if (DE_isValidUnit(unit) == true &&
-                PosX > unit->unitX && PosX < unit->unitX + 11 &&
-                PosY < unit->unitY && PosY > unit->unitY - 11)
+            unit->health--;
+            if (unit->health <= 0)
             {
-                unit->health--;
-                if (unit->health <= 0)
-                {
-                    DE_DestroyUnit(config, destruct_player, exploRec, i, unit);
-                }
+                DE_DestroyUnit(match, grid->item[e] / config->max_installations, unit);
             }
         }
     }
 }
 
-static void DE_DestroyUnit(const struct destruct_config_s * config,
-                           struct destruct_player_s * destruct_player,
-                           struct destruct_explo_s * exploRec,
+static void DE_DestroyUnit(struct destruct_match_s * match,
                            enum de_player_t playerID,
                            struct destruct_unit_s * unit)
 {
+    struct destruct_player_s * destruct_player = match->destruct_player;
     /* This function call was an evil evil piece of brilliance before.  Go on.
      * Look at the older revisions.  It passed the result of a comparison.
      * MULTIPLIED.  This is at least a little clearer... */
-    JE_makeExplosion(config,
-                     exploRec,
+    JE_makeExplosion(match,
                      unit->unitX + 5,
                      roundf(unit->unitY) - 5,
                      (unit->unitType == UNIT_HELI) ? SHOT_SMALL : SHOT_INVALID /* Helicopters explode like small shots do.  Invalids are their own special case. */);
 
     if (unit->unitType != UNIT_SATELLITE) /* increment score */
-    { /* todo: change when teams are created. Hacky kludge for now.*/
+    {
         destruct_player[playerID].unitsRemaining--;
-        destruct_player[((playerID == PLAYER_LEFT) ? PLAYER_RIGHT : PLAYER_LEFT)].score++;
+        destruct_player[DE_Opponent(match, playerID)].score++;
     }
 }
 
-static void DE_RunTickShots(const struct destruct_config_s * config,
-                            struct destruct_player_s * destruct_player,
-                            struct destruct_shot_s * shotRec,
-                            struct destruct_explo_s * exploRec,
-                            struct destruct_world_s * world,
-                            const SDL_Surface * destructInternalScreen)
+/* DE_RunTickShots
+ *
+ * Moves every shot first, the falling ones and the bouncing ones a batch
+ * each, then goes through them in slot order for what they hit.  Moving a
+ * shot only looks at the shot itself, so splitting the two doesn't change
+ * anything.  The one random number it takes, for a shot that comes off the
+ * floor straight up, is drawn in the second pass to keep the order.
+ */
+static void DE_RunTickShots(struct destruct_match_s * match)
 {
-    unsigned int i, j, k;
+    const struct destruct_config_s * config = &match->config;
+    struct destruct_shot_s * shotRec = match->shotRec;
+    float * x = match->shotMotion.x, * y = match->shotMotion.y;
+    float * xmov = match->shotMotion.xmov, * ymov = match->shotMotion.ymov;
+    struct destruct_world_s * world = &match->world;
+    const struct destruct_grid_s * unitGrid = &match->unitGrid;
+    const struct destruct_grid_s * wallGrid = &match->wallGrid;
+    unsigned int i, j, w, falling, bouncing;
+    int e;
+    Uint64 bits;
     unsigned int tempTrails;
-    unsigned int tempPosX, tempPosY;
+    unsigned int tempPosX, tempPosY, hitX, hitY;
     struct destruct_unit_s * unit;
 
-    for (i = 0; i < config->max_shots; i++)
+    /* The falling shots from the front of shotBatch, the bouncing ones from
+     * the back */
+    falling = 0;
+    bouncing = config->max_shots;
+    for (w = 0; w < DE_SHOT_WORDS(config->max_shots); w++)
     {
-        if (shotRec[i].isAvailable == true)
-            continue;  /* Nothing to do */
-
-        /* Move the shot.  Simple displacement */
-        shotRec[i].x += shotRec[i].xmov;
-        shotRec[i].y += shotRec[i].ymov;
-
-        /* If the shot can bounce off the map, bounce it */
-        if (shotBounce[shotRec[i].shottype])
+        for (bits = match->shotLive[w]; bits != 0; bits &= bits - 1)
         {
-            if (shotRec[i].y > 199 || shotRec[i].y < 14)
-            {
-                shotRec[i].y -= shotRec[i].ymov;
-                shotRec[i].ymov = -shotRec[i].ymov;
-            }
-            if (shotRec[i].x < 1 || shotRec[i].x > 318)
-            {
-                shotRec[i].x -= shotRec[i].xmov;
-                shotRec[i].xmov = -shotRec[i].xmov;
-            }
+            i = w * 64 + __builtin_ctzll(bits);
+            match->shotFromX[i] = x[i];
+            match->shotFromY[i] = y[i];
+            if (shotBounce[shotRec[i].shottype])
+                match->shotBatch[--bouncing] = i;
+            else
+                match->shotBatch[falling++] = i;
         }
-        else /* If it cannot, apply normal physics */
+    }
+    DE_MoveShots(match, match->shotBatch, falling);
+    DE_BounceShots(match, match->shotBatch + bouncing, config->max_shots - bouncing);
+
+    for (w = 0; w < DE_SHOT_WORDS(config->max_shots); w++)
+    {
+        for (bits = match->shotLive[w]; bits != 0; bits &= bits - 1)
         {
-            shotRec[i].ymov += 0.05f; /* add gravity */
+            i = w * 64 + __builtin_ctzll(bits);
 
-            if (shotRec[i].y > 199) /* We hit the floor */
-            {
-                shotRec[i].y -= shotRec[i].ymov;
-                shotRec[i].ymov = -shotRec[i].ymov * 0.8f; /* bounce at reduced velocity */
+            /* Don't allow a bouncing shot to bounce straight up and down */
+            if (shotBounce[shotRec[i].shottype] == false && match->shotFloor[i] == true && xmov[i] == 0)
+                xmov[i] += DE_RandLt1(match, STREAM_SHOTS) - 0.5f;
 
-                /* Don't allow a bouncing shot to bounce straight up and down */
-                if (shotRec[i].xmov == 0)
-                    shotRec[i].xmov += mt_rand_lt1() - 0.5f;
+            /* Shot has gone out of bounds. Eliminate it. */
+            if (x[i] > match->terrain.width - 2 || x[i] < 1)
+            {
+                DE_FreeShot(match, i);
+                continue;
             }
-        }
-
-        /* Shot has gone out of bounds. Eliminate it. */
-        if (shotRec[i].x > 318 || shotRec[i].x < 1)
-        {
-            shotRec[i].isAvailable = true;
-            continue;
-        }
 
-        /* Now check for collisions. */
+            /* Now check for collisions. */
 
-        /* Don't bother checking for collisions above the map :) */
-        if (shotRec[i].y <= 14)
-            continue;
+            /* Don't bother checking for collisions above the map :) */
+            if (y[i] <= 14)
+                continue;
 
-        tempPosX = roundf(shotRec[i].x);
-        tempPosY = roundf(shotRec[i].y);
+            tempPosX = roundf(x[i]);
+            tempPosY = roundf(y[i]);
 
-        /*Check building hits*/
-        for (j = 0; j < MAX_PLAYERS; j++)
-        {
-            unit = destruct_player[j].unit;
-            for (k = 0; k < config->max_installations; k++, unit++)
+            /*Check building hits*/
+            for (e = unitGrid->head[DE_GridCell(unitGrid, tempPosX, tempPosY)]; e >= 0; e = unitGrid->next[e])
             {
+                unit = match->gridUnit[unitGrid->item[e]];
                 if (DE_isValidUnit(unit) == false)
                     continue;
 
                 if (tempPosX > unit->unitX && tempPosX < unit->unitX + 11 &&
                     tempPosY < unit->unitY && tempPosY > unit->unitY - 13)
                 {
-                    shotRec[i].isAvailable = true;
-                    JE_makeExplosion(config, exploRec, tempPosX, tempPosY, shotRec[i].shottype);
+                    DE_FreeShot(match, i);
+                    JE_makeExplosion(match, tempPosX, tempPosY, shotRec[i].shottype);
                 }
             }
-        }
 
-        tempTrails = (shotColor[shotRec[i].shottype] << 4) - 3;
-        JE_pixCool(tempPosX, tempPosY, tempTrails, world->VGAScreen);
-
-        /*Draw the shot trail (if applicable) */
-        switch (shotTrail[shotRec[i].shottype])
-        {
-        case TRAILS_NONE:
-            break;
-        case TRAILS_NORMAL:
-            DE_DrawTrails(&(shotRec[i]), 2, 4, tempTrails - 3, world->VGAScreen);
-            break;
-        case TRAILS_FULL:
-            DE_DrawTrails(&(shotRec[i]), 4, 3, tempTrails - 1, world->VGAScreen);
-            break;
-        }
+            /* Move the shot trail along (if applicable).  DE_DrawShot draws it. */
+            tempTrails = (shotColor[shotRec[i].shottype] << 4) - 3;
+            switch (shotTrail[shotRec[i].shottype])
+            {
+            case TRAILS_NONE:
+                break;
+            case TRAILS_NORMAL:
+                DE_DrawTrails(&(shotRec[i]), x[i], y[i], 2, 4, tempTrails - 3);
+                break;
+            case TRAILS_FULL:
+                DE_DrawTrails(&(shotRec[i]), x[i], y[i], 4, 3, tempTrails - 1);
+                break;
+            }
 
-        /* Bounce off of or destroy walls */
-        for (j = 0; j < config->max_walls; j++)
-        {
-            if (world->mapWalls[j].wallExist == true &&
-                tempPosX >= world->mapWalls[j].wallX && tempPosX <= world->mapWalls[j].wallX + 11 &&
-                tempPosY >= world->mapWalls[j].wallY && tempPosY <= world->mapWalls[j].wallY + 14)
+            /* Bounce off of or destroy walls.  Bouncing leaves the shot where
+             * it is, so it stays in the same square. */
+            for (e = wallGrid->head[DE_GridCell(wallGrid, tempPosX, tempPosY)]; e >= 0; e = wallGrid->next[e])
             {
-                if (demolish[shotRec[i].shottype])
+                j = wallGrid->item[e];
+                if (world->mapWalls[j].wallExist == true &&
+                    tempPosX >= world->mapWalls[j].wallX && tempPosX <= world->mapWalls[j].wallX + 11 &&
+                    tempPosY >= world->mapWalls[j].wallY && tempPosY <= world->mapWalls[j].wallY + 14)
                 {
-                    /* Blow up the wall and remove the shot. */
-                    world->mapWalls[j].wallExist = false;
-                    shotRec[i].isAvailable = true;
-                    JE_makeExplosion(config, exploRec, tempPosX, tempPosY, shotRec[i].shottype);
-                    continue;
-                }
-                else
-                {
-                    /* Otherwise, bounce. */
-                    if (shotRec[i].x - shotRec[i].xmov < world->mapWalls[j].wallX ||
-                        shotRec[i].x - shotRec[i].xmov > world->mapWalls[j].wallX + 11)
+                    if (demolish[shotRec[i].shottype])
                     {
-                        shotRec[i].xmov = -shotRec[i].xmov;
+                        /* Blow up the wall and remove the shot. */
+                        world->mapWalls[j].wallExist = false;
+                        DE_FreeShot(match, i);
+                        JE_makeExplosion(match, tempPosX, tempPosY, shotRec[i].shottype);
+                        continue;
                     }
-                    if (shotRec[i].y - shotRec[i].ymov < world->mapWalls[j].wallY ||
-                        shotRec[i].y - shotRec[i].ymov > world->mapWalls[j].wallY + 14)
+                    else
                     {
-                        if (shotRec[i].ymov < 0)
-                            shotRec[i].ymov = -shotRec[i].ymov;
-                        else
-                            shotRec[i].ymov = -shotRec[i].ymov * 0.8f;
+                        /* Otherwise, bounce. */
+                        if (x[i] - xmov[i] < world->mapWalls[j].wallX ||
+                            x[i] - xmov[i] > world->mapWalls[j].wallX + 11)
+                        {
+                            xmov[i] = -xmov[i];
+                        }
+                        if (y[i] - ymov[i] < world->mapWalls[j].wallY ||
+                            y[i] - ymov[i] > world->mapWalls[j].wallY + 14)
+                        {
+                            if (ymov[i] < 0)
+                                ymov[i] = -ymov[i];
+                            else
+                                ymov[i] = -ymov[i] * 0.8f;
+                        }
+
+                        tempPosX = roundf(x[i]);
+                        tempPosY = roundf(y[i]);
                     }
-
-                    tempPosX = roundf(shotRec[i].x);
-                    tempPosY = roundf(shotRec[i].y);
                 }
             }
-        }
 
-        /* Our last collision check, at least for now.  We hit dirt. */
-        if ((((Uint8 *)destructInternalScreen->pixels)[tempPosX + tempPosY * destructInternalScreen->pitch]) == PIXEL_DIRT)
-        {
-            shotRec[i].isAvailable = true;
-            JE_makeExplosion(config, exploRec, tempPosX, tempPosY, shotRec[i].shottype);
+            /* Our last collision check, at least for now.  We hit dirt.
+             * Since RULES_SWEPT that's the first dirt on the way here, so
+             * fast shots can't tunnel through thin ground. */
+            if (config->rules >= RULES_SWEPT)
+            {
+                if (DE_SweepDirt(match, match->shotFromX[i], match->shotFromY[i], x[i], y[i], &hitX, &hitY))
+                {
+                    DE_FreeShot(match, i);
+                    JE_makeExplosion(match, hitX, hitY, shotRec[i].shottype);
+                    continue;
+                }
+            }
+            /* Nothing above a column's surface can be */
+            else if (tempPosY >= match->surface[tempPosX] &&
+                     DE_IsDirt(match->dirt, match->terrain.width, tempPosX, tempPosY))
+            {
+                DE_FreeShot(match, i);
+                JE_makeExplosion(match, tempPosX, tempPosY, shotRec[i].shottype);
+                continue;
+            }
+        }
+    }
+
+    /* Shots stay put from here until the next tick, apart from new ones */
+    DE_ListShots(match);
+}
+
+/* DE_MoveShots
+ *
+ * Moves count shots of batch that fall: gravity, and back off the floor at
+ * 80% of the speed if they went into it, which shotFloor keeps track of.
+ */
+static void DE_MoveShots(struct destruct_match_s * match, const unsigned int * batch, unsigned int count)
+{
+    float * restrict x = match->shotMotion.x, * restrict y = match->shotMotion.y;
+    float * restrict ymov = match->shotMotion.ymov;
+    const float * restrict xmov = match->shotMotion.xmov;
+    Uint8 * restrict floor = match->shotFloor;
+    const float bottom = match->terrain.height - 1;
+    unsigned int k, i;
+    bool hit;
+
+    for (k = 0; k < count; k++)
+    {
+        i = batch[k];
+        x[i] += xmov[i];
+        y[i] += ymov[i];
+        ymov[i] += 0.05f; /* add gravity */
+
+        hit = y[i] > bottom;
+        y[i] -= hit ? ymov[i] : 0.0f;
+        ymov[i] = hit ? -ymov[i] * 0.8f : ymov[i];
+        floor[i] = hit;
+    }
+}
+
+/* DE_BounceShots
+ *
+ * Moves count shots of batch that bounce off the edges of the map.
+ */
+static void DE_BounceShots(struct destruct_match_s * match, const unsigned int * batch, unsigned int count)
+{
+    float * restrict x = match->shotMotion.x, * restrict y = match->shotMotion.y;
+    float * restrict xmov = match->shotMotion.xmov, * restrict ymov = match->shotMotion.ymov;
+    const float bottom = match->terrain.height - 1, right = match->terrain.width - 2;
+    unsigned int k, i;
+    bool hit;
+
+    for (k = 0; k < count; k++)
+    {
+        i = batch[k];
+        x[i] += xmov[i];
+        y[i] += ymov[i];
+
+        hit = y[i] > bottom || y[i] < 14;
+        y[i] -= hit ? ymov[i] : 0.0f;
+        ymov[i] = hit ? -ymov[i] : ymov[i];
+
+        hit = x[i] < 1 || x[i] > right;
+        x[i] -= hit ? xmov[i] : 0.0f;
+        xmov[i] = hit ? -xmov[i] : xmov[i];
+    }
+}
+
+/* DE_SweepDirt
+ *
+ * The first dirt on the line from (x0, y0) to (x1, y1), looking at each
+ * pixel the line passes the way a shot looks at the one it ends up on, with
+ * no collisions above the map.  Empty blocks and regions are skipped whole.
+ * The start was looked at the tick before, so it isn't again.  Returns
+ * whether there's any, with the pixel in *hitX, *hitY.
+ */
+static bool DE_SweepDirt(const struct destruct_match_s * match, float x0, float y0, float x1, float y1,
+                         unsigned int * hitX, unsigned int * hitY)
+{
+    const struct destruct_terrain_s * terrain = &match->terrain;
+    const float dx = x1 - x0, dy = y1 - y0;
+    const unsigned int steps = MAX(MAX(ceilf(fabsf(dx)), ceilf(fabsf(dy))), 1.0f);
+    unsigned int k, px, py, size, next;
+    float fx, fy, tx, ty;
+
+    for (k = 1; k <= steps; )
+    {
+        /* The end exactly where the shot is, not a rounding error away */
+        fx = (k == steps) ? x1 : x0 + dx * k / steps;
+        fy = (k == steps) ? y1 : y0 + dy * k / steps;
+        px = roundf(fx);
+        py = roundf(fy);
+        if (fy <= 14 || fx < 0 || px >= terrain->width || py >= terrain->height)
+        {
+            k++;
+            continue;
+        }
+
+        size = DE_EmptySquare(match, px, py);
+        if (size == 0)
+        {
+            if (DE_IsDirt(match->dirt, terrain->width, px, py))
+            {
+                *hitX = px;
+                *hitY = py;
+                return true;
+            }
+            k++;
             continue;
         }
+
+        /* Every step before the line leaves the square rounds into it */
+        tx = (dx > 0) ? (px / size * size + size - 0.5f - x0) / dx :
+             (dx < 0) ? (px / size * size - 0.5f - x0) / dx : 1.0f;
+        ty = (dy > 0) ? (py / size * size + size - 0.5f - y0) / dy :
+             (dy < 0) ? (py / size * size - 0.5f - y0) / dy : 1.0f;
+        next = MIN(MIN(tx, ty), 1.0f) * steps;
+        k = MAX(k + 1, next);
+    }
+    return false;
+}
+
+/* DE_TraceShot
+ *
+ * Where a shot of type shottype at (x, y), moving (xmov, ymov) a tick, would
+ * first hit dirt in the next ticks ticks, moving and colliding the way shots
+ * do under RULES_SWEPT.  Units, walls, magnets and the nudge a shot gets
+ * when it's stuck bouncing straight up and down aren't taken into account.
+ * Returns the tick it would hit on, from 1, with the pixel in *hitX, *hitY,
+ * or 0 if it would leave the map or still be flying.
+ */
+unsigned int DE_TraceShot(const struct destruct_match_s * match, unsigned int shottype, float x, float y, float xmov, float ymov,
+                          unsigned int ticks, unsigned int * hitX, unsigned int * hitY)
+{
+    return DE_TraceFlight(match, shottype, x, y, xmov, ymov, 0, ticks, hitX, hitY);
+}
+
+/* DE_TraceShot for a shot that falls with drift added to its xmov every
+ * tick as well, which is roughly what magnets firing away do to it. */
+static unsigned int DE_TraceFlight(const struct destruct_match_s * match, unsigned int shottype, float x, float y, float xmov, float ymov,
+                                   float drift, unsigned int ticks, unsigned int * hitX, unsigned int * hitY)
+{
+    const float bottom = match->terrain.height - 1, right = match->terrain.width - 2;
+    float fromX, fromY;
+    unsigned int tick;
+
+    for (tick = 1; tick <= ticks; tick++)
+    {
+        fromX = x;
+        fromY = y;
+
+        /* As DE_MoveShots and DE_BounceShots have it */
+        x += xmov;
+        y += ymov;
+        if (shotBounce[shottype])
+        {
+            if (y > bottom || y < 14)
+            {
+                y -= ymov;
+                ymov = -ymov;
+            }
+            if (x < 1 || x > right)
+            {
+                x -= xmov;
+                xmov = -xmov;
+            }
+        }
+        else
+        {
+            ymov += 0.05f;
+            xmov += drift;
+            if (y > bottom)
+            {
+                y -= ymov;
+                ymov = -ymov * 0.8f;
+            }
+        }
+
+        if (x > right || x < 1)
+            return 0;
+        if (y > 14 && DE_SweepDirt(match, fromX, fromY, x, y, hitX, hitY))
+            return tick;
     }
+    return 0;
 }
 
 static void DE_DrawTrails(struct destruct_shot_s * shot,
+                          float x,
+                          float y,
                           unsigned int count,
                           unsigned int decay,
-                          unsigned int startColor,
-                          SDL_Surface * screen)
+                          unsigned int startColor)
 {
     int i;
 
-    for (i = count-1; i >= 0; i--) /* going in reverse is important as it affects how we draw */
+    /* Despite the name this only moves the trail along; the drawing happens
+     * in DE_DrawShot. */
+    for (i = count-1; i >= 0; i--) /* going in reverse is important, each trail takes the one before it */
     {
-        if (shot->trailc[i] > 0 && shot->traily[i] > 12) /* If it exists and if it's not out of bounds, draw it. */
-        {
-            JE_pixCool(shot->trailx[i], shot->traily[i], shot->trailc[i], screen);
-        }
-
         if (i == 0) /* The first trail we create. */
         {
-            shot->trailx[i] = roundf(shot->x);
-            shot->traily[i] = roundf(shot->y);
+            shot->trailx[i] = roundf(x);
+            shot->traily[i] = roundf(y);
             shot->trailc[i] = startColor;
         }
         else /* The newer trails decay into the older trails.*/
@@ -1763,27 +3610,88 @@ static void DE_DrawTrails(struct destruct_shot_s * shot,
     }
 }
 
-static void DE_RunTickAI(const struct destruct_config_s * config, struct destruct_player_s * destruct_player)
+static void DE_DrawShot(struct destruct_match_s * match, unsigned int index, float alpha)
+{
+    SDL_Surface * screen = match->world.VGAScreen;
+    const struct destruct_shot_s * prev = &match->prevShotRec[index], * cur = &match->shotRec[index];
+    const float prevX = match->prevShotMotion.x[index], prevY = match->prevShotMotion.y[index];
+    const float curX = match->shotMotion.x[index], curY = match->shotMotion.y[index];
+    float x = curX, y = curY;
+    unsigned int color = (shotColor[cur->shottype] << 4) - 3;
+    int i, count, sx, sy;
+
+    /* Shots that were just fired start out where they are */
+    if (prev->isAvailable == false && prev->shottype == cur->shottype &&
+        fabsf(curX - prevX) <= 16 && fabsf(curY - prevY) <= 16)
+    {
+        x = prevX + (curX - prevX) * alpha;
+        y = prevY + (curY - prevY) * alpha;
+    }
+
+    /* Nothing gets drawn above the map */
+    if (curY <= 14)
+        return;
+
+    /* JE_pix only clips the right and bottom edges */
+    sx = (int)roundf(x) - match->viewX;
+    sy = (int)roundf(y) - match->viewY;
+    if (sx >= 1 && sy >= 1 && DE_DrawnRect(match, sx - 1, sy - 1, 3, 3) == true)
+        JE_pixCool(sx, sy, color, screen);
+
+    /* Trail 0 is where the shot is now, so it's covered by the shot itself. */
+    count = (shotTrail[cur->shottype] == TRAILS_FULL) ? 4 : (shotTrail[cur->shottype] == TRAILS_NORMAL) ? 2 : 0;
+    for (i = count-1; i >= 1; i--) /* going in reverse is important as it affects how we draw */
+    {
+        if (cur->trailc[i] > 0 && cur->traily[i] > 12) /* If it exists and if it's not out of bounds, draw it. */
+        {
+            sx = cur->trailx[i] - match->viewX;
+            sy = cur->traily[i] - match->viewY;
+            if (sx >= 1 && sy >= 1 && DE_DrawnRect(match, sx - 1, sy - 1, 3, 3) == true)
+                JE_pixCool(sx, sy, cur->trailc[i], screen);
+        }
+    }
+}
+
+/* DE_Opponent
+ *
+ * The next player round from this one who is on the other team.  It is who
+ * the player's CPU goes after and who scores when the player loses a unit.
+ */
+static unsigned int DE_Opponent(const struct destruct_match_s * match, unsigned int player)
+{
+    unsigned int i = player;
+
+    do
+    {
+        i = (i + 1) % match->config.players;
+    }
+    while (match->destruct_player[i].team == match->destruct_player[player].team);
+    return i;
+}
+
+static void DE_RunTickAI(struct destruct_match_s * match)
 {
+    const struct destruct_config_s * config = &match->config;
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    const unsigned int width = match->terrain.width, ground = match->terrain.height - vga_height;
     unsigned int i, j;
     struct destruct_player_s * ptrPlayer, * ptrTarget;
     struct destruct_unit_s * ptrUnit, * ptrCurUnit;
 
-    for (i = 0; i < MAX_PLAYERS; i++)
+    for (i = 0; i < match->config.players; i++)
     {
         ptrPlayer = &(destruct_player[i]);
         if (ptrPlayer->is_cpu == false)
             continue;
 
-        /* I've been thinking, purely hypothetically, about what it would take
-         * to have multiple computer opponents.  The answer?  A lot of crap
-         * and a 'target' variable in the destruct_player struct. */
-        j = i + 1;
-        if (j >= MAX_PLAYERS)
-        {
-            j = 0;
-        }
+        /* The rollout AI takes the shots it has played out, the solver
+         * plays the units it can aim and the original AI the rest */
+        if (config->ai_level == AI_ROLLOUT && DE_RunTickRollout(match, i) == true)
+            continue;
+        if (config->ai_level >= AI_SOLVER && DE_RunTickSolver(match, i) == true)
+            continue;
 
+        j = DE_Opponent(match, i);
         ptrTarget  = &(destruct_player[j]);
         ptrCurUnit = &(ptrPlayer->unit[ptrPlayer->unitSelected]);
 
@@ -1794,9 +3702,9 @@ static void DE_RunTickAI(const struct destruct_config_s * config, struct destruc
         }
 
         /* Until all structs are properly divvied up this must only apply to player1 */
-        if (mt_rand() % 100 > 80)
+        if (DE_Rand(match, STREAM_AI + i) % 100 > 80)
         {
-            ptrPlayer->aiMemory.c_Angle += (mt_rand() % 3) - 1;
+            ptrPlayer->aiMemory.c_Angle += (DE_Rand(match, STREAM_AI + i) % 3) - 1;
 
             if (ptrPlayer->aiMemory.c_Angle > 1)
                 ptrPlayer->aiMemory.c_Angle = 1;
@@ -1804,7 +3712,7 @@ static void DE_RunTickAI(const struct destruct_config_s * config, struct destruc
             if (ptrPlayer->aiMemory.c_Angle < -1)
                 ptrPlayer->aiMemory.c_Angle = -1;
         }
-        if (mt_rand() % 100 > 90)
+        if (DE_Rand(match, STREAM_AI + i) % 100 > 90)
         {
             if (ptrPlayer->aiMemory.c_Angle > 0 && ptrCurUnit->angle > (M_PI_2) - (M_PI / 9))
                 ptrPlayer->aiMemory.c_Angle = 0;
@@ -1813,9 +3721,9 @@ static void DE_RunTickAI(const struct destruct_config_s * config, struct destruc
                 ptrPlayer->aiMemory.c_Angle = 0;
         }
 
-        if (mt_rand() % 100 > 93)
+        if (DE_Rand(match, STREAM_AI + i) % 100 > 93)
         {
-            ptrPlayer->aiMemory.c_Power += (mt_rand() % 3) - 1;
+            ptrPlayer->aiMemory.c_Power += (DE_Rand(match, STREAM_AI + i) % 3) - 1;
 
             if (ptrPlayer->aiMemory.c_Power > 1)
                 ptrPlayer->aiMemory.c_Power = 1;
@@ -1823,7 +3731,7 @@ static void DE_RunTickAI(const struct destruct_config_s * config, struct destruc
             if (ptrPlayer->aiMemory.c_Power < -1)
                 ptrPlayer->aiMemory.c_Power = -1;
         }
-        if (mt_rand() % 100 > 90)
+        if (DE_Rand(match, STREAM_AI + i) % 100 > 90)
         {
             if (ptrPlayer->aiMemory.c_Power > 0 && ptrCurUnit->power > 4)
                 ptrPlayer->aiMemory.c_Power = 0;
@@ -1852,30 +3760,31 @@ static void DE_RunTickAI(const struct destruct_config_s * config, struct destruc
             {
                 ptrPlayer->aiMemory.c_Power = 1;
             }
-            if (mt_rand() % ptrCurUnit->unitX > 100)
+            /* A helicopter can sit right on the left edge */
+            if (DE_Rand(match, STREAM_AI + i) % MAX(ptrCurUnit->unitX, 1u) > 100)
             {
                 ptrPlayer->aiMemory.c_Power = 1;
             }
-            if (mt_rand() % 240 > ptrCurUnit->unitX)
+            if (DE_Rand(match, STREAM_AI + i) % (width * 3 / 4) > ptrCurUnit->unitX)
             {
                 ptrPlayer->moves.actions[MOVE_RIGHT] = true;
             }
-            else if ((mt_rand() % 20) + 300 < ptrCurUnit->unitX)
+            else if ((DE_Rand(match, STREAM_AI + i) % 20) + width - 20 < ptrCurUnit->unitX)
             {
                 ptrPlayer->moves.actions[MOVE_LEFT] = true;
             }
-            else if (mt_rand() % 30 == 1)
+            else if (DE_Rand(match, STREAM_AI + i) % 30 == 1)
             {
-                ptrPlayer->aiMemory.c_Angle = (mt_rand() % 3) - 1;
+                ptrPlayer->aiMemory.c_Angle = (DE_Rand(match, STREAM_AI + i) % 3) - 1;
             }
-            if (ptrCurUnit->unitX > 295 && ptrCurUnit->lastMove > 1)
+            if (ptrCurUnit->unitX > width - 25 && ptrCurUnit->lastMove > 1)
             {
                 ptrPlayer->moves.actions[MOVE_LEFT] = true;
                 ptrPlayer->moves.actions[MOVE_RIGHT] = false;
             }
-            if (ptrCurUnit->unitType != UNIT_HELI || ptrCurUnit->lastMove > 3 || (ptrCurUnit->unitX > 160 && ptrCurUnit->lastMove > -3))
+            if (ptrCurUnit->unitType != UNIT_HELI || ptrCurUnit->lastMove > 3 || (ptrCurUnit->unitX > width / 2 && ptrCurUnit->lastMove > -3))
             {
-                if (mt_rand() % (int)roundf(ptrCurUnit->unitY) < 150 && ptrCurUnit->unitYMov < 0.01f && (ptrCurUnit->unitX < 160 || ptrCurUnit->lastMove < 2))
+                if (DE_Rand(match, STREAM_AI + i) % (int)roundf(ptrCurUnit->unitY) < 150 + ground && ptrCurUnit->unitYMov < 0.01f && (ptrCurUnit->unitX < width / 2 || ptrCurUnit->lastMove < 2))
                     ptrPlayer->moves.actions[MOVE_FIRE] = true;
                 ptrPlayer->aiMemory.c_noDown = (5 - abs(ptrCurUnit->lastMove)) * (5 - abs(ptrCurUnit->lastMove)) + 3;
                 ptrPlayer->aiMemory.c_Power = 1;
@@ -1913,7 +3822,7 @@ static void DE_RunTickAI(const struct destruct_config_s * config, struct destruc
             ptrPlayer->moves.actions[MOVE_FIRE] = 1;
         }
 
-        if (mt_rand() % 200 > 198)
+        if (DE_Rand(match, STREAM_AI + i) % 200 > 198)
         {
             ptrPlayer->moves.actions[MOVE_CHANGE] = true;
             ptrPlayer->aiMemory.c_Angle = 0;
@@ -1921,7 +3830,7 @@ static void DE_RunTickAI(const struct destruct_config_s * config, struct destruc
             ptrPlayer->aiMemory.c_Fire = 0;
         }
 
-        if (mt_rand() % 100 > 98 || ptrCurUnit->shotType == SHOT_TRACER)
+        if (DE_Rand(match, STREAM_AI + i) % 100 > 98 || ptrCurUnit->shotType == SHOT_TRACER)
         {
             ptrPlayer->moves.actions[MOVE_CYDN] = true;
         }
@@ -1960,521 +3869,3287 @@ static void DE_RunTickAI(const struct destruct_config_s * config, struct destruc
     }
 }
 
-static void DE_RunTickDrawCrosshairs(struct destruct_player_s * destruct_player, SDL_Surface * screen)
+/* DE_CanAim
+ *
+ * Whether the solver AI can play unit: it has to be alive, set its own
+ * angle and have a weapon that fires shots that blow up.
+ */
+static inline bool DE_CanAim(const struct destruct_unit_s * unit)
 {
-    unsigned int i;
-    int tempPosX, tempPosY;
-    int direction;
-    struct destruct_unit_s * curUnit;
+    return DE_isValidUnit(unit) == true && systemAngle[unit->unitType] == true &&
+           shotDirt[unit->shotType] == EXPL_NORMAL;
+}
 
-    /* Draw the crosshairs.  Most vehicles aim left or right.  Helis can aim
-     * either way and this must be accounted for.
-     */
-    for (i = 0; i < MAX_PLAYERS; i++)
+/* The enemy unit closest across to unit, as a unitGrid item, or -1 */
+static int DE_FindTarget(const struct destruct_match_s * match, unsigned int player, const struct destruct_unit_s * unit)
+{
+    const unsigned int opponent = DE_Opponent(match, player);
+    const struct destruct_unit_s * other = match->destruct_player[opponent].unit;
+    unsigned int j, distance, nearest = UINT_MAX;
+    int target = -1;
+
+    for (j = 0; j < match->config.max_installations; j++, other++)
     {
-        direction = (i == PLAYER_LEFT) ? -1 : 1;
-        curUnit = &(destruct_player[i].unit[destruct_player[i].unitSelected]);
+        if (DE_isValidUnit(other) == false)
+            continue;
 
-        if (curUnit->unitType == UNIT_HELI)
+        distance = abs((int)other->unitX - (int)unit->unitX);
+        if (distance < nearest)
         {
-            tempPosX = curUnit->unitX + roundf(0.1f * curUnit->lastMove * curUnit->lastMove * curUnit->lastMove) + 5;
-            tempPosY = roundf(curUnit->unitY) + 1;
+            nearest = distance;
+            target = opponent * match->config.max_installations + j;
         }
-        else
+    }
+    return target;
+}
+
+/* DE_SolveAim
+ *
+ * Works out aim for unit to hit (targetX, targetY).  A shot with gravity is
+ * at y0 + n * ymov + 0.05 * n * (n - 1) / 2 after n ticks, so for each of a
+ * spread of angles there is one power that gets it there, if any between 1
+ * and 5 does.  drift is what the enemy's magnets add to the shot's xmov a
+ * tick, spread out evenly, which pulls it up short the same way.  A shot
+ * that bounces flies straight, so there the angle is what's solved for.  Of
+ * the ones that reach, those that need the least turning and powering up are
+ * traced with DE_TraceFlight, and the first that
+ * gets there (or close enough for the explosion) without hitting the
+ * terrain is the aim.  If none of them do, the aim is the quickest one to
+ * line up, to blast a way through.
+ */
+static void DE_SolveAim(const struct destruct_match_s * match, const struct destruct_unit_s * unit, int direction,
+                        float targetX, float targetY, float drift, struct destruct_aim_s * aim)
+{
+    const float reach = exploSize[unit->shotType] / 2 + 6;
+    const float ax = drift * -direction; /* along the way it's fired */
+    float angle[DE_AIM_ANGLES + 1], power[DE_AIM_ANGLES + 1], ticks[DE_AIM_ANGLES + 1], cost[DE_AIM_ANGLES + 1];
+    float a, p, n, m, x0, y0, dx, k, best;
+    unsigned int count = 0, i, j, traces, hitX, hitY, pick;
+
+    if (shotBounce[unit->shotType] == true)
+    {
+        /* Aim straight at it.  Where the shot starts depends on the angle,
+         * but hardly, so a few goes settle it. */
+        p = unit->power;
+        a = unit->angle;
+        for (i = 0; i < 3; i++)
         {
-            tempPosX = roundf(curUnit->unitX + 6 - cosf(curUnit->angle) * (curUnit->power * 8 + 7) * direction);
-            tempPosY = roundf(curUnit->unitY - 7 - sinf(curUnit->angle) * (curUnit->power * 8 + 7));
+            x0 = unit->unitX + 6 - cosf(a) * 10 * direction;
+            y0 = unit->unitY - 7 - sinf(a) * 10;
+            a = atan2f(y0 - targetY, (targetX - x0) * -direction);
+        }
+        dx = (targetX - x0) * -direction;
+        if (dx > 0 && a >= 0 && a <= M_PI_2 - 0.01f)
+        {
+            angle[count] = a;
+            power[count] = p;
+            ticks[count] = dx / (p * cosf(a));
+            count++;
         }
+    }
+    else
+    {
+        /* The angle it has now, then a spread of them */
+        for (i = 0; i <= DE_AIM_ANGLES; i++)
+        {
+            a = (i == 0) ? unit->angle : (M_PI_2 - 0.02f) * i / DE_AIM_ANGLES;
+            x0 = unit->unitX + 6 - cosf(a) * 10 * direction;
+            y0 = unit->unitY - 7 - sinf(a) * 10;
+            dx = (targetX - x0) * -direction;
+            if (dx <= 0)
+                continue;
 
-        /* Draw it.  Clip away from the HUD though. */
-        if (tempPosY > 9)
+            /* After n ticks it has fallen m * 0.05 below the straight line
+             * it was fired along and been held back m * ax, where
+             * m = n * (n - 1) / 2 */
+            k = 0.05f + ax * tanf(a);
+            if (k <= 0)
+                continue;
+            m = (targetY - y0 + dx * tanf(a)) / k;
+            if (m < 0)
+                continue;
+            n = (1 + sqrtf(1 + 8 * m)) / 2;
+            p = (dx - ax * m) / (n * cosf(a));
+            if (p < 1 || p > 5)
+                continue;
+
+            angle[count] = a;
+            power[count] = p;
+            ticks[count] = n;
+            count++;
+        }
+    }
+
+    aim->valid = count > 0;
+    aim->clear = false;
+    if (count == 0)
+        return;
+
+    /* Ticks it takes to line each up, turning and powering up at once */
+    for (i = 0; i < count; i++)
+    {
+        cost[i] = MAX(fabsf(angle[i] - unit->angle) / 0.01f, fabsf(power[i] - unit->power) / 0.05f);
+    }
+
+    for (traces = 0; traces < MIN(count, (unsigned int)DE_AIM_TRACES); traces++)
+    {
+        pick = 0;
+        best = HUGE_VALF;
+        for (j = 0; j < count; j++)
         {
-            if (tempPosY > 11)
+            if (cost[j] < best)
             {
-                if (tempPosY > 13)
-                {
-                    /* Top pixel */
-                    JE_pix(screen, tempPosX,     tempPosY - 2,  3);
-                }
-                /* Middle three pixels */
-                JE_pix(screen, tempPosX + 3, tempPosY,      3);
-                JE_pix(screen, tempPosX,     tempPosY,     14);
-                JE_pix(screen, tempPosX - 3, tempPosY,      3);
+                best = cost[j];
+                pick = j;
             }
-            /* Bottom pixel */
-            JE_pix(screen, tempPosX,     tempPosY + 2,  3);
+        }
+        if (traces == 0)
+        {
+            aim->angle = angle[pick];
+            aim->power = power[pick];
+        }
+        cost[pick] = HUGE_VALF;
+
+        /* Up to the tick before it gets there */
+        a = angle[pick];
+        p = power[pick];
+        x0 = unit->unitX + 6 - cosf(a) * 10 * direction;
+        y0 = unit->unitY - 7 - sinf(a) * 10;
+        if (DE_TraceFlight(match, unit->shotType, x0, y0, -cosf(a) * p * direction, -sinf(a) * p,
+                           shotBounce[unit->shotType] ? 0 : drift, (unsigned int)ticks[pick], &hitX, &hitY) == 0 ||
+            ((hitX - targetX) * (hitX - targetX) + (hitY - targetY) * (hitY - targetY) <= reach * reach))
+        {
+            aim->angle = a;
+            aim->power = p;
+            aim->clear = true;
+            return;
         }
     }
 }
 
-static void DE_RunTickDrawHUD(struct destruct_player_s * destruct_player, SDL_Surface * screen)
+/* What the enemy's magnets add to the xmov of player's shots a tick, were
+ * they to fire nonstop: they push the shots back at us. */
+static float DE_MagnetDrift(const struct destruct_match_s * match, unsigned int player)
 {
+    const int direction = (match->destruct_player[player].team == TEAM_LEFT) ? -1 : 1;
+    const struct destruct_player_s * enemy;
+    const struct destruct_unit_s * magnet;
     unsigned int i;
-    unsigned int startX;
-    char tempstr[16]; /* Max size needed: 16 assuming 10 digit int max. */
-    struct destruct_unit_s * curUnit;
+    float drift = 0;
 
-    for (i = 0; i < MAX_PLAYERS; i++)
+    for (i = 0; i < match->config.players; i++)
     {
-        curUnit = &(destruct_player[i].unit[destruct_player[i].unitSelected]);
-        startX = ((i == PLAYER_LEFT) ? 0 : vga_width - 150);
+        enemy = &match->destruct_player[i];
+        magnet = &enemy->unit[enemy->unitSelected];
+        if (enemy->team != match->destruct_player[player].team &&
+            DE_isValidUnit(magnet) == true && magnet->unitType == UNIT_MAGNET)
+        {
+            drift += magnet->power * 0.1f / shotDelay[SHOT_MAGNET] * direction;
+        }
+    }
+    return drift;
+}
 
-        fill_rectangle_xy(screen, startX +  5, 3, startX +  14, 8, 241);
-        JE_rectangle(screen, startX +  4, 2, startX +  15, 9, 242);
-        JE_rectangle(screen, startX +  3, 1, startX +  16, 10, 240);
-        fill_rectangle_xy(screen, startX + 18, 3, startX + 140, 8, 241);
-        JE_rectangle(screen, startX + 17, 2, startX + 143, 9, 242);
-        JE_rectangle(screen, startX + 16, 1, startX + 144, 10, 240);
+/* DE_Aim
+ *
+ * The aim of unit index of player, worked out again unless the one it has
+ * still holds.  Working one out uses up one of *solves, if solves isn't
+ * NULL; with none left it returns NULL instead.
+ */
+static const struct destruct_aim_s * DE_Aim(struct destruct_match_s * match, unsigned int player, unsigned int index, unsigned int * solves)
+{
+    struct destruct_unit_s * unit = &match->destruct_player[player].unit[index];
+    struct destruct_aim_s * aim = &unit->aim;
+    const struct destruct_unit_s * target;
+    const int direction = (match->destruct_player[player].team == TEAM_LEFT) ? -1 : 1;
+    const int fromY = roundf(unit->unitY);
 
-        blit_sprite2(screen, startX +  4, 0, destructSpriteSheet, 191 + curUnit->shotType);
+    if (aim->uses > 0 && aim->shotType == unit->shotType && aim->fromX == (int)unit->unitX && aim->fromY == fromY)
+    {
+        target = (aim->target >= 0) ? match->gridUnit[aim->target] : NULL;
+        if (target == NULL ||
+            (DE_isValidUnit(target) == true && aim->toX == (int)target->unitX && aim->toY == (int)roundf(target->unitY)))
+        {
+            aim->uses--;
+            return aim;
+        }
+    }
 
-        JE_outText   (screen, startX + 20, 3, weaponNames[curUnit->shotType], 15, 2);
-        sprintf      (tempstr, "dmg~%d~", curUnit->health);
-        JE_outText   (screen, startX + 73, 3, tempstr, 15, 0);
-        sprintf      (tempstr, "pts~%d~", destruct_player[i].score);
-        JE_outText   (screen, startX + 106, 3, tempstr, 15, 0);
+    if (solves != NULL)
+    {
+        if (*solves == 0)
+            return NULL;
+        (*solves)--;
+    }
 
-        JE_outText(screen, startX + 137, 3, (destruct_player[i].is_cpu) ? "C" : "H", 15, 2);
+    aim->target = DE_FindTarget(match, player, unit);
+    aim->shotType = unit->shotType;
+    aim->fromX = unit->unitX;
+    aim->fromY = fromY;
+    aim->uses = DE_AIM_USES;
+    if (aim->target < 0)
+    {
+        aim->valid = aim->clear = false;
+        return aim;
     }
+
+    target = match->gridUnit[aim->target];
+    aim->toX = target->unitX;
+    aim->toY = roundf(target->unitY);
+    DE_SolveAim(match, unit, direction, target->unitX + 5.5f, target->unitY - 6, DE_MagnetDrift(match, player), aim);
+    return aim;
 }
 
-static void DE_RunTickGetInput(struct destruct_player_s * destruct_player)
+/* DE_RunTickSolver
+ *
+ * The solver AI's turn for player: it plays its selected unit, or the next
+ * one it can aim, turning and powering it up toward its aim and firing once
+ * it's lined up.  A unit that can't reach its target makes way for the next
+ * one.  Returns false if the player has no unit it can play, for the
+ * original AI to take over.
+ */
+static bool DE_RunTickSolver(struct destruct_match_s * match, unsigned int player)
 {
-    unsigned int player_index, key_index;
-    SDL_Scancode key;
+    const struct destruct_config_s * config = &match->config;
+    struct destruct_player_s * ptrPlayer = &match->destruct_player[player];
+    const struct destruct_aim_s * aim;
+    struct destruct_unit_s * unit;
+    unsigned int i, index = ptrPlayer->unitSelected;
 
-    /* destruct_player.keys holds our key config.  Players will eventually be
-     * allowed to can change their key mappings.  destruct_player.moves and
-     * destruct_player.keys line up; rather than manually checking left and
-     * right we can just loop through the indexes and set the actions as
-     * needed. */
-    service_SDL_events(true);
+    for (i = 0; i < config->max_installations; i++)
+    {
+        if (DE_CanAim(&ptrPlayer->unit[index]) == true)
+            break;
+        index = (index + 1) % config->max_installations;
+    }
+    if (i == config->max_installations)
+        return false;
+    ptrPlayer->unitSelected = index;
+    unit = &ptrPlayer->unit[index];
 
-    for (player_index = 0; player_index < MAX_PLAYERS; player_index++)
+    aim = DE_Aim(match, player, index, NULL);
+    if (aim->valid == false)
     {
-        for (key_index = 0; key_index < MAX_KEY; key_index++)
+        /* Try the next one next tick */
+        for (i = 1; i < config->max_installations; i++)
         {
-            key = destruct_player[player_index].keys.Config[key_index];
-            if (key == SDL_SCANCODE_UNKNOWN)
-            {
-                continue;
-            }
-            if (keysactive[key] == true)
+            if (DE_CanAim(&ptrPlayer->unit[(index + i) % config->max_installations]) == true)
             {
-                /* The right key was clearly pressed */
-                destruct_player[player_index].moves.actions[key_index] = true;
-
-                /* Some keys we want to toggle afterwards */
-                if (key_index == KEY_CHANGE ||
-                    key_index == KEY_CYUP   ||
-                    key_index == KEY_CYDN)
-                {
-                    keysactive[key] = false;
-                }
+                ptrPlayer->unitSelected = (index + i) % config->max_installations;
+                return true;
             }
         }
+        return false;
     }
+
+    if (unit->shotType == SHOT_TRACER)
+        ptrPlayer->moves.actions[MOVE_CYDN] = true;
+
+    ptrPlayer->moves.actions[MOVE_FIRE] = (DE_SteerAim(match, player, unit, aim->angle, aim->power) == false);
+    return true;
 }
 
-static void DE_ProcessInput(const struct destruct_config_s * config,
-                            struct destruct_player_s * destruct_player,
-                            struct destruct_shot_s * shotRec,
-                            const SDL_Surface * destructInternalScreen)
+/* DE_SteerAim
+ *
+ * Presses what turns and powers up unit, player's selected one, toward
+ * angle and power.  Returns false once it's close enough to fire.
+ */
+static bool DE_SteerAim(struct destruct_match_s * match, unsigned int player, const struct destruct_unit_s * unit, float angle, float power)
 {
-    int direction;
+    struct destruct_player_s * ptrPlayer = &match->destruct_player[player];
+    const enum de_move_t raise = (ptrPlayer->team == TEAM_LEFT) ? MOVE_LEFT : MOVE_RIGHT;
+    const enum de_move_t lower = (ptrPlayer->team == TEAM_LEFT) ? MOVE_RIGHT : MOVE_LEFT;
+    bool steering = false;
 
-    unsigned int player_index;
-    struct destruct_unit_s * curUnit;
+    if (angle > unit->angle + 0.005f)
+        steering = ptrPlayer->moves.actions[raise] = true;
+    else if (angle < unit->angle - 0.005f)
+        steering = ptrPlayer->moves.actions[lower] = true;
 
-    for (player_index = 0; player_index < MAX_PLAYERS; player_index++)
+    if (unit->unitType != UNIT_LASER)
     {
-        if (destruct_player[player_index].unitsRemaining <= 0)
-            continue;
+        if (power > unit->power + 0.025f)
+            steering = ptrPlayer->moves.actions[MOVE_UP] = true;
+        else if (power < unit->power - 0.025f)
+            steering = ptrPlayer->moves.actions[MOVE_DOWN] = true;
+    }
+    return steering;
+}
 
-        direction = (player_index == PLAYER_LEFT) ? -1 : 1;
-        curUnit = &(destruct_player[player_index].unit[destruct_player[player_index].unitSelected]);
+/* The health the units of team have left between them */
+static int DE_TeamHealth(const struct destruct_match_s * match, enum de_team_t team)
+{
+    const struct destruct_unit_s * unit;
+    unsigned int i, j;
+    int health = 0;
 
-        if (systemAngle[curUnit->unitType] == true) /* selected unit may change shot angle */
+    for (i = 0; i < match->config.players; i++)
+    {
+        if (match->destruct_player[i].team != team)
+            continue;
+
+        for (j = 0, unit = match->destruct_player[i].unit; j < match->config.max_installations; j++, unit++)
         {
-            if (destruct_player[player_index].moves.actions[MOVE_LEFT] == true)
-            {
-                if (player_index == PLAYER_LEFT)
-                    DE_RaiseAngle(curUnit);
-                else
-                    DE_LowerAngle(curUnit);
-            }
-            if (destruct_player[player_index].moves.actions[MOVE_RIGHT] == true)
-            {
-                if (player_index == PLAYER_LEFT)
-                    DE_LowerAngle(curUnit);
-                else
-                    DE_RaiseAngle(curUnit);
-            }
+            if (DE_isValidUnit(unit) == true)
+                health += unit->health;
         }
-        else if (curUnit->unitType == UNIT_HELI)
+    }
+    return health;
+}
+
+/* DE_PlanCandidates
+ *
+ * The shots the rollout AI weighs up for player: for its selected unit and
+ * the next few it can turn, the solver's aim at the nearest enemy with each
+ * weapon the unit has that blows up, then that aim a touch short and a
+ * touch long.  The selected unit's current weapon comes first.  Returns how
+ * many there are, up to DE_ROLLOUT_CANDIDATES.
+ */
+static unsigned int DE_PlanCandidates(const struct destruct_match_s * match, unsigned int player, struct destruct_plan_s * candidate)
+{
+    const struct destruct_config_s * config = &match->config;
+    const struct destruct_player_s * ptrPlayer = &match->destruct_player[player];
+    const int direction = (ptrPlayer->team == TEAM_LEFT) ? -1 : 1;
+    const float drift = DE_MagnetDrift(match, player);
+    const struct destruct_unit_s * target;
+    struct destruct_unit_s probe;
+    struct destruct_aim_s aim;
+    unsigned int i, index, units = 0, count = 0;
+    int found, shot, step;
+
+    for (i = 0; i < config->max_installations && units < DE_ROLLOUT_UNITS; i++)
+    {
+        index = (ptrPlayer->unitSelected + i) % config->max_installations;
+        probe = ptrPlayer->unit[index];
+        if (DE_isValidUnit(&probe) == false || systemAngle[probe.unitType] == false)
+            continue;
+        found = DE_FindTarget(match, player, &probe);
+        if (found < 0)
+            continue;
+        target = match->gridUnit[found];
+        units++;
+
+        for (step = 0; step <= SHOT_LAST - SHOT_FIRST; step++)
+        {
+            /* Starting from the weapon it has, so that comes first */
+            shot = SHOT_FIRST + (probe.shotType - SHOT_FIRST + step) % (SHOT_LAST - SHOT_FIRST + 1);
+            if (config->weaponSystems[probe.unitType][shot] == false || shotDirt[shot] != EXPL_NORMAL)
+                continue;
+            if (count + 3 > DE_ROLLOUT_CANDIDATES)
+                return count;
+
+            probe.shotType = shot;
+            DE_SolveAim(match, &probe, direction, target->unitX + 5.5f, target->unitY - 6, drift, &aim);
+            if (aim.valid == false)
+                continue;
+
+            candidate[count].unit = index;
+            candidate[count].shotType = shot;
+            candidate[count].angle = aim.angle;
+            candidate[count].power = aim.power;
+            candidate[count].delay = 0;
+            candidate[count].valid = true;
+            candidate[count + 1] = candidate[count];
+            candidate[count + 2] = candidate[count];
+            if (shotBounce[shot] == true)
+            {
+                /* Lasers fly straight at any power */
+                candidate[count + 1].angle = MAX(aim.angle - 0.03f, 0.0f);
+                candidate[count + 2].angle = MIN(aim.angle + 0.03f, (float)M_PI_2 - 0.01f);
+            }
+            else
+            {
+                candidate[count + 1].power = MAX(aim.power * 0.96f, 1.0f);
+                candidate[count + 2].power = MIN(aim.power * 1.04f, 5.0f);
+            }
+            count += 3;
+        }
+    }
+    return count;
+}
+
+/* DE_PlayRollout
+ *
+ * Plays the candidate rollout is on from where it left off, until limit of
+ * its rollout ticks have been played.  A candidate is played out
+ * DE_ROLLOUT_SAMPLES times: aimed as planned, then off by as much as
+ * steering may leave it either way, each go rewound afterwards.  A go the
+ * round ends early counts as having played all its ticks.  It scores the
+ * health the shots took off the other side less the health they cost the
+ * player's own, summed over the goes.  Returns true once every go is played.
+ */
+static bool DE_PlayRollout(struct destruct_rollout_s * rollout, const struct destruct_search_s * search, unsigned int player, unsigned int limit)
+{
+    static const float jitter[DE_ROLLOUT_SAMPLES][2] = {{0, 0}, {0.005f, 0.025f}, {-0.005f, -0.025f}};
+    struct destruct_match_s * match = &rollout->match;
+    const struct destruct_plan_s * plan = &search->candidate[rollout->candidate];
+    const enum de_team_t team = match->destruct_player[player].team;
+    const enum de_team_t enemy = (team == TEAM_LEFT) ? TEAM_RIGHT : TEAM_LEFT;
+    struct destruct_plan_s * ptrPlan;
+    bool over;
+
+    while (rollout->sample < DE_ROLLOUT_SAMPLES && rollout->sample * DE_ROLLOUT_TICKS + rollout->tick < limit)
+    {
+        if (rollout->tick == 0)
+        {
+            ptrPlan = &match->destruct_player[player].aiMemory.plan;
+            *ptrPlan = *plan;
+            ptrPlan->delay = search->ticks;
+            ptrPlan->angle = MIN(MAX(plan->angle + jitter[rollout->sample][0], 0.0f), (float)M_PI_2 - 0.01f);
+            ptrPlan->power = MIN(MAX(plan->power + jitter[rollout->sample][1], 1.0f), 5.0f);
+        }
+
+        rollout->tick++;
+        over = (DE_RunTick(match) != STATE_CONTINUE);
+        if (over == true || rollout->tick == DE_ROLLOUT_TICKS)
+        {
+            rollout->score += (search->health[enemy] - DE_TeamHealth(match, enemy)) - (search->health[team] - DE_TeamHealth(match, team));
+            rollout->played++;
+            rollout->ticks += rollout->tick;
+            DE_RewindHistory(match, 0);
+            rollout->sample++;
+            rollout->tick = 0;
+        }
+    }
+    return rollout->sample == DE_ROLLOUT_SAMPLES;
+}
+
+/* How many of candidate's rollout ticks are played once search has played
+ * work of them all told.  The candidates before its lot of
+ * DE_ROLLOUT_LANES are played out first, then its lot evenly. */
+static unsigned int DE_CandidateWork(const struct destruct_search_s * search, unsigned int candidate, unsigned long work)
+{
+    const unsigned int first = candidate - candidate % DE_ROLLOUT_LANES;
+    const unsigned int lanes = MIN(search->count - first, (unsigned int)DE_ROLLOUT_LANES);
+    const unsigned long before = (unsigned long)first * DE_ROLLOUT_WORK;
+
+    if (work <= before)
+        return 0;
+    return MIN((work - before) / lanes, (unsigned long)DE_ROLLOUT_WORK);
+}
+
+/* DE_Plan
+ *
+ * Works out player's next shot.  With only one candidate there is nothing
+ * to weigh up, and with none there is no plan.  Otherwise a search for it
+ * starts on the match's planner; with no ai_budget it is played out there
+ * and then.
+ */
+static void DE_Plan(struct destruct_match_s * match, unsigned int player)
+{
+    struct destruct_planner_s * planner = match->planner;
+    struct destruct_search_s * search = &planner->search[player];
+    struct destruct_plan_s * plan = &match->destruct_player[player].aiMemory.plan;
+    struct destruct_config_s config;
+    struct destruct_rollout_s * rollout;
+    unsigned int i;
+
+    search->count = DE_PlanCandidates(match, player, search->candidate);
+    if (search->count == 0)
+    {
+        plan->valid = false;
+        return;
+    }
+    if (search->count == 1)
+    {
+        *plan = search->candidate[0];
+        return;
+    }
+
+    if (search->lanes == NULL)
+    {
+        search->lanes = calloc(DE_ROLLOUT_LANES, sizeof(*search->lanes));
+        if (search->lanes == NULL)
+            exit(EXIT_FAILURE);  // out of memory
+
+        config = match->config;
+        config.headless = true;
+        for (i = 0; i < DE_ROLLOUT_LANES; i++)
+        {
+            rollout = &search->lanes[i];
+            DE_InitMatch(&rollout->match, &config, match->seed, NULL, NULL, NULL);
+            DE_InitHistory(&rollout->match, &rollout->history, 1);
+        }
+        DE_InitState(&search->root, match);
+    }
+
+    DE_SaveState(match, &search->root);
+    for (i = 0; i < MAX_TEAMS; i++)
+    {
+        search->health[i] = DE_TeamHealth(match, i);
+    }
+    for (i = 0; i < DE_ROLLOUT_LANES; i++)
+    {
+        /* The backdrop isn't in the snapshot, and it's the same all round */
+        memcpy(search->lanes[i].match.terrain.backdrop, match->terrain.backdrop, sizeof(match->terrain.backdrop));
+        search->lanes[i].loaded = false;
+        search->lanes[i].candidate = DE_ROLLOUT_CANDIDATES;
+        search->reached[i] = 0;
+    }
+    /* It ends once the budget has played it all or the player can fire,
+     * and until then the solver plays the player, in the rollouts too */
+    search->ticks = 0;
+    if (match->config.ai_budget != 0)
+    {
+        search->ticks = (search->count * DE_ROLLOUT_WORK + match->config.ai_budget - 1) / match->config.ai_budget;
+        search->ticks = MIN(search->ticks, (unsigned int)match->destruct_player[player].shotDelay);
+    }
+    search->searching = true;
+    search->done = 0;
+    planner->searches++;
+
+    if (match->config.ai_budget == 0)
+    {
+        search->end = search->count * DE_ROLLOUT_WORK;
+        DE_RunSlice(planner, false);
+        DE_EndSearch(match, player);
+    }
+}
+
+/* DE_RunSlice
+ *
+ * Has the planner's workers play every search in progress up to its end,
+ * or as far as they get by the planner's deadline.  If behind, the slice
+ * is collected at the start of the next tick, and if the planner can, the
+ * workers are left to it while the match ticks on.
+ */
+static void DE_RunSlice(struct destruct_planner_s * planner, bool behind)
+{
+    struct destruct_search_s * search;
+    unsigned int i, lanes = 0;
+
+    for (i = 0; i < planner->players; i++)
+    {
+        search = &planner->search[i];
+        if (search->searching == false || search->end <= search->done)
+            continue;
+
+        lanes += MIN(search->count, (unsigned int)DE_ROLLOUT_LANES);
+    }
+    planner->jobs = MIN(lanes, planner->workers);
+    if (planner->jobs == 0)
+        return;
+
+    if (planner->dispatch != NULL)
+    {
+        planner->dispatch(planner);
+    }
+    else
+    {
+        for (i = 0; i < planner->jobs; i++)
+            DE_RunPlanner(planner, i);
+    }
+
+    if (behind == true)
+    {
+        planner->pending = true;
+        return;
+    }
+    if (planner->wait != NULL)
+        planner->wait(planner);
+    DE_SliceDone(planner);
+}
+
+/* Every search in progress has played the slice it was given, as far as
+ * the lane that has got least far.  A lane that got further keeps its
+ * place; it may be on its next candidate already. */
+static void DE_SliceDone(struct destruct_planner_s * planner)
+{
+    struct destruct_search_s * search;
+    unsigned long reached;
+    unsigned int i, j;
+
+    for (i = 0; i < planner->players; i++)
+    {
+        search = &planner->search[i];
+        if (search->searching == false || search->end <= search->done)
+            continue;
+
+        reached = search->end;
+        for (j = 0; j < MIN(search->count, (unsigned int)DE_ROLLOUT_LANES); j++)
+        {
+            reached = MIN(reached, search->reached[j]);
+        }
+        search->slice = reached - search->done;
+        search->done = reached;
+    }
+    planner->deadline = 0;
+}
+
+/* DE_EndSearch
+ *
+ * player's search is done with, played out or not: of the candidates that
+ * have been, the one that scores best, the first of them on a tie, becomes
+ * the plan.  With none played yet that is the first, which is the shot the
+ * solver would take.
+ */
+static void DE_EndSearch(struct destruct_match_s * match, unsigned int player)
+{
+    struct destruct_search_s * search = &match->planner->search[player];
+    unsigned int i;
+    int best = -1;
+
+    for (i = 0; i < search->count; i++)
+    {
+        if (DE_CandidateWork(search, i, search->done) < DE_ROLLOUT_WORK)
+            continue;
+        if (best < 0 || search->score[i] > search->score[best])
+            best = i;
+    }
+    match->destruct_player[player].aiMemory.plan = search->candidate[MAX(best, 0)];
+    search->searching = false;
+}
+
+/* DE_RunTickPlans
+ *
+ * The planner's share of the tick, which runs before anything else in it so
+ * that the world a search snapshots is the one a rollout's first tick
+ * starts from.  It collects the last tick's slice, ends each search that
+ * is played out or whose player can fire, starts one for each rollout AI
+ * player that is about to be able to and has no plan, and plays the next
+ * slice: at most ai_budget rollout ticks of each search, and in a timed
+ * match no more than fit in ai_time.  A replay of a timed match plays
+ * each slice when it is collected, as far as the log says it got.
+ */
+static void DE_RunTickPlans(struct destruct_match_s * match)
+{
+    const struct destruct_config_s * config = &match->config;
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    struct destruct_planner_s * planner = match->planner;
+    const struct destruct_log_s * log = match->log;
+    const bool replaySlices = (match->replaying == true && log->slices != NULL);
+    struct destruct_search_s * search;
+    struct destruct_plan_s * plan;
+    unsigned long total;
+    unsigned int i;
+    bool searching = false;
+
+    if (planner == NULL || config->ai_level != AI_ROLLOUT)
+        return;
+
+    for (i = 0; i < planner->players; i++)
+    {
+        planner->search[i].slice = 0;
+    }
+    if (planner->pending == true)
+    {
+        planner->pending = false;
+        if (replaySlices == true)
+        {
+            for (i = 0; i < planner->players && match->logTick < log->ticks; i++)
+            {
+                search = &planner->search[i];
+                total = search->count * DE_ROLLOUT_WORK;
+                search->end = MIN(search->done + log->slices[match->logTick * planner->players + i], total);
+            }
+            DE_RunSlice(planner, false);
+        }
+        else
+        {
+            if (planner->wait != NULL)
+                planner->wait(planner);
+            DE_SliceDone(planner);
+        }
+    }
+
+    for (i = 0; i < planner->players; i++)
+    {
+        search = &planner->search[i];
+        if (search->searching == false)
+            continue;
+
+        if (planner->stale == true)
+            search->searching = false;
+        else if (search->done >= search->count * DE_ROLLOUT_WORK || destruct_player[i].shotDelay == 0)
+            DE_EndSearch(match, i);
+    }
+    planner->stale = false;
+
+    for (i = 0; i < planner->players; i++)
+    {
+        search = &planner->search[i];
+        if (destruct_player[i].is_cpu == false || search->searching == true)
+            continue;
+
+        plan = &destruct_player[i].aiMemory.plan;
+        if (plan->valid == true && DE_isValidUnit(&destruct_player[i].unit[plan->unit]) == false)
+            plan->valid = false;
+
+        /* Any sooner and the world will have moved on by the time it fires */
+        if (plan->valid == false && destruct_player[i].shotDelay <= DE_PlanLead(config))
+            DE_Plan(match, i);
+    }
+
+    for (i = 0; i < planner->players; i++)
+    {
+        search = &planner->search[i];
+        if (search->searching == false)
+            continue;
+
+        total = search->count * DE_ROLLOUT_WORK;
+        search->end = MIN(search->done + config->ai_budget, total);
+        searching = true;
+    }
+    if (searching == false)
+        return;
+
+    if (replaySlices == true)
+    {
+        planner->pending = true;
+        return;
+    }
+    if (DE_TimedSlices(config) == true && match->replaying == false)
+        planner->deadline = SDL_GetPerformanceCounter() + (Uint64)config->ai_time * SDL_GetPerformanceFrequency() / 1000000;
+    DE_RunSlice(planner, true);
+}
+
+/* Whether the rollout AI's slices are cut short by the clock.  A headless
+ * match isn't held to the frame rate, and plays the same every time. */
+static bool DE_TimedSlices(const struct destruct_config_s * config)
+{
+    return config->ai_level == AI_ROLLOUT && config->ai_budget != 0 && config->ai_time != 0 && config->headless == false;
+}
+
+/* How long before a player can fire again the rollout AI starts planning
+ * its shot, long enough for the budget to play a whole search out */
+static unsigned int DE_PlanLead(const struct destruct_config_s * config)
+{
+    if (config->ai_budget == 0)
+        return DE_ROLLOUT_LEAD;
+    return DE_ROLLOUT_LEAD + DE_ROLLOUT_CANDIDATES * DE_ROLLOUT_WORK / config->ai_budget;
+}
+
+/* DE_RunTickRollout
+ *
+ * The rollout AI's turn for player.  It selects the unit and weapon its plan
+ * has, turns and powers it up and fires.  Returns false if it has no shot to
+ * take, for the solver to play instead: while it reloads, and in a
+ * rollout's match, which has no planner, while the shot being played out
+ * waits for its search to end and once it is gone.
+ */
+static bool DE_RunTickRollout(struct destruct_match_s * match, unsigned int player)
+{
+    struct destruct_player_s * ptrPlayer = &match->destruct_player[player];
+    struct destruct_plan_s * plan = &ptrPlayer->aiMemory.plan;
+    struct destruct_unit_s * unit;
+    bool steering;
+
+    if (plan->valid == true && DE_isValidUnit(&ptrPlayer->unit[plan->unit]) == false)
+        plan->valid = false;
+    if (plan->valid == false)
+        return false;
+    if (plan->delay > 0)
+    {
+        plan->delay--;
+        return false;
+    }
+
+    ptrPlayer->unitSelected = plan->unit;
+    unit = &ptrPlayer->unit[plan->unit];
+
+    steering = DE_SteerAim(match, player, unit, plan->angle, plan->power);
+    if (unit->shotType != plan->shotType)
+        steering = ptrPlayer->moves.actions[MOVE_CYUP] = true;
+
+    if (steering == false)
+    {
+        ptrPlayer->moves.actions[MOVE_FIRE] = true;
+        if (ptrPlayer->shotDelay <= 1)
+            plan->valid = false;  /* it goes off this tick */
+    }
+    return true;
+}
+
+/* DE_RunTickVolleys
+ *
+ * In a massive battle a CPU's other units don't wait to be selected.  Each
+ * fires on its own reload, at an angle and power drawn afresh every shot.
+ * Magnets sit out; one pushing every enemy unit on every shot doesn't scale.
+ */
+static void DE_RunTickVolleys(struct destruct_match_s * match)
+{
+    const struct destruct_config_s * config = &match->config;
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    struct destruct_unit_s * unit;
+    const struct destruct_aim_s * aim;
+    unsigned int i, j, solves;
+    unsigned long draw;
+    int direction;
+
+    if (config->battle_units == 0)
+        return;
+
+    for (i = 0; i < config->players; i++)
+    {
+        if (destruct_player[i].is_cpu == false)
+            continue;
+
+        direction = (destruct_player[i].team == TEAM_LEFT) ? -1 : 1;
+        solves = DE_AIM_SOLVES;
+        unit = destruct_player[i].unit;
+        for (j = 0; j < config->max_installations; j++, unit++)
+        {
+            if (DE_isValidUnit(unit) == false || j == destruct_player[i].unitSelected)
+                continue;
+            if (unit->shotDelay > 0 && --unit->shotDelay > 0)
+                continue;
+
+            unit->shotDelay = shotDelay[unit->shotType] + 1;
+            if (shotDirt[unit->shotType] != EXPL_DIRT &&
+                shotDirt[unit->shotType] != EXPL_NORMAL)
+                continue;
+
+            draw = DE_Rand(match, STREAM_AI + i);
+            if (systemAngle[unit->unitType] == true)
+                unit->angle = 0.1f + (draw & 0xFF) * ((M_PI_2 - 0.2f) / 255);
+            unit->power = 2 + ((draw >> 8) & 0xFF) * (4.0f / 255);
+            unit->shotDelay += (draw >> 16) % (shotDelay[unit->shotType] + 1);
+
+            /* The solver aims the ones it has (or has time to work out) an
+             * aim for, and leaves the rest to chance */
+            if (config->ai_level >= AI_SOLVER && DE_CanAim(unit) == true)
+            {
+                aim = DE_Aim(match, i, j, &solves);
+                if (aim != NULL && aim->valid == true)
+                {
+                    unit->angle = aim->angle;
+                    unit->power = aim->power;
+                }
+            }
+            DE_MakeShot(match, i, unit, direction);
+        }
+    }
+}
+
+static void DE_RunTickDrawCrosshairs(struct destruct_match_s * match, float alpha)
+{
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    SDL_Surface * screen = match->world.VGAScreen;
+    unsigned int i;
+    int tempPosX, tempPosY;
+    int direction;
+    struct destruct_unit_s lerpUnit;
+    struct destruct_unit_s * curUnit = &lerpUnit;
+
+    /* Draw the crosshairs.  Most vehicles aim left or right.  Helis can aim
+     * either way and this must be accounted for.
+     */
+    for (i = 0; i < match->config.players; i++)
+    {
+        direction = (destruct_player[i].team == TEAM_LEFT) ? -1 : 1;
+        if (destruct_player[i].unitSelected == match->prevUnitSelected[i])
+        {
+            DE_LerpUnit(&match->prevUnit[i][destruct_player[i].unitSelected],
+                        &destruct_player[i].unit[destruct_player[i].unitSelected], alpha, &lerpUnit);
+        }
+        else
+        {
+            lerpUnit = destruct_player[i].unit[destruct_player[i].unitSelected];
+        }
+
+        if (curUnit->unitType == UNIT_HELI)
+        {
+            tempPosX = curUnit->unitX + roundf(0.1f * curUnit->lastMove * curUnit->lastMove * curUnit->lastMove) + 5;
+            tempPosY = roundf(curUnit->unitY) + 1;
+        }
+        else
+        {
+            tempPosX = roundf(curUnit->unitX + 6 - cosf(curUnit->angle) * (curUnit->power * 8 + 7) * direction);
+            tempPosY = roundf(curUnit->unitY - 7 - sinf(curUnit->angle) * (curUnit->power * 8 + 7));
+        }
+        tempPosX -= match->viewX;
+        tempPosY -= match->viewY;
+
+        /* Draw it.  Clip away from the HUD though. */
+        if (tempPosY > 9 && tempPosX >= 3 && tempPosX < vga_width + 3 && tempPosY < vga_height + 2)
+        {
+            if (tempPosY > 11)
+            {
+                if (tempPosY > 13)
+                {
+                    /* Top pixel */
+                    JE_pix(screen, tempPosX,     tempPosY - 2,  3);
+                }
+                /* Middle three pixels */
+                JE_pix(screen, tempPosX + 3, tempPosY,      3);
+                JE_pix(screen, tempPosX,     tempPosY,     14);
+                JE_pix(screen, tempPosX - 3, tempPosY,      3);
+            }
+            /* Bottom pixel */
+            JE_pix(screen, tempPosX,     tempPosY + 2,  3);
+            DE_DrawnRect(match, tempPosX - 3, tempPosY - 2, 7, 5);
+        }
+    }
+}
+
+static void DE_RunTickDrawHUD(struct destruct_match_s * match)
+{
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    SDL_Surface * screen = match->world.VGAScreen;
+    unsigned int i;
+    unsigned int startX;
+    char tempstr[16]; /* Max size needed: 16 assuming 10 digit int max. */
+    struct destruct_unit_s * curUnit;
+
+    /* Only the keyboard players get a HUD; it shows their whole team's score */
+    for (i = 0; i < DE_KEYBOARD_PLAYERS; i++)
+    {
+        curUnit = &(destruct_player[i].unit[destruct_player[i].unitSelected]);
+        startX = ((destruct_player[i].team == TEAM_LEFT) ? 0 : vga_width - 150);
+
+        fill_rectangle_xy(screen, startX +  5, 3, startX +  14, 8, 241);
+        JE_rectangle(screen, startX +  4, 2, startX +  15, 9, 242);
+        JE_rectangle(screen, startX +  3, 1, startX +  16, 10, 240);
+        fill_rectangle_xy(screen, startX + 18, 3, startX + 140, 8, 241);
+        JE_rectangle(screen, startX + 17, 2, startX + 143, 9, 242);
+        JE_rectangle(screen, startX + 16, 1, startX + 144, 10, 240);
+
+        blit_sprite2(screen, startX +  4, 0, destructSpriteSheet, 191 + curUnit->shotType);
+        DE_DrawnRect(match, startX + 4, 0, DE_SPRITE_WIDTH, DE_SPRITE_HEIGHT);  /* reaches below the HUD */
+
+        JE_outText   (screen, startX + 20, 3, weaponNames[curUnit->shotType], 15, 2);
+        sprintf      (tempstr, "dmg~%d~", curUnit->health);
+        JE_outText   (screen, startX + 73, 3, tempstr, 15, 0);
+        sprintf      (tempstr, "pts~%d~", DE_TeamScore(match, destruct_player[i].team));
+        JE_outText   (screen, startX + 106, 3, tempstr, 15, 0);
+
+        JE_outText(screen, startX + 137, 3, (destruct_player[i].is_cpu) ? "C" : "H", 15, 2);
+    }
+}
+
+static void DE_RunTickGetInput(struct destruct_match_s * match)
+{
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    Uint8 * keys = match->keysactive;
+    unsigned int player_index, key_index;
+    SDL_Scancode key;
+
+    /* destruct_player.keys holds our key config.  Players will eventually be
+     * allowed to can change their key mappings.  destruct_player.moves and
+     * destruct_player.keys line up; rather than manually checking left and
+     * right we can just loop through the indexes and set the actions as
+     * needed. */
+    service_SDL_events(true);
+
+    if (keys == NULL)
+        return;
+
+    for (player_index = 0; player_index < DE_KEYBOARD_PLAYERS; player_index++)
+    {
+        for (key_index = 0; key_index < MAX_KEY; key_index++)
+        {
+            key = destruct_player[player_index].keys.Config[key_index];
+            if (key == SDL_SCANCODE_UNKNOWN)
+            {
+                continue;
+            }
+            if (keys[key] == true)
+            {
+                /* The right key was clearly pressed */
+                destruct_player[player_index].moves.actions[key_index] = true;
+
+                /* Some keys we want to toggle afterwards */
+                if (key_index == KEY_CHANGE ||
+                    key_index == KEY_CYUP   ||
+                    key_index == KEY_CYDN)
+                {
+                    keys[key] = false;
+                }
+            }
+        }
+    }
+}
+
+static void DE_ProcessInput(struct destruct_match_s * match)
+{
+    const struct destruct_config_s * config = &match->config;
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    const Uint64 * dirt = match->dirt;
+    const unsigned int width = match->terrain.width;
+    int direction;
+
+    unsigned int player_index;
+    struct destruct_unit_s * curUnit;
+
+    for (player_index = 0; player_index < match->config.players; player_index++)
+    {
+        if (destruct_player[player_index].unitsRemaining <= 0)
+            continue;
+
+        direction = (destruct_player[player_index].team == TEAM_LEFT) ? -1 : 1;
+        curUnit = &(destruct_player[player_index].unit[destruct_player[player_index].unitSelected]);
+
+        if (systemAngle[curUnit->unitType] == true) /* selected unit may change shot angle */
+        {
+            if (destruct_player[player_index].moves.actions[MOVE_LEFT] == true)
+            {
+                if (destruct_player[player_index].team == TEAM_LEFT)
+                    DE_RaiseAngle(curUnit);
+                else
+                    DE_LowerAngle(curUnit);
+            }
+            if (destruct_player[player_index].moves.actions[MOVE_RIGHT] == true)
+            {
+                if (destruct_player[player_index].team == TEAM_LEFT)
+                    DE_LowerAngle(curUnit);
+                else
+                    DE_RaiseAngle(curUnit);
+            }
+        }
+        else if (curUnit->unitType == UNIT_HELI)
+        {
+            if (destruct_player[player_index].moves.actions[MOVE_LEFT] == true && curUnit->unitX > 5)
+            {
+                if (JE_stabilityCheck(dirt, width, curUnit->unitX - 5, roundf(curUnit->unitY)))
+                {
+                    if (curUnit->lastMove > -5)
+                        curUnit->lastMove--;
+                    curUnit->unitX--;
+                    if (JE_stabilityCheck(dirt, width, curUnit->unitX, roundf(curUnit->unitY)))
+                        curUnit->isYInAir = true;
+                }
+            }
+            if (destruct_player[player_index].moves.actions[MOVE_RIGHT] == true && curUnit->unitX < width - 15)
+            {
+                if (JE_stabilityCheck(dirt, width, curUnit->unitX + 5, roundf(curUnit->unitY)))
+                {
+                    if (curUnit->lastMove < 5)
+                        curUnit->lastMove++;
+                    curUnit->unitX++;
+                    if (JE_stabilityCheck(dirt, width, curUnit->unitX, roundf(curUnit->unitY)))
+                        curUnit->isYInAir = true;
+                }
+            }
+        }
+
+        if (curUnit->unitType != UNIT_LASER)
+        {   /*increasepower*/
+            if (destruct_player[player_index].moves.actions[MOVE_UP] == true)
+            {
+                if (curUnit->unitType == UNIT_HELI)
+                {
+                    curUnit->isYInAir = true;
+                    curUnit->unitYMov -= 0.1f;
+                }
+                else if (curUnit->unitType == UNIT_JUMPER &&
+                         curUnit->isYInAir == false)
+                {
+                    curUnit->unitYMov = -3;
+                    curUnit->isYInAir = true;
+                }
+                else
+                {
+                    DE_RaisePower(curUnit);
+                }
+            }
+            /*decreasepower*/
+            if (destruct_player[player_index].moves.actions[MOVE_DOWN] == true)
+            {
+                if (curUnit->unitType == UNIT_HELI && curUnit->isYInAir == true)
+                {
+                    curUnit->unitYMov += 0.1f;
+                }
+                else
+                {
+                    DE_LowerPower(curUnit);
+                }
+            }
+        }
+
+        /*up/down weapon.  These just cycle until a valid weapon is found */
+        if (destruct_player[player_index].moves.actions[MOVE_CYUP] == true)
+            DE_CycleWeaponUp(config, curUnit);
+        if (destruct_player[player_index].moves.actions[MOVE_CYDN] == true)
+            DE_CycleWeaponDown(config, curUnit);
+
+        /* Change.  Since change would change out curUnit pointer, let's just do it last.
+         * Validity checking is performed at the beginning of the tick. */
+        if (destruct_player[player_index].moves.actions[MOVE_CHANGE] == true)
+        {
+            destruct_player[player_index].unitSelected++;
+            if (destruct_player[player_index].unitSelected >= config->max_installations)
+                destruct_player[player_index].unitSelected = 0;
+        }
+
+        /*Newshot*/
+        if (destruct_player[player_index].shotDelay > 0)
+            destruct_player[player_index].shotDelay--;
+        if (destruct_player[player_index].moves.actions[MOVE_FIRE] == true &&
+            destruct_player[player_index].shotDelay == 0)
+        {
+            destruct_player[player_index].shotDelay = shotDelay[curUnit->shotType];
+
+            switch (shotDirt[curUnit->shotType])
+            {
+                case EXPL_NONE:
+                    break;
+
+                case EXPL_MAGNET:
+                    DE_RunMagnet(match, player_index, curUnit);
+                    break;
+
+                case EXPL_DIRT:
+                case EXPL_NORMAL:
+                    DE_MakeShot(match, player_index, curUnit, direction);
+                    break;
+
+                default:
+                    assert(false);
+            }
+        }
+    }
+}
+
+static void DE_CycleWeaponUp(const struct destruct_config_s * config, struct destruct_unit_s * unit)
+{
+    do
+    {
+        unit->shotType++;
+        if (unit->shotType > SHOT_LAST)
+            unit->shotType = SHOT_FIRST;
+    } while (config->weaponSystems[unit->unitType][unit->shotType] == 0);
+}
+
+static void DE_CycleWeaponDown(const struct destruct_config_s * config, struct destruct_unit_s * unit)
+{
+    do
+    {
+        unit->shotType--;
+        if (unit->shotType < SHOT_FIRST)
+            unit->shotType = SHOT_LAST;
+    } while (config->weaponSystems[unit->unitType][unit->shotType] == 0);
+}
+
+static void DE_MakeShot(struct destruct_match_s * match,
+                        enum de_player_t curPlayer,
+                        const struct destruct_unit_s * curUnit,
+                        int direction)
+{
+    const struct destruct_config_s * config = &match->config;
+    const struct destruct_player_s * destruct_player = match->destruct_player;
+    struct destruct_shot_s * shotRec = match->shotRec;
+    struct destruct_motion_s * motion = &match->shotMotion;
+    int shotIndex;
+
+    /* Helis can't fire when they are on the ground. */
+    if (curUnit->unitType == UNIT_HELI && curUnit->isYInAir == false)
+    {
+        return;
+    }
+
+    /* Then find an empty shot struct we can use */
+    shotIndex = DE_AllocShot(match);
+    if (shotIndex < 0)
+    {
+        return;  /* no empty slots.  Do nothing. */
+    }
+    if (curPlayer < DE_KEYBOARD_PLAYERS)
+        match->viewShot = shotIndex;  /* the view follows it */
+
+    /* Play the firing sound */
+    match->soundQueue[destruct_player[curPlayer].team] = shotSound[curUnit->shotType];
+
+    /* Create our shot.  Some units have differing logic here */
+    switch (curUnit->unitType)
+    {
+        case UNIT_HELI:
+
+            motion->x[shotIndex] = curUnit->unitX + curUnit->lastMove * 2 + 5;
+            motion->xmov[shotIndex] = 0.02f * curUnit->lastMove * curUnit->lastMove * curUnit->lastMove;
+
+            /* If we are trying in vain to move up off the screen, act differently.*/
+            if (destruct_player[curPlayer].moves.actions[MOVE_UP] && curUnit->unitY < 30)
+            {
+                motion->y[shotIndex] = curUnit->unitY;
+                motion->ymov[shotIndex] = 0.1f;
+
+                if (motion->xmov[shotIndex] < 0)
+                    motion->xmov[shotIndex] += 0.1f;
+                else if (motion->xmov[shotIndex] > 0)
+                    motion->xmov[shotIndex] -= 0.1f;
+            }
+            else
+            {
+                motion->y[shotIndex] = curUnit->unitY + 1;
+                motion->ymov[shotIndex] = 0.5f + curUnit->unitYMov * 0.1f;
+            }
+            break;
+
+        case UNIT_JUMPER: /* Jumpers are normally only special for the left hand player.  Bug?  Or feature? */
+
+            if (config->jumper_straight[destruct_player[curPlayer].team])
+            {
+                /* This is identical to the default case.
+                 * I considered letting the switch fall through
+                 * but that's more confusing to people who aren't used
+                 * to that quirk of switch. */
+
+                motion->x[shotIndex]    = curUnit->unitX + 6 - cosf(curUnit->angle) * 10 * direction;
+                motion->y[shotIndex]    = curUnit->unitY - 7 - sinf(curUnit->angle) * 10;
+                motion->xmov[shotIndex] = -cosf(curUnit->angle) * curUnit->power * direction;
+                motion->ymov[shotIndex] = -sinf(curUnit->angle) * curUnit->power;
+            }
+            else
+            {
+                /* This is not identical to the default case. */
+
+                motion->x[shotIndex] = curUnit->unitX + 2;
+                motion->xmov[shotIndex] = -cosf(curUnit->angle) * curUnit->power * direction;
+
+                if (curUnit->isYInAir == true)
+                {
+                    motion->ymov[shotIndex] = 1;
+                    motion->y[shotIndex] = curUnit->unitY + 2;
+                }
+                else
+                {
+                    motion->ymov[shotIndex] = -2;
+                    motion->y[shotIndex] = curUnit->unitY - 12;
+                }
+            }
+            break;
+
+        default:
+
+            motion->x[shotIndex]    = curUnit->unitX + 6 - cosf(curUnit->angle) * 10 * direction;
+            motion->y[shotIndex]    = curUnit->unitY - 7 - sinf(curUnit->angle) * 10;
+            motion->xmov[shotIndex] = -cosf(curUnit->angle) * curUnit->power * direction;
+            motion->ymov[shotIndex] = -sinf(curUnit->angle) * curUnit->power;
+            break;
+    }
+
+    /* Now set/clear out a few last details. */
+    DE_ListShot(match, shotIndex);
+
+    shotRec[shotIndex].shottype = curUnit->shotType;
+    //shotRec[shotIndex].shotdur = shotFuse[shotRec[shotIndex].shottype];
+
+    shotRec[shotIndex].trailc[0] = 0;
+    shotRec[shotIndex].trailc[1] = 0;
+    shotRec[shotIndex].trailc[2] = 0;
+    shotRec[shotIndex].trailc[3] = 0;
+}
+
+static void DE_RunMagnet(struct destruct_match_s * match,
+                         enum de_player_t curPlayer,
+                         struct destruct_unit_s * magnet)
+{
+    const struct destruct_config_s * config = &match->config;
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    struct destruct_shot_s * shotRec = match->shotRec;
+    unsigned int i, p, column, first, last;
+    int s;
+    enum de_team_t team;
+    int direction;
+    struct destruct_unit_s * enemyUnit;
+
+    team = destruct_player[curPlayer].team;
+    direction = (team == TEAM_LEFT) ? -1 : 1;
+
+    /* Push all shots that are in front of the magnet.  Only the columns on
+     * that side have any; the one the magnet is in is split. */
+    column = DE_GridColumn(match, magnet->unitX);
+    first = (team == TEAM_LEFT) ? column : 0;
+    last = (team == TEAM_LEFT) ? match->unitGrid.columns - 1 : column;
+    for (column = first; column <= last; column++)
+    {
+        for (s = match->shotColumn[column]; s >= 0; s = match->shotNext[s])
+        {
+            if (shotRec[s].isAvailable == false)
+            {
+                if ((team == TEAM_LEFT  && match->shotMotion.x[s] > magnet->unitX) ||
+                    (team == TEAM_RIGHT && match->shotMotion.x[s] < magnet->unitX))
+                {
+                    match->shotMotion.xmov[s] += magnet->power * 0.1f * -direction;
+                }
+            }
+        }
+    }
+
+    for (p = 0; p < config->players; p++) /* magnets push coptors */
+    {
+        if (destruct_player[p].team == team)
+            continue;
+
+        enemyUnit = destruct_player[p].unit;
+        for (i = 0; i < config->max_installations; i++, enemyUnit++)
+        {
+            if (DE_isValidUnit(enemyUnit) &&
+                enemyUnit->unitType == UNIT_HELI &&
+                enemyUnit->isYInAir == true)
+            {
+                if ((team == TEAM_LEFT  && enemyUnit->unitX + 11 < match->terrain.width - 2) ||
+                    (team == TEAM_RIGHT && enemyUnit->unitX > 1))
+                {
+                    enemyUnit->unitX -= 2 * direction;
+                }
+            }
+        }
+    }
+    magnet->ani_frame = 1;
+}
+
+static void DE_RaiseAngle(struct destruct_unit_s * unit)
+{
+    unit->angle += 0.01f;
+    if (unit->angle > M_PI_2 - 0.01f)
+        unit->angle = M_PI_2 - 0.01f;
+}
+
+static void DE_LowerAngle(struct destruct_unit_s * unit)
+{
+    unit->angle -= 0.01f;
+    if (unit->angle < 0)
+        unit->angle = 0;
+}
+
+static void DE_RaisePower(struct destruct_unit_s * unit)
+{
+    unit->power += 0.05f;
+    if (unit->power > 5)
+        unit->power = 5;
+}
+
+static void DE_LowerPower(struct destruct_unit_s * unit)
+{
+    unit->power -= 0.05f;
+    if (unit->power < 1)
+        unit->power = 1;
+}
+
+/* DE_isValidUnit
+ *
+ * Returns true if the unit's health is above 0 and false
+ * otherwise.  This mainly exists because the 'health' var
+ * serves two roles and that can get confusing.
+ */
+static inline bool DE_isValidUnit(const struct destruct_unit_s * unit)
+{
+    return unit->health > 0;
+}
+
+/* DE_AllocGrid
+ *
+ * Makes room in grid for count things, each of which can sit in up to four
+ * squares, over a width by height map.
+ */
+static void DE_AllocGrid(struct destruct_grid_s * grid, unsigned int count, unsigned int width, unsigned int height)
+{
+    unsigned int cells;
+
+    grid->columns = (width + DE_GRID_SIZE - 1) / DE_GRID_SIZE;
+    grid->rows = (height + DE_GRID_SIZE - 1) / DE_GRID_SIZE;
+    cells = grid->columns * grid->rows;
+    grid->capacity = 4 * count;
+    grid->head = malloc(cells * sizeof(*grid->head));
+    grid->tail = malloc(cells * sizeof(*grid->tail));
+    grid->used = malloc(MAX(MIN(cells, grid->capacity), 1u) * sizeof(*grid->used));
+    grid->item = malloc(MAX(grid->capacity, 1u) * sizeof(*grid->item));
+    grid->next = malloc(MAX(grid->capacity, 1u) * sizeof(*grid->next));
+    if (grid->head == NULL || grid->tail == NULL || grid->used == NULL || grid->item == NULL || grid->next == NULL)
+        exit(EXIT_FAILURE);  // out of memory
+
+    memset(grid->head, -1, cells * sizeof(*grid->head));
+    memset(grid->tail, -1, cells * sizeof(*grid->tail));
+    grid->usedCount = 0;
+    grid->count = 0;
+}
+
+static void DE_FreeGrid(struct destruct_grid_s * grid)
+{
+    free(grid->head);
+    free(grid->tail);
+    free(grid->used);
+    free(grid->item);
+    free(grid->next);
+    grid->head = grid->tail = NULL;
+    grid->used = grid->item = NULL;
+    grid->next = NULL;
+}
+
+static void DE_ClearGrid(struct destruct_grid_s * grid)
+{
+    unsigned int i;
+
+    for (i = 0; i < grid->usedCount; i++)
+    {
+        grid->head[grid->used[i]] = -1;
+        grid->tail[grid->used[i]] = -1;
+    }
+    grid->usedCount = 0;
+    grid->count = 0;
+}
+
+/* DE_GridAdd
+ *
+ * Puts item in every square that the pixels from (x0, y0) to (x1, y1)
+ * touch.  Off-map pixels count as being in the nearest square, the same
+ * as in DE_GridCell, so lookups find whatever hangs off the edge.
+ */
+static void DE_GridAdd(struct destruct_grid_s * grid, unsigned int item, int x0, int y0, int x1, int y1)
+{
+    const unsigned int first = DE_GridCell(grid, x0, y0), last = DE_GridCell(grid, x1, y1);
+    unsigned int cell, column, row;
+
+    for (row = first / grid->columns; row <= last / grid->columns; row++)
+    {
+        for (column = first % grid->columns; column <= last % grid->columns; column++)
+        {
+            assert(grid->count < grid->capacity);
+            cell = row * grid->columns + column;
+
+            grid->item[grid->count] = item;
+            grid->next[grid->count] = -1;
+            if (grid->tail[cell] < 0)
+            {
+                grid->head[cell] = grid->count;
+                grid->used[grid->usedCount++] = cell;
+            }
+            else
+            {
+                grid->next[grid->tail[cell]] = grid->count;
+            }
+            grid->tail[cell] = grid->count++;
+        }
+    }
+}
+
+static inline unsigned int DE_GridCell(const struct destruct_grid_s * grid, int x, int y)
+{
+    x = MIN(MAX(x, 0), (int)(grid->columns * DE_GRID_SIZE) - 1);
+    y = MIN(MAX(y, 0), (int)(grid->rows * DE_GRID_SIZE) - 1);
+    return (y / DE_GRID_SIZE) * grid->columns + x / DE_GRID_SIZE;
+}
+
+static inline unsigned int DE_GridColumn(const struct destruct_match_s * match, float x)
+{
+    return DE_GridCell(&match->unitGrid, x, 0);
+}
+
+/* DE_RunTickGrid
+ *
+ * Buckets the units and walls for this tick's explosions and shots.
+ * Nothing moves them from here until the shots are done.  Each one goes in
+ * the squares of every pixel it can be hit at: a unit from one right of its
+ * x to ten right, and from 13 above its y down to y; a wall over its whole
+ * 12x15 sprite.  They go in in the order the old loops over all of them
+ * went, so collisions still happen in that order.
+ */
+static void DE_RunTickGrid(struct destruct_match_s * match)
+{
+    const struct destruct_config_s * config = &match->config;
+    const struct destruct_player_s * destruct_player = match->destruct_player;
+    const struct destruct_wall_s * mapWalls = match->world.mapWalls;
+    const struct destruct_terrain_s * terrain = &match->terrain;
+    const struct destruct_grid_s * unitGrid = &match->unitGrid;
+    const struct destruct_unit_s * unit;
+    unsigned int i, j, x, y;
+
+    /* Last tick's units only set bits in the squares they were in */
+    for (i = 0; i < unitGrid->usedCount; i++)
+    {
+        x = unitGrid->used[i] % unitGrid->columns * DE_GRID_SIZE;
+        y = unitGrid->used[i] / unitGrid->columns * DE_GRID_SIZE;
+        DE_PlaneRect(match->unitPlane, terrain, x, y, x + DE_GRID_SIZE - 1, y + DE_GRID_SIZE - 1, false);
+    }
+    DE_ClearGrid(&match->unitGrid);
+    for (i = 0; i < match->config.players; i++)
+    {
+        unit = destruct_player[i].unit;
+        for (j = 0; j < config->max_installations; j++, unit++)
+        {
+            if (DE_isValidUnit(unit) == false)
+                continue;
+
+            DE_GridAdd(&match->unitGrid, i * config->max_installations + j,
+                       unit->unitX + 1, floorf(unit->unitY) - 13,
+                       unit->unitX + 10, ceilf(unit->unitY));
+            DE_PlaneRect(match->unitPlane, terrain,
+                         unit->unitX + 1, floorf(unit->unitY) - 11,
+                         unit->unitX + 10, ceilf(unit->unitY), true);
+        }
+    }
+
+    DE_ClearGrid(&match->wallGrid);
+    for (i = 0; i < config->max_walls; i++)
+    {
+        if (mapWalls[i].wallExist == false)
+            continue;
+
+        DE_GridAdd(&match->wallGrid, i, mapWalls[i].wallX, mapWalls[i].wallY,
+                   mapWalls[i].wallX + 11, mapWalls[i].wallY + 14);
+    }
+}
+
+/* DE_PlaneRect
+ *
+ * Sets, or clears, the bits of a plane from (x1, y1) to (x2, y2),
+ * inclusive, clipped to the map.  The rectangle is no more than 64 wide.
+ */
+static void DE_PlaneRect(Uint64 * plane, const struct destruct_terrain_s * terrain, int x1, int y1, int x2, int y2, bool set)
+{
+    const unsigned int pitch = terrain->width / 64;
+    unsigned int w1, w2;
+    Uint64 mask1, mask2;
+    int y;
+
+    x1 = MAX(x1, 0);
+    y1 = MAX(y1, 0);
+    x2 = MIN(x2, (int)terrain->width - 1);
+    y2 = MIN(y2, (int)terrain->height - 1);
+    if (x1 > x2 || y1 > y2)
+        return;
+
+    w1 = x1 / 64;
+    w2 = x2 / 64;
+    mask1 = ~0ULL << (x1 % 64);
+    mask2 = ~0ULL >> (63 - x2 % 64);
+    if (w1 == w2)
+        mask1 &= mask2;
+    for (y = y1; y <= y2; y++)
+    {
+        if (set == true)
+        {
+            plane[y * pitch + w1] |= mask1;
+            if (w2 != w1)
+                plane[y * pitch + w2] |= mask2;
+        }
+        else
+        {
+            plane[y * pitch + w1] &= ~mask1;
+            if (w2 != w1)
+                plane[y * pitch + w2] &= ~mask2;
+        }
+    }
+}
+
+/* DE_ListShots
+ *
+ * Sorts the live shots into their columns' lists.  Done whenever the shots
+ * have moved; DE_MakeShot adds new ones as they come.
+ */
+static void DE_ListShots(struct destruct_match_s * match)
+{
+    unsigned int w;
+    Uint64 bits;
+
+    memset(match->shotColumn, -1, match->unitGrid.columns * sizeof(*match->shotColumn));
+    for (w = 0; w < DE_SHOT_WORDS(match->config.max_shots); w++)
+    {
+        for (bits = match->shotLive[w]; bits != 0; bits &= bits - 1)
+            DE_ListShot(match, w * 64 + __builtin_ctzll(bits));
+    }
+}
+
+static inline void DE_ListShot(struct destruct_match_s * match, unsigned int index)
+{
+    const unsigned int column = DE_GridColumn(match, match->shotMotion.x[index]);
+
+    match->shotNext[index] = match->shotColumn[column];
+    match->shotColumn[column] = index;
+}
+
+/* DE_Rand
+ *
+ * The next random number for stream.  Under rules older than RULES_STREAMS
+ * there is only the match's Mersenne Twister, and stream doesn't matter.
+ */
+static inline unsigned long DE_Rand(struct destruct_match_s * match, enum de_stream_t stream)
+{
+    if (match->config.rules < RULES_STREAMS)
+        return mt_rand_r(&match->rng);
+    return philox_rand(&match->stream[stream]);
+}
+
+static inline float DE_RandLt1(struct destruct_match_s * match, enum de_stream_t stream)
+{
+    if (match->config.rules < RULES_STREAMS)
+        return mt_rand_lt1_r(&match->rng);
+    return philox_rand_lt1(&match->stream[stream]);
+}
+
+/* DE_RandFill
+ *
+ * count numbers of stream at once, the same ones as count DE_Rand calls.
+ */
+static void DE_RandFill(struct destruct_match_s * match, enum de_stream_t stream, Uint32 * out, unsigned int count)
+{
+    unsigned int i;
+
+    if (match->config.rules >= RULES_STREAMS)
+    {
+        philox_fill(&match->stream[stream], out, count);
+        return;
+    }
+    for (i = 0; i < count; i++)
+        out[i] = mt_rand_r(&match->rng);
+}
+
+static bool DE_RunTickCheckEndgame(struct destruct_match_s * match)
+{
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    const struct destruct_world_s * world = &match->world;
+    unsigned int team, i;
+
+    /* The first team wiped out loses the round.  Everyone on the other side
+     * gets the points. */
+    for (team = 0; team < MAX_TEAMS; team++)
+    {
+        if (DE_TeamUnits(match, team) > 0)
+            continue;
+
+        for (i = 0; i < match->config.players; i++)
+        {
+            if (destruct_player[i].team != team)
+                destruct_player[i].score += ModeScore[team][world->destructMode];
+        }
+        match->soundQueue[7] = V_CLEARED_PLATFORM;
+        return true;
+    }
+    return false;
+}
+
+static void DE_RunTickPlaySounds(struct destruct_match_s * match)
+{
+    JE_byte * soundQueue = match->soundQueue;
+    unsigned int i, tempSampleIndex, tempVolume;
+
+    for (i = 0; i < COUNTOF(match->soundQueue); i++)
+    {
+        if (soundQueue[i] != S_NONE)
+        {
+            tempSampleIndex = soundQueue[i];
+            if (i == 7)
+                tempVolume = fxPlayVol;
+            else
+                tempVolume = fxPlayVol / 2;
+
+            multiSamplePlay(soundSamples[tempSampleIndex-1], soundSampleCount[tempSampleIndex-1], i, tempVolume);
+            soundQueue[i] = S_NONE;
+        }
+    }
+}
+
+static void JE_pixCool(unsigned int x, unsigned int y, Uint8 c, SDL_Surface * screen)
+{
+    JE_pix(screen, x, y, c);
+    JE_pix(screen, x - 1, y, c - 2);
+    JE_pix(screen, x + 1, y, c - 2);
+    JE_pix(screen, x, y - 1, c - 2);
+    JE_pix(screen, x, y + 1, c - 2);
+}
+
+/* DE_RecordLog
+ *
+ * Starts recording match into log, which must not hold a log already.
+ * Call it before the first DE_ResetLevel.  The log keeps growing with every
+ * tick until DE_FreeLog; DE_SaveLog may be called at any point in between.
+ */
+void DE_RecordLog(struct destruct_match_s * match, struct destruct_log_s * log, bool hashes)
+{
+    log->seed = match->seed;
+    log->config = match->config;
+    log->ticks = 0;
+    log->capacity = 0;
+    log->data = NULL;
+    log->hashes = NULL;
+    log->slices = NULL;
+
+    /* Only the pointers' NULLness matters until the first tick grows them */
+    if (hashes == true)
+    {
+        log->hashes = malloc(sizeof(*log->hashes) * MAX_HASHES);
+        if (log->hashes == NULL)
+            exit(EXIT_FAILURE);  // out of memory
+    }
+    if (DE_TimedSlices(&match->config) == true)
+    {
+        log->slices = malloc(sizeof(*log->slices) * match->config.players);
+        if (log->slices == NULL)
+            exit(EXIT_FAILURE);  // out of memory
+    }
+
+    match->log = log;
+    match->replaying = false;
+    match->logRoundStart = false;
+    match->logTick = 0;
+}
+
+/* DE_ReplayLog
+ *
+ * Has match play log back.  The match must have been set up from the log's
+ * seed and config and had its players reset, and nothing else; the caller
+ * then starts a new round with DE_ResetLevel whenever DE_LogRoundStart says
+ * the next tick (match->logTick) is the first of one.  If the log has
+ * hashes, each tick is checked against them; see match->desyncMask.
+ */
+void DE_ReplayLog(struct destruct_match_s * match, struct destruct_log_s * log)
+{
+    match->log = log;
+    match->replaying = true;
+    match->logRoundStart = false;
+    match->logTick = 0;
+    match->desyncTick = 0;
+    match->desyncMask = 0;
+}
+
+bool DE_LogRoundStart(const struct destruct_log_s * log, unsigned int tick)
+{
+    return tick < log->ticks && (log->data[tick * DE_LOG_TICK_SIZE(log->config.players)] & LOG_ROUND_START);
+}
+
+/* Sets up who is a CPU, and at the start of a round the mode, the way the
+ * next tick of the log was recorded. */
+static void DE_ApplyLogFlags(struct destruct_match_s * match)
+{
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    const struct destruct_log_s * log = match->log;
+    unsigned int i;
+    Uint8 flags;
+
+    if (match->logTick >= log->ticks)
+        return;
+    flags = log->data[match->logTick * DE_LOG_TICK_SIZE(log->config.players)];
+
+    for (i = 0; i < DE_KEYBOARD_PLAYERS; i++)
+    {
+        destruct_player[i].is_cpu = (flags & (LOG_CPU_LEFT << i)) != 0;
+    }
+    if (flags & LOG_ROUND_START)
+    {
+        match->world.destructMode = flags >> LOG_MODE_SHIFT;
+    }
+}
+
+/* DE_RunTickLog
+ *
+ * Appends this tick's moves to the log, or when replaying, swaps them for
+ * the logged ones.  The AI has run by now either way, so a replay draws the
+ * same random numbers and leaves the AI with the same memory as the match
+ * that was recorded.  A timed match's slices are logged along with the
+ * moves; DE_RunTickPlans plays them back.
+ */
+static void DE_RunTickLog(struct destruct_match_s * match)
+{
+    struct destruct_player_s * destruct_player = match->destruct_player;
+    struct destruct_log_s * log = match->log;
+    Uint8 * tick;
+    unsigned int i, j;
+
+    if (match->replaying == true)
+    {
+        if (match->logTick >= log->ticks)
+        {
+            match->logTick++; /* Ran off the end; the AI keeps whatever it decided */
+            return;
+        }
+
+        tick = &log->data[match->logTick * DE_LOG_TICK_SIZE(log->config.players)];
+        for (i = 0; i < match->config.players; i++)
+        {
+            for (j = 0; j < MAX_MOVE; j++)
+            {
+                destruct_player[i].moves.actions[j] = (tick[1 + i] >> j) & 1;
+            }
+        }
+    }
+    else
+    {
+        if (log->ticks == log->capacity)
+        {
+            log->capacity = (log->capacity == 0) ? 4096 : log->capacity * 2;
+            tick = realloc(log->data, log->capacity * DE_LOG_TICK_SIZE(log->config.players));
+            if (tick == NULL)
+                exit(EXIT_FAILURE);  // out of memory
+            log->data = tick;
+
+            if (log->hashes != NULL)
+            {
+                Uint32 * hashes = realloc(log->hashes, sizeof(*log->hashes) * MAX_HASHES * log->capacity);
+                if (hashes == NULL)
+                    exit(EXIT_FAILURE);  // out of memory
+                log->hashes = hashes;
+            }
+            if (log->slices != NULL)
+            {
+                Uint16 * slices = realloc(log->slices, sizeof(*log->slices) * log->config.players * log->capacity);
+                if (slices == NULL)
+                    exit(EXIT_FAILURE);  // out of memory
+                log->slices = slices;
+            }
+        }
+
+        tick = &log->data[log->ticks * DE_LOG_TICK_SIZE(log->config.players)];
+        memset(tick, 0, DE_LOG_TICK_SIZE(log->config.players));
+        for (i = 0; i < match->config.players; i++)
+        {
+            if (destruct_player[i].is_cpu == true && i < DE_KEYBOARD_PLAYERS)
+                tick[0] |= LOG_CPU_LEFT << i;
+
+            for (j = 0; j < MAX_MOVE; j++)
+            {
+                if (destruct_player[i].moves.actions[j] == true)
+                    tick[1 + i] |= 1 << j;
+            }
+        }
+        if (match->logRoundStart == true)
+        {
+            tick[0] |= LOG_ROUND_START | (match->world.destructMode << LOG_MODE_SHIFT);
+            match->logRoundStart = false;
+        }
+        for (i = 0; i < match->config.players && log->slices != NULL; i++)
+        {
+            log->slices[log->ticks * log->config.players + i] = (match->planner != NULL) ? match->planner->search[i].slice : 0;
+        }
+        log->ticks++;
+    }
+
+    match->logTick++;
+}
+
+/* Input log files
+ *
+ * A small header (magic, seed, rules and the parts of the config that affect
+ * play; key bindings don't, as the moves are logged instead) followed by the
+ * ticks as they are kept in memory and then, if there are any, the timed
+ * rollout AI's slices and the hashes.  Everything is little-endian.
+ */
+static const char logMagic[4] = { 'D', 'E', 'L', 'G' };
+#define LOG_VERSION 9  /* 1 had no hashes, 2 no rules (RULES_ORIGINAL),
+                          3 no explosion limit, 4 no players or battle units,
+                          5 no world size, 6 no AI level (AI_ORIGINAL),
+                          7 no AI budget (searches played out at once),
+                          8 no slices (never timed) */
+
+bool DE_SaveLog(const struct destruct_log_s * log, const char * filename)
+{
+    const struct destruct_config_s * config = &log->config;
+    const Uint8 version = LOG_VERSION;
+    const Uint8 hashCount = (log->hashes != NULL) ? MAX_HASHES : 0;
+    const Uint8 rules = config->rules;
+    const Uint8 aiLevel = config->ai_level;
+    const bool timed = (log->slices != NULL);
+    Uint32 temp;
+    unsigned int i, j;
+    FILE * f;
+
+    f = fopen(filename, "wb");
+    if (f == NULL)
+        return false;
+
+    fwrite_die(logMagic, 1, sizeof(logMagic), f);
+    fwrite_u8_die(&version, 1, f);
+    fwrite_u8_die(&hashCount, 1, f);
+    fwrite_u8_die(&rules, 1, f);
+
+    temp = log->seed & 0xffffffffUL; /* all the generator looks at */
+    fwrite_u32_die(&temp, f);
+    fwrite_u32_die(&config->max_shots, f);
+    fwrite_u32_die(&config->min_walls, f);
+    fwrite_u32_die(&config->max_walls, f);
+    fwrite_u32_die(&config->max_explosions, f);
+    fwrite_u32_die(&config->explosion_limit, f);
+    fwrite_u32_die(&config->max_installations, f);
+    fwrite_u32_die(&config->players, f);
+    fwrite_u32_die(&config->battle_units, f);
+    fwrite_u32_die(&config->world_width, f);
+    fwrite_u32_die(&config->world_height, f);
+    fwrite_u8_die(&aiLevel, 1, f);
+    fwrite_u32_die(&config->ai_budget, f);
+    fwrite_bool_die(&timed, f);
+    fwrite_bool_die(&config->allow_custom, f);
+    fwrite_bool_die(&config->alwaysalias, f);
+    for (i = 0; i < 2; i++)
+    {
+        fwrite_bool_die(&config->jumper_straight[i], f);
+        fwrite_bool_die(&config->ai[i], f);
+    }
+    for (i = 0; i < MAX_UNITS; i++)
+    {
+        for (j = 0; j < MAX_SHOT_TYPES; j++)
+        {
+            fwrite_bool_die(&config->weaponSystems[i][j], f);
+        }
+    }
+    fwrite_u8_die(&config->basetypes[0][0], sizeof(config->basetypes), f);
+
+    fwrite_u32_die(&log->ticks, f);
+    fwrite_u8_die(log->data, log->ticks * DE_LOG_TICK_SIZE(log->config.players), f);
+    for (i = 0; timed == true && i < log->ticks * log->config.players; i++)
+    {
+        fwrite_u16_die(&log->slices[i], f);
+    }
+    for (i = 0; i < log->ticks * hashCount; i++)
+    {
+        fwrite_u32_die(&log->hashes[i], f);
+    }
+
+    return fclose(f) == 0;
+}
+
+/* DE_LoadLog
+ *
+ * Reads back a log written by DE_SaveLog.  Returns false if the file can't
+ * be opened or isn't a log; a log that has been cut short is fatal, like
+ * any other truncated data file.
+ */
+bool DE_LoadLog(struct destruct_log_s * log, const char * filename)
+{
+    struct destruct_config_s * config = &log->config;
+    char magic[sizeof(logMagic)];
+    Uint8 version, hashCount = 0, rules = RULES_ORIGINAL, aiLevel = AI_ORIGINAL;
+    Uint32 temp;
+    unsigned int i, j;
+    bool timed = false;
+    Uint8 flags;
+    FILE * f;
+
+    f = fopen(filename, "rb");
+    if (f == NULL)
+        return false;
+
+    fread_die(magic, 1, sizeof(magic), f);
+    fread_u8_die(&version, 1, f);
+    if (memcmp(magic, logMagic, sizeof(magic)) != 0 || version < 1 || version > LOG_VERSION)
+    {
+        fclose(f);
+        return false;
+    }
+    if (version >= 2)
+        fread_u8_die(&hashCount, 1, f);
+    if (version >= 3)
+        fread_u8_die(&rules, 1, f);
+    if ((hashCount != 0 && hashCount != MAX_HASHES) || rules > RULES_CURRENT)
+    {
+        fclose(f);
+        return false;
+    }
+
+    /* Whatever isn't in the file (the key bindings) gets the defaults */
+    DE_ResetConfig(config);
+    config->rules = rules;
+
+    fread_u32_die(&temp, 1, f);
+    log->seed = temp;
+    fread_u32_die(&config->max_shots, 1, f);
+    fread_u32_die(&config->min_walls, 1, f);
+    fread_u32_die(&config->max_walls, 1, f);
+    fread_u32_die(&config->max_explosions, 1, f);
+    if (version >= 4)
+        fread_u32_die(&config->explosion_limit, 1, f);
+    else
+        config->explosion_limit = config->max_explosions;
+    fread_u32_die(&config->max_installations, 1, f);
+    if (version >= 5)
+    {
+        fread_u32_die(&config->players, 1, f);
+        fread_u32_die(&config->battle_units, 1, f);
+    }
+    if (version >= 6)
+    {
+        fread_u32_die(&config->world_width, 1, f);
+        fread_u32_die(&config->world_height, 1, f);
+    }
+    if (version >= 7)
+        fread_u8_die(&aiLevel, 1, f);
+    config->ai_level = aiLevel;
+    config->ai_budget = 0;
+    if (version >= 8)
+        fread_u32_die(&config->ai_budget, 1, f);
+    if (version >= 9)
+        fread_bool_die(&timed, f);
+    if (config->players < 2 || config->players > MAX_PLAYERS || aiLevel >= MAX_AI ||
+        config->battle_units > DE_MAX_BATTLE_UNITS)
+    {
+        fclose(f);
+        return false;
+    }
+    fread_bool_die(&config->allow_custom, f);
+    fread_bool_die(&config->alwaysalias, f);
+    for (i = 0; i < 2; i++)
+    {
+        fread_bool_die(&config->jumper_straight[i], f);
+        fread_bool_die(&config->ai[i], f);
+    }
+    for (i = 0; i < MAX_UNITS; i++)
+    {
+        for (j = 0; j < MAX_SHOT_TYPES; j++)
+        {
+            fread_bool_die(&config->weaponSystems[i][j], f);
+        }
+    }
+    fread_u8_die(&config->basetypes[0][0], sizeof(config->basetypes), f);
+
+    fread_u32_die(&temp, 1, f);
+    log->ticks = temp;
+    log->capacity = temp;
+    log->data = malloc(MAX(log->capacity, 1u) * DE_LOG_TICK_SIZE(log->config.players));
+    if (log->data == NULL)
+        exit(EXIT_FAILURE);  // out of memory
+    fread_u8_die(log->data, log->ticks * DE_LOG_TICK_SIZE(log->config.players), f);
+
+    log->slices = NULL;
+    if (timed == true)
+    {
+        log->slices = malloc(sizeof(*log->slices) * log->config.players * MAX(log->capacity, 1u));
+        if (log->slices == NULL)
+            exit(EXIT_FAILURE);  // out of memory
+        fread_u16_die(log->slices, log->ticks * log->config.players, f);
+    }
+
+    log->hashes = NULL;
+    if (hashCount != 0)
+    {
+        log->hashes = malloc(sizeof(*log->hashes) * MAX_HASHES * MAX(log->capacity, 1u));
+        if (log->hashes == NULL)
+            exit(EXIT_FAILURE);  // out of memory
+        fread_u32_die(log->hashes, log->ticks * MAX_HASHES, f);
+    }
+
+    fclose(f);
+
+    /* Make sure every round is one we know how to set up */
+    for (i = 0; i < log->ticks; i++)
+    {
+        flags = log->data[i * DE_LOG_TICK_SIZE(log->config.players)];
+        if ((i == 0 && (flags & LOG_ROUND_START) == false) ||
+            ((flags & LOG_ROUND_START) && (flags >> LOG_MODE_SHIFT) >= MAX_MODES))
+        {
+            DE_FreeLog(log);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void DE_FreeLog(struct destruct_log_s * log)
+{
+    free(log->hashes);
+    free(log->slices);
+    free(log->data);
+    log->hashes = NULL;
+    log->slices = NULL;
+    log->data = NULL;
+    log->ticks = 0;
+    log->capacity = 0;
+}
+
+/* World hashing
+ *
+ * Every tick ends with a hash of everything the simulation depends on, in
+ * a few parts so that a desync can be narrowed down.  Most parts are small
+ * enough to hash from scratch.  The terrain isn't: rather than go over 64000
+ * pixels a tick, it is the sum of one term per pixel, and whatever changes
+ * a pixel swaps that pixel's term for the new one (DE_SetTerrainPixel).
+ */
+const char destructHashName[MAX_HASHES][11] =
+{
+    "players", "shots", "explosions", "walls", "terrain", "random"
+};
+
+static inline Uint64 DE_HashMix(Uint64 h, Uint64 value)
+{
+    h = (h ^ value) * 0x9e3779b97f4a7c15ULL;
+    return h ^ (h >> 29);
+}
+
+static inline Uint64 DE_HashFloat(Uint64 h, float value)
+{
+    Uint32 bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    return DE_HashMix(h, bits);
+}
+
+static Uint64 DE_HashExplo(Uint64 h, const struct destruct_explo_s * explo)
+{
+    h = DE_HashMix(h, explo->x);
+    h = DE_HashMix(h, explo->y);
+    h = DE_HashMix(h, explo->explowidth);
+    h = DE_HashMix(h, explo->explomax);
+    h = DE_HashMix(h, explo->explofill);
+    return DE_HashMix(h, explo->exploType);
+}
+
+/* DE_AllocTerrain
+ *
+ * Sets terrain up for a width by height map, both multiples of a tile.  No
+ * chunk is allocated until something is drawn in it.
+ */
+static void DE_AllocTerrain(struct destruct_terrain_s * terrain, unsigned int width, unsigned int height)
+{
+    terrain->width = width;
+    terrain->height = height;
+    terrain->columns = width / DE_TILE_WIDTH;
+    terrain->rows = height / DE_TILE_HEIGHT;
+    terrain->chunk = calloc(terrain->columns * terrain->rows, sizeof(*terrain->chunk));
+    if (terrain->chunk == NULL)
+        exit(EXIT_FAILURE);  // out of memory
+
+    terrain->block = NULL;
+    terrain->chunkCount = 0;
+    terrain->blockCount = 0;
+    terrain->blockCapacity = 0;
+}
+
+static void DE_FreeTerrain(struct destruct_terrain_s * terrain)
+{
+    unsigned int i;
+
+    for (i = 0; i < terrain->blockCount; i++)
+        free(terrain->block[i]);
+    free(terrain->block);
+    free(terrain->chunk);
+    terrain->block = NULL;
+    terrain->chunk = NULL;
+    terrain->chunkCount = 0;
+    terrain->blockCount = 0;
+    terrain->blockCapacity = 0;
+}
+
+/* Puts every chunk back to the backdrop.  The blocks are kept for reuse. */
+static void DE_ClearTerrain(struct destruct_terrain_s * terrain)
+{
+    memset(terrain->chunk, 0, terrain->columns * terrain->rows * sizeof(*terrain->chunk));
+    terrain->chunkCount = 0;
+}
+
+/* Takes the backdrop the map is drawn over from screen, a tile at a time. */
+static void DE_SetBackdrop(struct destruct_terrain_s * terrain, const SDL_Surface * screen)
+{
+    const Uint8 * pixels = screen->pixels;
+    unsigned int tx, ty, y;
+
+    for (ty = 0; ty < DE_BACKDROP_ROWS; ty++)
+    {
+        for (tx = 0; tx < DE_BACKDROP_COLUMNS; tx++)
         {
-            if (destruct_player[player_index].moves.actions[MOVE_LEFT] == true && curUnit->unitX > 5)
+            for (y = 0; y < DE_TILE_HEIGHT; y++)
             {
-                if (JE_stabilityCheck(destructInternalScreen, curUnit->unitX - 5, roundf(curUnit->unitY)))
-                {
-                    if (curUnit->lastMove > -5)
-                        curUnit->lastMove--;
-                    curUnit->unitX--;
-                    if (JE_stabilityCheck(destructInternalScreen, curUnit->unitX, roundf(curUnit->unitY)))
-                        curUnit->isYInAir = true;
-                }
+                memcpy(terrain->backdrop[ty * DE_BACKDROP_COLUMNS + tx] + y * DE_TILE_WIDTH,
+                       pixels + (ty * DE_TILE_HEIGHT + y) * screen->pitch + tx * DE_TILE_WIDTH,
+                       DE_TILE_WIDTH);
             }
-            if (destruct_player[player_index].moves.actions[MOVE_RIGHT] == true && curUnit->unitX < 305)
+        }
+    }
+}
+
+/* The pixels of tile (tx, ty), which are the backdrop's until it's drawn in.
+ * The backdrop repeats across the map, and its bottom row down it. */
+static inline const Uint8 * DE_ReadChunk(const struct destruct_terrain_s * terrain, unsigned int tx, unsigned int ty)
+{
+    const Uint8 * chunk = terrain->chunk[ty * terrain->columns + tx];
+
+    if (chunk != NULL)
+        return chunk;
+    return terrain->backdrop[MIN(ty, DE_BACKDROP_ROWS - 1u) * DE_BACKDROP_COLUMNS + tx % DE_BACKDROP_COLUMNS];
+}
+
+/* The pixels of tile (tx, ty), for drawing in. */
+static inline Uint8 * DE_WriteChunk(struct destruct_terrain_s * terrain, unsigned int tx, unsigned int ty)
+{
+    Uint8 * chunk = terrain->chunk[ty * terrain->columns + tx];
+
+    if (chunk != NULL)
+        return chunk;
+    return DE_NewChunk(terrain, tx, ty);
+}
+
+/* DE_NewChunk
+ *
+ * Gives tile (tx, ty) a chunk of its own, starting out as the backdrop.
+ * Chunks come out of blocks of DE_CHUNKS_PER_BLOCK, in the order they're
+ * asked for, so a map only takes as much memory as has been drawn on.
+ */
+static Uint8 * DE_NewChunk(struct destruct_terrain_s * terrain, unsigned int tx, unsigned int ty)
+{
+    Uint8 * chunk;
+
+    if (terrain->chunkCount == terrain->blockCount * DE_CHUNKS_PER_BLOCK)
+    {
+        if (terrain->blockCount == terrain->blockCapacity)
+        {
+            terrain->blockCapacity = MAX(16u, 2 * terrain->blockCapacity);
+            terrain->block = realloc(terrain->block, terrain->blockCapacity * sizeof(*terrain->block));
+            if (terrain->block == NULL)
+                exit(EXIT_FAILURE);  // out of memory
+        }
+        terrain->block[terrain->blockCount] = malloc(DE_CHUNKS_PER_BLOCK * DE_CHUNK_SIZE);
+        if (terrain->block[terrain->blockCount] == NULL)
+            exit(EXIT_FAILURE);  // out of memory
+        terrain->blockCount++;
+    }
+
+    chunk = terrain->block[terrain->chunkCount / DE_CHUNKS_PER_BLOCK] + (terrain->chunkCount % DE_CHUNKS_PER_BLOCK) * DE_CHUNK_SIZE;
+    terrain->chunkCount++;
+
+    memcpy(chunk, DE_ReadChunk(terrain, tx, ty), DE_CHUNK_SIZE);
+    terrain->chunk[ty * terrain->columns + tx] = chunk;
+    return chunk;
+}
+
+static inline Uint8 * DE_TerrainAt(struct destruct_terrain_s * terrain, unsigned int x, unsigned int y)
+{
+    return DE_WriteChunk(terrain, x / DE_TILE_WIDTH, y / DE_TILE_HEIGHT) + (y % DE_TILE_HEIGHT) * DE_TILE_WIDTH + x % DE_TILE_WIDTH;
+}
+
+/* Copies width pixels of row y from x on into dst. */
+static void DE_CopyTerrainRow(const struct destruct_terrain_s * terrain, Uint8 * dst, unsigned int x, unsigned int y, unsigned int width)
+{
+    const unsigned int line = (y % DE_TILE_HEIGHT) * DE_TILE_WIDTH;
+    unsigned int count;
+
+    while (width > 0)
+    {
+        count = MIN(DE_TILE_WIDTH - x % DE_TILE_WIDTH, width);
+        memcpy(dst, DE_ReadChunk(terrain, x / DE_TILE_WIDTH, y / DE_TILE_HEIGHT) + line + x % DE_TILE_WIDTH, count);
+        dst += count;
+        x += count;
+        width -= count;
+    }
+}
+
+/* DE_GetTerrainPixel
+ *
+ * The terrain at (x, y), which must be on the map.
+ */
+Uint8 DE_GetTerrainPixel(const struct destruct_match_s * match, unsigned int x, unsigned int y)
+{
+    const struct destruct_terrain_s * terrain = &match->terrain;
+
+    return DE_ReadChunk(terrain, x / DE_TILE_WIDTH, y / DE_TILE_HEIGHT)[(y % DE_TILE_HEIGHT) * DE_TILE_WIDTH + x % DE_TILE_WIDTH];
+}
+
+/* DE_PutTerrainPixel
+ *
+ * Draws value into the terrain at (x, y), which must be on the map, the
+ * same way an explosion would.
+ */
+void DE_PutTerrainPixel(struct destruct_match_s * match, unsigned int x, unsigned int y, Uint8 value)
+{
+    DE_SetTerrainPixel(match, DE_TerrainAt(&match->terrain, x, y), x, y, value);
+}
+
+/* DE_BuildDirt
+ *
+ * Fills in the dirt plane, its summaries and the surface for the terrain
+ * from scratch.
+ * Every later change to the terrain goes through DE_SetTerrainPixel, which
+ * keeps both up to date, so collisions never need to look at the pixels.
+ * Tiles still showing the backdrop are skipped; it has no dirt.
+ */
+static void DE_BuildDirt(struct destruct_match_s * match)
+{
+    const struct destruct_terrain_s * terrain = &match->terrain;
+    Uint64 * dirt = match->dirt;
+    Uint64 found[DE_MAX_WORLD_WIDTH / 64] = {0};
+    const Uint8 * chunk;
+    unsigned int tx, ty, y, i, block, region;
+    Uint64 bits;
+
+    memset(dirt, 0, sizeof(*dirt) * DE_PLANE_WORDS(terrain));
+    for (ty = 0; ty < terrain->rows; ty++)
+    {
+        for (tx = 0; tx < terrain->columns; tx++)
+        {
+            chunk = terrain->chunk[ty * terrain->columns + tx];
+            if (chunk == NULL)
+                continue;
+
+            /* A tile's line is one word of the plane */
+            for (y = 0; y < DE_TILE_HEIGHT; y++, chunk += DE_TILE_WIDTH)
             {
-                if (JE_stabilityCheck(destructInternalScreen, curUnit->unitX + 5, roundf(curUnit->unitY)))
-                {
-                    if (curUnit->lastMove < 5)
-                        curUnit->lastMove++;
-                    curUnit->unitX++;
-                    if (JE_stabilityCheck(destructInternalScreen, curUnit->unitX, roundf(curUnit->unitY)))
-                        curUnit->isYInAir = true;
-                }
+                bits = 0;
+                for (i = 0; i < DE_TILE_WIDTH; i++)
+                    bits |= (Uint64)(chunk[i] == PIXEL_DIRT) << i;
+                dirt[(size_t)(ty * DE_TILE_HEIGHT + y) * terrain->columns + tx] = bits;
             }
         }
+    }
 
-        if (curUnit->unitType != UNIT_LASER)
-        {   /*increasepower*/
-            if (destruct_player[player_index].moves.actions[MOVE_UP] == true)
+    /* Top down, the first dirt in each column is its surface.  Each byte
+     * of a word is a row of an 8x8 block. */
+    memset(match->dirtBlocks, 0, sizeof(*match->dirtBlocks) * DE_BLOCK_WORDS(terrain));
+    memset(match->dirtRegions, 0, sizeof(*match->dirtRegions) * DE_REGION_WORDS(terrain));
+    for (i = 0; i < terrain->width; i++)
+        match->surface[i] = terrain->height;
+    for (y = 0; y < terrain->height; y++)
+    {
+        for (tx = 0; tx < terrain->columns; tx++)
+        {
+            bits = dirt[(size_t)y * terrain->columns + tx];
+            if (bits == 0)
+                continue;
+
+            for (i = 0; i < 8; i++)
             {
-                if (curUnit->unitType == UNIT_HELI)
-                {
-                    curUnit->isYInAir = true;
-                    curUnit->unitYMov -= 0.1f;
-                }
-                else if (curUnit->unitType == UNIT_JUMPER &&
-                         curUnit->isYInAir == false)
+                if ((bits >> (8 * i)) & 0xff)
                 {
-                    curUnit->unitYMov = -3;
-                    curUnit->isYInAir = true;
-                }
-                else
-                {
-                    DE_RaisePower(curUnit);
+                    block = (y / 8) * (terrain->width / 8) + tx * 8 + i;
+                    match->dirtBlocks[block / 64] |= 1ULL << (block % 64);
                 }
             }
-            /*decreasepower*/
-            if (destruct_player[player_index].moves.actions[MOVE_DOWN] == true)
+            region = (y / 64) * terrain->columns + tx;
+            match->dirtRegions[region / 64] |= 1ULL << (region % 64);
+
+            for (bits &= ~found[tx]; bits != 0; bits &= bits - 1)
+                match->surface[tx * 64 + __builtin_ctzll(bits)] = y;
+            found[tx] |= dirt[(size_t)y * terrain->columns + tx];
+        }
+    }
+}
+
+/* Whether (x, y) is set in a plane width pixels wide.  x may be width,
+ * which is the start of the next row. */
+static inline bool DE_IsDirt(const Uint64 * dirt, unsigned int width, unsigned int x, unsigned int y)
+{
+    const size_t index = x + (size_t)y * width;
+
+    return (dirt[index / 64] >> (index % 64)) & 1;
+}
+
+static inline void DE_SetDirt(Uint64 * dirt, size_t index, Uint8 value)
+{
+    if (value == PIXEL_DIRT)
+        dirt[index / 64] |= 1ULL << (index % 64);
+    else
+        dirt[index / 64] &= ~(1ULL << (index % 64));
+}
+
+/* Keeps the surface of column x up to date once the plane has (x, y) as dirt
+ * or not.  Uncovering the top of a column has it look down the plane for the
+ * next dirt, which is usually a row or two away. */
+static inline void DE_SetSurface(struct destruct_match_s * match, unsigned int x, unsigned int y, bool dirt)
+{
+    const struct destruct_terrain_s * terrain = &match->terrain;
+    Uint16 * surface = &match->surface[x];
+
+    if (dirt == true)
+    {
+        if (y < *surface)
+            *surface = y;
+    }
+    else if (y == *surface)
+    {
+        for (y++; y < terrain->height && DE_IsDirt(match->dirt, terrain->width, x, y) == false; y++)
+            ;
+        *surface = y;
+    }
+}
+
+/* Keeps the summaries of the plane up to date once it has (x, y) as dirt or
+ * not.  A block or region only gets looked over when its last dirt may just
+ * have gone, and then a byte of a word at a time. */
+static inline void DE_SetOccupancy(struct destruct_match_s * match, unsigned int x, unsigned int y, bool dirt)
+{
+    const struct destruct_terrain_s * terrain = &match->terrain;
+    const unsigned int blockRow = terrain->width / 8;
+    const unsigned int block = (y / 8) * blockRow + x / 8;
+    const unsigned int region = (y / 64) * terrain->columns + x / 64;
+    unsigned int row, end;
+    size_t index;
+
+    if (dirt == true)
+    {
+        match->dirtBlocks[block / 64] |= 1ULL << (block % 64);
+        match->dirtRegions[region / 64] |= 1ULL << (region % 64);
+        return;
+    }
+
+    /* Rows of blocks and regions are a whole number of bytes */
+    for (row = y / 8 * 8; row < y / 8 * 8 + 8; row++)
+    {
+        if ((match->dirt[(size_t)row * terrain->columns + x / 64] >> (x % 64 / 8 * 8)) & 0xff)
+            return;
+    }
+    match->dirtBlocks[block / 64] &= ~(1ULL << (block % 64));
+
+    end = MIN(y / 64 * 8 + 8, terrain->height / 8);
+    for (row = y / 64 * 8; row < end; row++)
+    {
+        index = (size_t)row * blockRow + x / 64 * 8;
+        if ((match->dirtBlocks[index / 64] >> (index % 64)) & 0xff)
+            return;
+    }
+    match->dirtRegions[region / 64] &= ~(1ULL << (region % 64));
+}
+
+/* How big a square around (x, y) the plane's summaries say is empty: 64 for
+ * a region, 8 for a block, or 0 if there may be dirt at (x, y) after all. */
+static inline unsigned int DE_EmptySquare(const struct destruct_match_s * match, unsigned int x, unsigned int y)
+{
+    const struct destruct_terrain_s * terrain = &match->terrain;
+    const unsigned int region = (y / 64) * terrain->columns + x / 64;
+    const unsigned int block = (y / 8) * (terrain->width / 8) + x / 8;
+
+    if (((match->dirtRegions[region / 64] >> (region % 64)) & 1) == 0)
+        return 64;
+    if (((match->dirtBlocks[block / 64] >> (block % 64)) & 1) == 0)
+        return 8;
+    return 0;
+}
+
+/* Which of the 64 pixels from (x, y) on (x a multiple of 64) have dirt right
+ * above, below, left or right of them.  Rows are a whole number of words,
+ * so left and right only need to look at the words next door in the row. */
+static inline Uint64 DE_DirtNeighbours(const Uint64 * dirt, const struct destruct_terrain_s * terrain, unsigned int x, unsigned int y)
+{
+    const Uint64 * word = &dirt[(size_t)y * terrain->columns + x / 64];
+    Uint64 near;
+
+    near = (word[0] << 1) | (word[0] >> 1);
+    if (x > 0)
+        near |= word[-1] >> 63;
+    if (x + 64 < terrain->width)
+        near |= word[1] << 63;
+    if (y > 0)
+        near |= word[-(ptrdiff_t)terrain->columns];
+    if (y < terrain->height - 1)
+        near |= word[terrain->columns];
+
+    return near;
+}
+
+static inline void DE_MarkTile(const struct destruct_terrain_s * terrain, Uint64 * tiles, unsigned int x, unsigned int y)
+{
+    const unsigned int tile = (y / DE_TILE_HEIGHT) * terrain->columns + x / DE_TILE_WIDTH;
+
+    tiles[tile / 64] |= 1ULL << (tile % 64);
+}
+
+static inline void DE_MarkAlias(struct destruct_match_s * match, unsigned int x, unsigned int y)
+{
+    const size_t index = x + (size_t)y * match->terrain.width;
+
+    match->aliasPending[index / 64] |= 1ULL << (index % 64);
+    DE_MarkTile(&match->terrain, match->aliasTiles, x, y);
+}
+
+/* Sets the bit of every tile of the map. */
+static void DE_FillTiles(const struct destruct_terrain_s * terrain, Uint64 * tiles)
+{
+    const unsigned int count = terrain->columns * terrain->rows;
+
+    memset(tiles, 0xff, sizeof(*tiles) * DE_TILE_WORDS(terrain));
+    if (count % 64 != 0)
+        tiles[count / 64] = (1ULL << (count % 64)) - 1;
+}
+
+/* For when the terrain has been replaced wholesale: every tile gets looked
+ * at on the next tick, and the next frame copies all of it. */
+static void DE_MarkAllTiles(struct destruct_match_s * match)
+{
+    const struct destruct_terrain_s * terrain = &match->terrain;
+
+    DE_FillTiles(terrain, match->busyTiles);
+    memset(match->aliasPending, 0xff, sizeof(*match->aliasPending) * DE_PLANE_WORDS(terrain));
+    DE_FillTiles(terrain, match->aliasTiles);
+    memset(match->frameTiles, 0, sizeof(*match->frameTiles) * DE_TILE_WORDS(terrain));
+    match->redrawFrame = true;
+    match->drawnCount = 0;
+}
+
+static inline Uint64 DE_HashPixel(size_t index, Uint8 value)
+{
+    /* splitmix64's finalizer, so neighbouring pixels don't cancel out */
+    Uint64 x = ((Uint64)index << 8) | value;
+
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/* Draws value into the terrain pixel s, which is (x, y), keeping the hash,
+ * the dirt plane, the history and the tiles to look at up to date. */
+static inline void DE_SetTerrainPixel(struct destruct_match_s * match, Uint8 * s, unsigned int x, unsigned int y, Uint8 value)
+{
+    const struct destruct_terrain_s * terrain = &match->terrain;
+    const size_t index = x + (size_t)y * terrain->width;
+
+    /* Aliasing rewrites every black pixel, almost always with black */
+    if (*s == value)
+        return;
+
+    if (match->history != NULL)
+        DE_JournalPixel(match->history, index, *s);
+
+    match->hash[HASH_TERRAIN] += DE_HashPixel(index, value) - DE_HashPixel(index, *s);
+
+    DE_MarkTile(terrain, match->frameTiles, x, y);
+    if (value >= 241)
+        DE_MarkTile(terrain, match->busyTiles, x, y);  /* fading */
+    else if (value == PIXEL_BLACK)
+        DE_MarkAlias(match, x, y);
+    if ((value == PIXEL_DIRT) != (*s == PIXEL_DIRT))
+    {
+        /* The neighbours may need aliasing (or have been aliased for nothing) */
+        DE_SetDirt(match->dirt, index, value);
+        DE_SetSurface(match, x, y, value == PIXEL_DIRT);
+        DE_SetOccupancy(match, x, y, value == PIXEL_DIRT);
+        if (y > 0)
+            DE_MarkAlias(match, x, y - 1);
+        if (y < terrain->height - 1)
+            DE_MarkAlias(match, x, y + 1);
+        if (x > 0)
+            DE_MarkAlias(match, x - 1, y);
+        if (x < terrain->width - 1)
+            DE_MarkAlias(match, x + 1, y);
+    }
+
+    *s = value;
+}
+
+/* Hashes the terrain from scratch, for when all of it has been replaced. */
+static void DE_HashTerrain(struct destruct_match_s * match)
+{
+    const struct destruct_terrain_s * terrain = &match->terrain;
+    const Uint8 * chunk;
+    unsigned int tx, ty, x, y;
+    Uint64 h = 0;
+
+    for (ty = 0; ty < terrain->rows; ty++)
+    {
+        for (tx = 0; tx < terrain->columns; tx++)
+        {
+            chunk = DE_ReadChunk(terrain, tx, ty);
+            for (y = ty * DE_TILE_HEIGHT; y < (ty + 1) * DE_TILE_HEIGHT; y++)
             {
-                if (curUnit->unitType == UNIT_HELI && curUnit->isYInAir == true)
-                {
-                    curUnit->unitYMov += 0.1f;
-                }
-                else
-                {
-                    DE_LowerPower(curUnit);
-                }
+                for (x = tx * DE_TILE_WIDTH; x < (tx + 1) * DE_TILE_WIDTH; x++)
+                    h += DE_HashPixel(x + (size_t)y * terrain->width, *chunk++);
             }
         }
+    }
+    match->hash[HASH_TERRAIN] = h;
+}
 
-        /*up/down weapon.  These just cycle until a valid weapon is found */
-        if (destruct_player[player_index].moves.actions[MOVE_CYUP] == true)
-            DE_CycleWeaponUp(curUnit);
-        if (destruct_player[player_index].moves.actions[MOVE_CYDN] == true)
-            DE_CycleWeaponDown(curUnit);
+/* DE_RunTickHash
+ *
+ * Hashes the world at the end of a tick.  If an input log is being recorded
+ * with hashes, they go in it; if one is being replayed, they are checked
+ * against it.
+ */
+static void DE_RunTickHash(struct destruct_match_s * match)
+{
+    const struct destruct_config_s * config = &match->config;
+    const struct destruct_player_s * destruct_player = match->destruct_player;
+    const struct destruct_world_s * world = &match->world;
+    const struct destruct_unit_s * unit;
+    const struct destruct_shot_s * shot;
+    const struct destruct_explo_s * explo;
+    const struct destruct_log_s * log = match->log;
+    Uint32 * logged;
+    Uint64 h;
+    unsigned int i, j, mask;
+
+    h = DE_HashMix(0, match->endDelay);
+    h = DE_HashMix(h, match->destructFirstTime);
+    for (i = 0; i < match->config.players; i++)
+    {
+        h = DE_HashMix(h, destruct_player[i].is_cpu);
+        h = DE_HashMix(h, destruct_player[i].unitsRemaining);
+        h = DE_HashMix(h, destruct_player[i].unitSelected);
+        h = DE_HashMix(h, destruct_player[i].shotDelay);
+        h = DE_HashMix(h, destruct_player[i].score);
+        h = DE_HashMix(h, destruct_player[i].aiMemory.c_Angle);
+        h = DE_HashMix(h, destruct_player[i].aiMemory.c_Power);
+        h = DE_HashMix(h, destruct_player[i].aiMemory.c_Fire);
+        h = DE_HashMix(h, destruct_player[i].aiMemory.c_noDown);
+
+        for (j = 0, unit = destruct_player[i].unit; j < config->max_installations; j++, unit++)
+        {
+            h = DE_HashMix(h, unit->unitX);
+            h = DE_HashFloat(h, unit->unitY);
+            h = DE_HashFloat(h, unit->unitYMov);
+            h = DE_HashMix(h, unit->isYInAir);
+            h = DE_HashMix(h, unit->unitType);
+            h = DE_HashMix(h, unit->shotType);
+            h = DE_HashFloat(h, unit->angle);
+            h = DE_HashFloat(h, unit->power);
+            h = DE_HashMix(h, unit->lastMove);
+            h = DE_HashMix(h, unit->ani_frame);
+            h = DE_HashMix(h, unit->health);
+            if (config->battle_units > 0)
+                h = DE_HashMix(h, unit->shotDelay);
+        }
+    }
+    match->hash[HASH_PLAYERS] = h;
 
-        /* Change.  Since change would change out curUnit pointer, let's just do it last.
-         * Validity checking is performed at the beginning of the tick. */
-        if (destruct_player[player_index].moves.actions[MOVE_CHANGE] == true)
+    /* Free slots hold leftovers that nothing reads, so only their flag counts */
+    h = 0;
+    for (i = 0, shot = match->shotRec; i < config->max_shots; i++, shot++)
+    {
+        h = DE_HashMix(h, shot->isAvailable);
+        if (shot->isAvailable == true)
+            continue;
+
+        h = DE_HashFloat(h, match->shotMotion.x[i]);
+        h = DE_HashFloat(h, match->shotMotion.y[i]);
+        h = DE_HashFloat(h, match->shotMotion.xmov[i]);
+        h = DE_HashFloat(h, match->shotMotion.ymov[i]);
+        h = DE_HashMix(h, shot->gravity);
+        h = DE_HashMix(h, shot->shottype);
+        for (j = 0; j < COUNTOF(shot->trailx); j++)
         {
-            destruct_player[player_index].unitSelected++;
-            if (destruct_player[player_index].unitSelected >= config->max_installations)
-                destruct_player[player_index].unitSelected = 0;
+            h = DE_HashMix(h, shot->trailx[j]);
+            h = DE_HashMix(h, shot->traily[j]);
+            h = DE_HashMix(h, shot->trailc[j]);
         }
+    }
+    match->hash[HASH_SHOTS] = h;
 
-        /*Newshot*/
-        if (destruct_player[player_index].shotDelay > 0)
-            destruct_player[player_index].shotDelay--;
-        if (destruct_player[player_index].moves.actions[MOVE_FIRE] == true &&
-            destruct_player[player_index].shotDelay == 0)
+    /* Since RULES_EXPLO_POOL the pool can be any size, so only the live
+     * explosions go in, in the order they'll next be gone through */
+    h = 0;
+    if (config->rules < RULES_EXPLO_POOL)
+    {
+        for (i = 0, explo = match->exploRec; i < config->max_explosions; i++, explo++)
+        {
+            h = DE_HashMix(h, explo->isAvailable);
+            if (explo->isAvailable == false)
+                h = DE_HashExplo(h, explo);
+        }
+    }
+    else
+    {
+        for (i = 0; i < match->exploCount; i++)
+        {
+            h = DE_HashExplo(h, &match->exploRec[match->exploActive[i]]);
+        }
+    }
+    match->hash[HASH_EXPLOSIONS] = h;
+
+    h = DE_HashMix(0, world->destructMode);
+    h = DE_HashMix(h, world->mapFlags);
+    for (i = 0; i < config->max_walls; i++)
+    {
+        h = DE_HashMix(h, world->mapWalls[i].wallExist);
+        if (world->mapWalls[i].wallExist == false)
+            continue;
+
+        h = DE_HashMix(h, world->mapWalls[i].wallX);
+        h = DE_HashMix(h, world->mapWalls[i].wallY);
+    }
+    match->hash[HASH_WALLS] = h;
+
+    /* Where the generator is and the last number it made, or how far along
+     * each stream is */
+    if (config->rules < RULES_STREAMS)
+    {
+        h = DE_HashMix(0, match->rng.p0);
+        h = DE_HashMix(h, match->rng.x[(match->rng.p0 + MT_STATE_N - 1) % MT_STATE_N]);
+    }
+    else
+    {
+        /* There was no placement stream to hash before RULES_MAP_SEEDS */
+        h = 0;
+        for (i = 0; i < ((config->rules >= RULES_MAP_SEEDS) ? (unsigned int)MAX_STREAMS : (unsigned int)STREAM_PLACEMENT); i++)
+        {
+            h = DE_HashMix(h, match->stream[i].position);
+        }
+    }
+    match->hash[HASH_RNG] = h;
+
+    /* DE_RunTickLog has moved logTick past this tick already */
+    if (log == NULL || log->hashes == NULL || match->logTick == 0 || match->logTick > log->ticks)
+        return;
+
+    logged = &log->hashes[(match->logTick - 1) * MAX_HASHES];
+    if (match->replaying == false)
+    {
+        for (i = 0; i < MAX_HASHES; i++)
+        {
+            logged[i] = (Uint32)(match->hash[i] ^ (match->hash[i] >> 32));
+        }
+    }
+    else if (match->desyncMask == 0)
+    {
+        mask = 0;
+        for (i = 0; i < MAX_HASHES; i++)
         {
-            destruct_player[player_index].shotDelay = shotDelay[curUnit->shotType];
+            if (logged[i] != (Uint32)(match->hash[i] ^ (match->hash[i] >> 32)))
+                mask |= 1 << i;
+        }
+        if (mask != 0)
+        {
+            match->desyncTick = match->logTick - 1;
+            match->desyncMask = mask;
+        }
+    }
+}
 
-            switch (shotDirt[curUnit->shotType])
-            {
-                case EXPL_NONE:
-                    break;
+/* Snapshots
+ *
+ * A state is a deep copy of the world, so saving or restoring one is a
+ * handful of memcpys.  Its buffers are sized for the match it was set up
+ * with and can be reused for any number of saves.
+ */
+static void DE_AllocState(struct destruct_state_s * state, const struct destruct_match_s * match, bool terrain)
+{
+    const struct destruct_config_s * config = &match->config;
+    unsigned int i;
 
-                case EXPL_MAGNET:
-                    DE_RunMagnet(config, destruct_player, shotRec, player_index, curUnit);
-                    break;
+    memset(state, 0, sizeof(*state));
 
-                case EXPL_DIRT:
-                case EXPL_NORMAL:
-                    DE_MakeShot(config, destruct_player, shotRec, player_index, curUnit, direction);
-                    break;
+    for (i = 0; i < match->config.players; i++)
+    {
+        state->unit[i] = malloc(sizeof(*state->unit[i]) * config->max_installations);
+        if (state->unit[i] == NULL)
+            exit(EXIT_FAILURE);  // out of memory
+    }
+    state->shotRec = malloc(sizeof(*state->shotRec) * config->max_shots);
+    DE_AllocMotion(&state->shotMotion, config->max_shots);
+    state->exploCapacity = match->exploCapacity;
+    state->exploRec = malloc(sizeof(*state->exploRec) * MAX(state->exploCapacity, 1u));
+    state->exploActive = malloc(sizeof(*state->exploActive) * MAX(state->exploCapacity, 1u));
+    state->mapWalls = malloc(sizeof(*state->mapWalls) * config->max_walls);
+    state->baseMap = malloc(sizeof(*state->baseMap) * match->world.width);
+    if (state->shotRec == NULL || state->exploRec == NULL || state->exploActive == NULL || state->mapWalls == NULL ||
+        state->baseMap == NULL)
+        exit(EXIT_FAILURE);  // out of memory
 
-                default:
-                    assert(false);
-            }
-        }
+    /* The chunks themselves wait for the first save, which knows how many */
+    if (terrain == true)
+    {
+        state->chunked = calloc(DE_TILE_WORDS(&match->terrain), sizeof(*state->chunked));
+        state->dirt = malloc(sizeof(*state->dirt) * DE_PLANE_WORDS(&match->terrain));
+        state->dirtBlocks = malloc(sizeof(*state->dirtBlocks) * DE_BLOCK_WORDS(&match->terrain));
+        state->dirtRegions = malloc(sizeof(*state->dirtRegions) * DE_REGION_WORDS(&match->terrain));
+        state->surface = malloc(sizeof(*state->surface) * match->terrain.width);
+        if (state->chunked == NULL || state->dirt == NULL || state->dirtBlocks == NULL || state->dirtRegions == NULL ||
+            state->surface == NULL)
+            exit(EXIT_FAILURE);  // out of memory
     }
 }
 
-static void DE_CycleWeaponUp(struct destruct_unit_s * unit)
+void DE_InitState(struct destruct_state_s * state, const struct destruct_match_s * match)
 {
-    do
-    {
-        unit->shotType++;
-        if (unit->shotType > SHOT_LAST)
-            unit->shotType = SHOT_FIRST;
-    } while (weaponSystems[unit->unitType][unit->shotType] == 0);
+    DE_AllocState(state, match, true);
 }
 
-static void DE_CycleWeaponDown(struct destruct_unit_s * unit)
+void DE_FreeState(struct destruct_state_s * state)
 {
-    do
+    unsigned int i;
+
+    for (i = 0; i < MAX_PLAYERS; i++)
     {
-        unit->shotType--;
-        if (unit->shotType < SHOT_FIRST)
-            unit->shotType = SHOT_LAST;
-    } while (weaponSystems[unit->unitType][unit->shotType] == 0);
+        free(state->unit[i]);
+        state->unit[i] = NULL;
+    }
+    free(state->shotRec);
+    DE_FreeMotion(&state->shotMotion);
+    free(state->exploRec);
+    free(state->exploActive);
+    free(state->mapWalls);
+    free(state->baseMap);
+    free(state->terrain);
+    free(state->chunked);
+    free(state->dirt);
+    free(state->dirtBlocks);
+    free(state->dirtRegions);
+    free(state->surface);
+    state->shotRec = NULL;
+    state->exploRec = NULL;
+    state->exploActive = NULL;
+    state->mapWalls = NULL;
+    state->baseMap = NULL;
+    state->terrain = NULL;
+    state->chunked = NULL;
+    state->dirt = NULL;
+    state->dirtBlocks = NULL;
+    state->dirtRegions = NULL;
+    state->surface = NULL;
+    state->chunkCount = 0;
+    state->chunkCapacity = 0;
 }
 
-static void DE_MakeShot(const struct destruct_config_s * config,
-                        struct destruct_player_s * destruct_player,
-                        struct destruct_shot_s * shotRec,
-                        enum de_player_t curPlayer,
-                        const struct destruct_unit_s * curUnit,
-                        int direction)
+/* Everything but the terrain */
+static void DE_SaveWorld(const struct destruct_match_s * match, struct destruct_state_s * state)
 {
+    const struct destruct_config_s * config = &match->config;
     unsigned int i;
-    unsigned int shotIndex;
 
-    /* First, find an empty shot struct we can use */
-    for (i = 0; ; i++)
+    for (i = 0; i < match->config.players; i++)
     {
-        if (i >= config->max_shots)
-        {
-            return;  /* no empty slots.  Do nothing. */
-        }
-
-        if (shotRec[i].isAvailable)
-        {
-            shotIndex = i;
-            break;
-        }
+        state->destruct_player[i] = match->destruct_player[i];
+        state->destruct_player[i].unit = NULL;
+        memcpy(state->unit[i], match->destruct_player[i].unit, sizeof(*state->unit[i]) * config->max_installations);
     }
+    memcpy(state->shotRec, match->shotRec, sizeof(*state->shotRec) * config->max_shots);
+    DE_CopyMotion(&state->shotMotion, &match->shotMotion, config->max_shots);
 
-    /* Helis can't fire when they are on the ground. */
-    if (curUnit->unitType == UNIT_HELI && curUnit->isYInAir == false)
+    /* The match's explosion pool may have grown since state was set up */
+    if (state->exploCapacity < match->exploCapacity)
     {
-        return;
+        state->exploCapacity = match->exploCapacity;
+        free(state->exploRec);
+        free(state->exploActive);
+        state->exploRec = malloc(sizeof(*state->exploRec) * state->exploCapacity);
+        state->exploActive = malloc(sizeof(*state->exploActive) * state->exploCapacity);
+        if (state->exploRec == NULL || state->exploActive == NULL)
+            exit(EXIT_FAILURE);  // out of memory
     }
+    memcpy(state->exploRec, match->exploRec, sizeof(*state->exploRec) * match->exploCapacity);
+    memcpy(state->exploActive, match->exploActive, sizeof(*state->exploActive) * match->exploCount);
+    state->exploCount = match->exploCount;
+    memcpy(state->mapWalls, match->world.mapWalls, sizeof(*state->mapWalls) * config->max_walls);
+
+    memcpy(state->baseMap, match->world.baseMap, sizeof(*state->baseMap) * match->world.width);
+    state->destructMode = match->world.destructMode;
+    state->mapFlags = match->world.mapFlags;
+
+    state->rng = match->rng;
+    memcpy(state->stream, match->stream, sizeof(state->stream));
+    memcpy(state->soundQueue, match->soundQueue, sizeof(state->soundQueue));
+    state->exploSoundChannel = match->exploSoundChannel;
+    state->destructFirstTime = match->destructFirstTime;
+    state->endDelay = match->endDelay;
+    memcpy(state->hash, match->hash, sizeof(state->hash));
+}
 
-    /* Play the firing sound */
-    soundQueue[curPlayer] = shotSound[curUnit->shotType];
+static void DE_RestoreWorld(struct destruct_match_s * match, const struct destruct_state_s * state)
+{
+    const struct destruct_config_s * config = &match->config;
+    struct destruct_unit_s * unit;
+    unsigned int i;
 
-    /* Create our shot.  Some units have differing logic here */
-    switch (curUnit->unitType)
+    for (i = 0; i < match->config.players; i++)
     {
-        case UNIT_HELI:
+        unit = match->destruct_player[i].unit;
+        match->destruct_player[i] = state->destruct_player[i];
+        match->destruct_player[i].unit = unit;
+        memcpy(unit, state->unit[i], sizeof(*unit) * config->max_installations);
+    }
+    memcpy(match->shotRec, state->shotRec, sizeof(*match->shotRec) * config->max_shots);
+    DE_CopyMotion(&match->shotMotion, &state->shotMotion, config->max_shots);
+    DE_PoolShots(match);
+
+    /* Only the slots the state has; any the pool has grown past it are free */
+    DE_ResizeExplosions(match, state->exploCapacity);
+    memcpy(match->exploRec, state->exploRec, sizeof(*match->exploRec) * state->exploCapacity);
+    for (i = state->exploCapacity; i < match->exploCapacity; i++)
+    {
+        match->exploRec[i].isAvailable = true;
+    }
+    DE_PoolExplosions(match);
+    memcpy(match->exploActive, state->exploActive, sizeof(*match->exploActive) * state->exploCount);
+    match->exploCount = state->exploCount;
+    memcpy(match->world.mapWalls, state->mapWalls, sizeof(*match->world.mapWalls) * config->max_walls);
+
+    memcpy(match->world.baseMap, state->baseMap, sizeof(*match->world.baseMap) * match->world.width);
+    match->world.destructMode = state->destructMode;
+    match->world.mapFlags = state->mapFlags;
+
+    match->rng = state->rng;
+    memcpy(match->stream, state->stream, sizeof(match->stream));
+    memcpy(match->soundQueue, state->soundQueue, sizeof(match->soundQueue));
+    match->exploSoundChannel = state->exploSoundChannel;
+    match->destructFirstTime = state->destructFirstTime;
+    match->endDelay = state->endDelay;
+    memcpy(match->hash, state->hash, sizeof(match->hash));
+
+    /* Don't have the next frame slide everything over from where it was */
+    if (match->prevShotRec != NULL)
+        DE_SavePrevious(match);
+}
 
-            shotRec[shotIndex].x = curUnit->unitX + curUnit->lastMove * 2 + 5;
-            shotRec[shotIndex].xmov = 0.02f * curUnit->lastMove * curUnit->lastMove * curUnit->lastMove;
+/* DE_SaveState
+ *
+ * Copies the world into state, which must have been set up with
+ * DE_InitState for this match.
+ */
+void DE_SaveState(const struct destruct_match_s * match, struct destruct_state_s * state)
+{
+    const struct destruct_terrain_s * terrain = &match->terrain;
+    Uint8 * chunks;
+    unsigned int tile;
 
-            /* If we are trying in vain to move up off the screen, act differently.*/
-            if (destruct_player[curPlayer].moves.actions[MOVE_UP] && curUnit->unitY < 30)
-            {
-                shotRec[shotIndex].y = curUnit->unitY;
-                shotRec[shotIndex].ymov = 0.1f;
+    DE_SaveWorld(match, state);
 
-                if (shotRec[shotIndex].xmov < 0)
-                    shotRec[shotIndex].xmov += 0.1f;
-                else if (shotRec[shotIndex].xmov > 0)
-                    shotRec[shotIndex].xmov -= 0.1f;
-            }
-            else
-            {
-                shotRec[shotIndex].y = curUnit->unitY + 1;
-                shotRec[shotIndex].ymov = 0.5f + curUnit->unitYMov * 0.1f;
-            }
-            break;
+    /* Only the chunks that have been drawn in; the rest is the backdrop */
+    if (state->chunkCapacity < terrain->chunkCount)
+    {
+        state->chunkCapacity = MAX(terrain->chunkCount, 2 * state->chunkCapacity);
+        chunks = realloc(state->terrain, state->chunkCapacity * DE_CHUNK_SIZE);
+        if (chunks == NULL)
+            exit(EXIT_FAILURE);  // out of memory
+        state->terrain = chunks;
+    }
+    memset(state->chunked, 0, sizeof(*state->chunked) * DE_TILE_WORDS(terrain));
+    state->chunkCount = 0;
+    for (tile = 0; tile < terrain->columns * terrain->rows; tile++)
+    {
+        if (terrain->chunk[tile] == NULL)
+            continue;
 
-        case UNIT_JUMPER: /* Jumpers are normally only special for the left hand player.  Bug?  Or feature? */
+        state->chunked[tile / 64] |= 1ULL << (tile % 64);
+        memcpy(state->terrain + state->chunkCount++ * DE_CHUNK_SIZE, terrain->chunk[tile], DE_CHUNK_SIZE);
+    }
+    memcpy(state->dirt, match->dirt, sizeof(*state->dirt) * DE_PLANE_WORDS(terrain));
+    memcpy(state->dirtBlocks, match->dirtBlocks, sizeof(*state->dirtBlocks) * DE_BLOCK_WORDS(terrain));
+    memcpy(state->dirtRegions, match->dirtRegions, sizeof(*state->dirtRegions) * DE_REGION_WORDS(terrain));
+    memcpy(state->surface, match->surface, sizeof(*state->surface) * terrain->width);
+}
 
-            if (config->jumper_straight[curPlayer])
-            {
-                /* This is identical to the default case.
-                 * I considered letting the switch fall through
-                 * but that's more confusing to people who aren't used
-                 * to that quirk of switch. */
+/* DE_RestoreState
+ *
+ * Puts the world back the way it was when state was saved.  VGAScreen
+ * catches up on the next DE_DrawFrame.  The history, if any, is emptied, since
+ * its journal has nothing to do with the restored terrain.
+ */
+void DE_RestoreState(struct destruct_match_s * match, const struct destruct_state_s * state)
+{
+    struct destruct_terrain_s * terrain = &match->terrain;
+    const Uint8 * chunk = state->terrain;
+    unsigned int w, tile;
+    Uint64 bits;
 
-                shotRec[shotIndex].x    = curUnit->unitX + 6 - cosf(curUnit->angle) * 10 * direction;
-                shotRec[shotIndex].y    = curUnit->unitY - 7 - sinf(curUnit->angle) * 10;
-                shotRec[shotIndex].xmov = -cosf(curUnit->angle) * curUnit->power * direction;
-                shotRec[shotIndex].ymov = -sinf(curUnit->angle) * curUnit->power;
-            }
-            else
-            {
-                /* This is not identical to the default case. */
+    DE_RestoreWorld(match, state);
 
-                shotRec[shotIndex].x = curUnit->unitX + 2;
-                shotRec[shotIndex].xmov = -cosf(curUnit->angle) * curUnit->power * direction;
+    /* The backdrop is the same for the whole round */
+    DE_ClearTerrain(terrain);
+    for (w = 0; w < DE_TILE_WORDS(terrain); w++)
+    {
+        for (bits = state->chunked[w]; bits != 0; bits &= bits - 1)
+        {
+            tile = w * 64 + __builtin_ctzll(bits);
+            memcpy(DE_WriteChunk(terrain, tile % terrain->columns, tile / terrain->columns), chunk, DE_CHUNK_SIZE);
+            chunk += DE_CHUNK_SIZE;
+        }
+    }
+    memcpy(match->dirt, state->dirt, sizeof(*match->dirt) * DE_PLANE_WORDS(terrain));
+    memcpy(match->dirtBlocks, state->dirtBlocks, sizeof(*match->dirtBlocks) * DE_BLOCK_WORDS(terrain));
+    memcpy(match->dirtRegions, state->dirtRegions, sizeof(*match->dirtRegions) * DE_REGION_WORDS(terrain));
+    memcpy(match->surface, state->surface, sizeof(*match->surface) * terrain->width);
+    DE_MarkAllTiles(match);
+
+    if (match->history != NULL)
+        DE_ClearHistory(match->history);
+}
 
-                if (curUnit->isYInAir == true)
-                {
-                    shotRec[shotIndex].ymov = 1;
-                    shotRec[shotIndex].y = curUnit->unitY + 2;
-                }
-                else
-                {
-                    shotRec[shotIndex].ymov = -2;
-                    shotRec[shotIndex].y = curUnit->unitY - 12;
-                }
-            }
-            break;
+/* DE_InitHistory
+ *
+ * Starts keeping a history of up to capacity snapshots for match.  The
+ * caller decides when snapshots are taken (DE_PushHistory, typically after
+ * every tick) and how far back to go (DE_RewindHistory).  A new map empties
+ * the history.
+ */
+void DE_InitHistory(struct destruct_match_s * match, struct destruct_history_s * history, unsigned int capacity)
+{
+    unsigned int i;
 
-        default:
+    /* Pixel indexes have to fit in the top 24 bits of a journal entry */
+    assert((size_t)match->terrain.width * match->terrain.height <= (1u << 24));
 
-            shotRec[shotIndex].x    = curUnit->unitX + 6 - cosf(curUnit->angle) * 10 * direction;
-            shotRec[shotIndex].y    = curUnit->unitY - 7 - sinf(curUnit->angle) * 10;
-            shotRec[shotIndex].xmov = -cosf(curUnit->angle) * curUnit->power * direction;
-            shotRec[shotIndex].ymov = -sinf(curUnit->angle) * curUnit->power;
-            break;
+    memset(history, 0, sizeof(*history));
+    history->capacity = MAX(capacity, 1u);
+    history->states = malloc(sizeof(*history->states) * history->capacity);
+    history->journalEnd = malloc(sizeof(*history->journalEnd) * history->capacity);
+    history->journaled = calloc(DE_PLANE_WORDS(&match->terrain), sizeof(*history->journaled));
+    if (history->states == NULL || history->journalEnd == NULL || history->journaled == NULL)
+        exit(EXIT_FAILURE);  // out of memory
+    for (i = 0; i < history->capacity; i++)
+    {
+        DE_AllocState(&history->states[i], match, false);
     }
 
-    /* Now set/clear out a few last details. */
-    shotRec[shotIndex].isAvailable = false;
-
-    shotRec[shotIndex].shottype = curUnit->shotType;
-    //shotRec[shotIndex].shotdur = shotFuse[shotRec[shotIndex].shottype];
-
-    shotRec[shotIndex].trailc[0] = 0;
-    shotRec[shotIndex].trailc[1] = 0;
-    shotRec[shotIndex].trailc[2] = 0;
-    shotRec[shotIndex].trailc[3] = 0;
+    match->history = history;
 }
 
-static void DE_RunMagnet(const struct destruct_config_s * config,
-                         struct destruct_player_s * destruct_player,
-                         struct destruct_shot_s * shotRec,
-                         enum de_player_t curPlayer,
-                         struct destruct_unit_s * magnet)
+void DE_FreeHistory(struct destruct_match_s * match)
 {
+    struct destruct_history_s * history = match->history;
     unsigned int i;
-    enum de_player_t curEnemy;
-    int direction;
-    struct destruct_unit_s * enemyUnit;
 
-    curEnemy = (curPlayer == PLAYER_LEFT) ? PLAYER_RIGHT : PLAYER_LEFT;
-    direction = (curPlayer == PLAYER_LEFT) ? -1 : 1;
+    if (history == NULL)
+        return;
 
-    /* Push all shots that are in front of the magnet */
-    for (i = 0; i < config->max_shots; i++)
+    for (i = 0; i < history->capacity; i++)
     {
-        if (shotRec[i].isAvailable == false)
-        {
-            if ((curPlayer == PLAYER_LEFT  && shotRec[i].x > magnet->unitX) ||
-                (curPlayer == PLAYER_RIGHT && shotRec[i].x < magnet->unitX))
-            {
-                shotRec[i].xmov += magnet->power * 0.1f * -direction;
-            }
-        }
+        DE_FreeState(&history->states[i]);
     }
+    free(history->states);
+    free(history->journalEnd);
+    free(history->journal);
+    free(history->journaled);
+    memset(history, 0, sizeof(*history));
 
-    enemyUnit = destruct_player[curEnemy].unit;
-    for (i = 0; i < config->max_installations; i++, enemyUnit++) /* magnets push coptors */
-    {
-        if (DE_isValidUnit(enemyUnit) &&
-            enemyUnit->unitType == UNIT_HELI &&
-            enemyUnit->isYInAir == true)
-        {
-            if ((curEnemy == PLAYER_RIGHT && destruct_player[curEnemy].unit[i].unitX + 11 < 318) ||
-                (curEnemy == PLAYER_LEFT  && destruct_player[curEnemy].unit[i].unitX > 1))
-            {
-                enemyUnit->unitX -= 2 * direction;
-            }
-        }
-    }
-    magnet->ani_frame = 1;
+    match->history = NULL;
 }
 
-static void DE_RaiseAngle(struct destruct_unit_s * unit)
+void DE_ClearHistory(struct destruct_history_s * history)
 {
-    unit->angle += 0.01f;
-    if (unit->angle > M_PI_2 - 0.01f)
-        unit->angle = M_PI_2 - 0.01f;
+    DE_ForgetJournaled(history);
+    history->first = 0;
+    history->count = 0;
+    history->journalBase += history->journalLength;
+    history->journalLength = 0;
 }
 
-static void DE_LowerAngle(struct destruct_unit_s * unit)
+static void DE_JournalPixel(struct destruct_history_s * history, size_t index, Uint8 value)
 {
-    unit->angle -= 0.01f;
-    if (unit->angle < 0)
-        unit->angle = 0;
+    Uint32 * journal;
+
+    /* Nothing to rewind to yet, or a change to undo first already */
+    if (history->count == 0 || (history->journaled[index / 64] >> (index % 64)) & 1)
+        return;
+    history->journaled[index / 64] |= 1ull << (index % 64);
+
+    if (history->journalLength == history->journalCapacity)
+    {
+        history->journalCapacity = (history->journalCapacity == 0) ? 4096 : history->journalCapacity * 2;
+        journal = realloc(history->journal, sizeof(*journal) * history->journalCapacity);
+        if (journal == NULL)
+            exit(EXIT_FAILURE);  // out of memory
+        history->journal = journal;
+    }
+
+    history->journal[history->journalLength++] = ((Uint32)index << 8) | value;
 }
 
-static void DE_RaisePower(struct destruct_unit_s * unit)
+/* Clears the journaled bits of the pixels journaled since the newest
+ * snapshot, going by their entries rather than the whole plane */
+static void DE_ForgetJournaled(struct destruct_history_s * history)
 {
-    unit->power += 0.05f;
-    if (unit->power > 5)
-        unit->power = 5;
+    unsigned int newest;
+    size_t i;
+
+    if (history->count == 0)
+        return;
+
+    newest = (history->first + history->count - 1) % history->capacity;
+    for (i = history->journalEnd[newest] - history->journalBase; i < history->journalLength; i++)
+    {
+        history->journaled[(history->journal[i] >> 8) / 64] &= ~(1ull << ((history->journal[i] >> 8) % 64));
+    }
 }
 
-static void DE_LowerPower(struct destruct_unit_s * unit)
+/* DE_PushHistory
+ *
+ * Snapshots the world as it is now, dropping the oldest snapshot if the
+ * history is full.
+ */
+void DE_PushHistory(struct destruct_match_s * match)
 {
-    unit->power -= 0.05f;
-    if (unit->power < 1)
-        unit->power = 1;
+    struct destruct_history_s * history = match->history;
+    unsigned int newest;
+    size_t dead;
+
+    DE_ForgetJournaled(history);
+    if (history->count == history->capacity)
+    {
+        history->first = (history->first + 1) % history->capacity;
+        history->count--;
+    }
+
+    newest = (history->first + history->count) % history->capacity;
+    DE_SaveWorld(match, &history->states[newest]);
+    history->journalEnd[newest] = history->journalBase + history->journalLength;
+    history->count++;
+
+    /* Nothing before the oldest snapshot will ever be undone.  Drop it once
+     * it makes up half the journal, so the moves add up to linear time. */
+    dead = history->journalEnd[history->first] - history->journalBase;
+    if (dead > 0 && dead >= history->journalLength / 2)
+    {
+        memmove(history->journal, history->journal + dead, sizeof(*history->journal) * (history->journalLength - dead));
+        history->journalBase += dead;
+        history->journalLength -= dead;
+    }
 }
 
-/* DE_isValidUnit
+/* DE_RewindHistory
  *
- * Returns true if the unit's health is above 0 and false
- * otherwise.  This mainly exists because the 'health' var
- * serves two roles and that can get confusing.
+ * Takes the world back to a snapshot in the history: 0 is the newest one,
+ * 1 the one before it and so on.  The snapshots after it are dropped, as
+ * the match will go on from there differently.  Returns false if the
+ * history doesn't go back that far.
  */
-static inline bool DE_isValidUnit(struct destruct_unit_s * unit)
+bool DE_RewindHistory(struct destruct_match_s * match, unsigned int back)
 {
-    return unit->health > 0;
+    struct destruct_history_s * history = match->history;
+    struct destruct_terrain_s * terrain = &match->terrain;
+    unsigned int target;
+    size_t end;
+    Uint32 entry;
+    Uint8 * pixel;
+    unsigned int x, y;
+
+    if (history == NULL || back >= history->count)
+        return false;
+
+    DE_ForgetJournaled(history);
+    history->count -= back;
+    target = (history->first + history->count - 1) % history->capacity;
+
+    /* Undo the terrain changes newest first.  Most are explosions fading,
+     * which leave the dirt plane and its summaries alone. */
+    end = history->journalEnd[target] - history->journalBase;
+    while (history->journalLength > end)
+    {
+        entry = history->journal[--history->journalLength];
+        x = (entry >> 8) % terrain->width;
+        y = (entry >> 8) / terrain->width;
+        pixel = DE_TerrainAt(terrain, x, y);
+        if ((*pixel == PIXEL_DIRT) != ((entry & 0xff) == PIXEL_DIRT))
+        {
+            DE_SetDirt(match->dirt, entry >> 8, entry & 0xff);
+            DE_SetSurface(match, x, y, (entry & 0xff) == PIXEL_DIRT);
+            DE_SetOccupancy(match, x, y, (entry & 0xff) == PIXEL_DIRT);
+        }
+        *pixel = entry & 0xff;
+    }
+    DE_MarkAllTiles(match);
+
+    DE_RestoreWorld(match, &history->states[target]);
+    return true;
+}
+
+/* Rollout AI
+ *
+ * A planner has a headless match of its own for each worker to play
+ * rollouts in.  They play by the same config and rules as the match they
+ * search for, so their rollouts go the way that match would.
+ */
+
+/* DE_InitPlanner
+ *
+ * Sets planner up to search for match's players with workers threads.
+ * Each player's lanes are only made once it searches.  Pointing
+ * match->planner at it, and setting dispatch, wait and context, is the
+ * caller's to do after this.
+ */
+void DE_InitPlanner(struct destruct_planner_s * planner, const struct destruct_match_s * match, unsigned int workers)
+{
+    memset(planner, 0, sizeof(*planner));
+    planner->workers = MAX(workers, 1u);
+    planner->players = match->config.players;
 }
 
-static bool DE_RunTickCheckEndgame(struct destruct_player_s * destruct_player, struct destruct_world_s * world)
+void DE_FreePlanner(struct destruct_planner_s * planner)
 {
-    if (destruct_player[PLAYER_LEFT].unitsRemaining == 0)
+    struct destruct_search_s * search;
+    unsigned int i, j;
+
+    for (i = 0; i < planner->players; i++)
     {
-        destruct_player[PLAYER_RIGHT].score += ModeScore[PLAYER_LEFT][world->destructMode];
-        soundQueue[7] = V_CLEARED_PLATFORM;
-        return true;
+        search = &planner->search[i];
+        if (search->lanes == NULL)
+            continue;
+
+        for (j = 0; j < DE_ROLLOUT_LANES; j++)
+        {
+            DE_FreeHistory(&search->lanes[j].match);
+            DE_FreeMatch(&search->lanes[j].match);
+        }
+        free(search->lanes);
+        DE_FreeState(&search->root);
     }
-    if (destruct_player[PLAYER_RIGHT].unitsRemaining == 0)
+    memset(planner, 0, sizeof(*planner));
+}
+
+/* DE_RunPlanner
+ *
+ * One worker's share of the slice being played: its lanes of each search
+ * in progress, played up to the search's end.  With a deadline it goes
+ * round them DE_ROLLOUT_STEP of each search's work at a time, looking at
+ * the clock after each lane, and stops once the deadline has passed.
+ */
+void DE_RunPlanner(struct destruct_planner_s * planner, unsigned int worker)
+{
+    struct destruct_search_s * search;
+    unsigned long step, end;
+    unsigned int i, j, lane, round;
+    bool more = true;
+
+    step = (planner->deadline != 0) ? DE_ROLLOUT_STEP : DE_ROLLOUT_CANDIDATES * DE_ROLLOUT_WORK;
+    for (round = 1; more == true; round++)
     {
-        destruct_player[PLAYER_LEFT].score += ModeScore[PLAYER_RIGHT][world->destructMode];
-        soundQueue[7] = V_CLEARED_PLATFORM;
-        return true;
+        more = false;
+        lane = 0;
+        for (i = 0; i < planner->players; i++)
+        {
+            search = &planner->search[i];
+            if (search->searching == false || search->end <= search->done)
+                continue;
+
+            end = MIN(search->done + round * step, search->end);
+            if (end < search->end)
+                more = true;
+            for (j = 0; j < MIN(search->count, (unsigned int)DE_ROLLOUT_LANES); j++, lane++)
+            {
+                if (lane % planner->jobs != worker || search->reached[j] >= end)
+                    continue;
+
+                DE_PlayLane(search, i, j, end);
+                search->reached[j] = end;
+                if (planner->deadline != 0 && SDL_GetPerformanceCounter() >= planner->deadline)
+                    return;
+            }
+        }
     }
-    return false;
 }
 
-static void DE_RunTickPlaySounds(void)
+/* Plays lane of player's search up to where it is once end of the search's
+ * work is played: whatever of the lane's candidates' rollout ticks fall
+ * before that.  A lane loads the world being searched the first time it
+ * has any, with every player played by the computer. */
+static void DE_PlayLane(struct destruct_search_s * search, unsigned int player, unsigned int lane, unsigned long end)
 {
-    unsigned int i, tempSampleIndex, tempVolume;
+    struct destruct_rollout_s * rollout = &search->lanes[lane];
+    struct destruct_match_s * match = &rollout->match;
+    unsigned int k, candidate, limit;
 
-    for (i = 0; i < COUNTOF(soundQueue); i++)
+    for (candidate = lane; candidate < search->count; candidate += DE_ROLLOUT_LANES)
     {
-        if (soundQueue[i] != S_NONE)
-        {
-            tempSampleIndex = soundQueue[i];
-            if (i == 7)
-                tempVolume = fxPlayVol;
-            else
-                tempVolume = fxPlayVol / 2;
+        limit = DE_CandidateWork(search, candidate, end);
+        if (limit == 0)
+            break;
+        if (DE_CandidateWork(search, candidate, search->reached[lane]) == DE_ROLLOUT_WORK)
+            continue;  /* played already */
 
-            multiSamplePlay(soundSamples[tempSampleIndex-1], soundSampleCount[tempSampleIndex-1], i, tempVolume);
-            soundQueue[i] = S_NONE;
+        if (rollout->loaded == false)
+        {
+            DE_RestoreState(match, &search->root);
+            for (k = 0; k < match->config.players; k++)
+            {
+                match->destruct_player[k].is_cpu = true;
+            }
+            DE_PushHistory(match);
+            rollout->loaded = true;
+        }
+        if (rollout->candidate != candidate)
+        {
+            rollout->candidate = candidate;
+            rollout->sample = 0;
+            rollout->tick = 0;
+            rollout->score = 0;
         }
+
+        if (DE_PlayRollout(rollout, search, player, limit) == true)
+            search->score[candidate] = rollout->score;
     }
 }
 
-static void JE_pixCool(unsigned int x, unsigned int y, Uint8 c, SDL_Surface * screen)
+/* How many rollouts the planner has played and how many ticks that came
+ * to, all told */
+void DE_PlannerStats(const struct destruct_planner_s * planner, unsigned long * rollouts, unsigned long * ticks)
 {
-    JE_pix(screen, x, y, c);
-    JE_pix(screen, x - 1, y, c - 2);
-    JE_pix(screen, x + 1, y, c - 2);
-    JE_pix(screen, x, y - 1, c - 2);
-    JE_pix(screen, x, y + 1, c - 2);
+    const struct destruct_search_s * search;
+    unsigned int i, j;
+
+    *rollouts = 0;
+    *ticks = 0;
+    for (i = 0; i < planner->players; i++)
+    {
+        search = &planner->search[i];
+        if (search->lanes == NULL)
+            continue;
+
+        for (j = 0; j < DE_ROLLOUT_LANES; j++)
+        {
+            *rollouts += search->lanes[j].played;
+            *ticks += search->lanes[j].ticks;
+        }
+    }
 }
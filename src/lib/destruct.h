@@ -23,6 +23,8 @@
 
 #include "opentyr.h"
 #include "config_file.h"
+#include "mtrand.h"
+#include "philox.h"
 
 
 enum de_state_t
@@ -44,13 +46,25 @@ enum de_mode_t
     MODE_NONE = -1
 };
 
+/* A match has config.players of these.  The first two are the ones at the
+ * keyboard (or not); any more are always CPUs. */
 enum de_player_t
 {
     PLAYER_LEFT = 0,
     PLAYER_RIGHT = 1,
-    MAX_PLAYERS = 2
+    MAX_PLAYERS = 8
 };
 
+#define DE_KEYBOARD_PLAYERS 2
+
+/* A massive battle's units.  Packed this tight, a side's units blow each
+ * other up in chains, and the explosion pool fills to its limit; at 8
+ * players x 256 units the worst tick still fits in a 14.4 ms tick, at 512
+ * it takes twice that. */
+#define DE_MAX_BATTLE_UNITS 256
+
+/* Players take sides turn about: even ones on the left, odd ones on the
+ * right.  A team's players split its side of the map between them. */
 enum de_team_t
 {
     TEAM_LEFT = 0,
@@ -135,45 +149,42 @@ enum de_shot_t
 };
 
 /*** Structs ***/
-struct destruct_config_s
-{
-    unsigned int max_shots;
-    unsigned int min_walls;
-    unsigned int max_walls;
-    unsigned int max_explosions;
-    unsigned int max_installations;
-    bool allow_custom;
-    bool alwaysalias;
-    bool jumper_straight[2];
-    bool ai[2];
-};
-
 struct destruct_world_s
 {
-    /* Map data & screen pointer */
-    unsigned int baseMap[320];
+    /* Map data & screen pointer.  The map is width by height pixels, with
+     * a baseMap entry for every column. */
+    unsigned int * baseMap;
+    unsigned int width, height;
     SDL_Surface * VGAScreen;
     struct destruct_wall_s * mapWalls;
 
     /* Map configuration */
     enum de_mode_t destructMode;
     unsigned int mapFlags;
+    unsigned int song;
 };
 
+/* Where the shots are is kept apart from the rest of them (see
+ * destruct_motion_s), so this is only what they are and their trails. */
 struct destruct_shot_s
 {
     bool isAvailable;
 
-    float x;
-    float y;
-    float xmov;
-    float ymov;
     bool gravity;
     unsigned int shottype;
     //int shotdur; /* This looks to be unused */
     unsigned int trailx[4], traily[4], trailc[4];
 };
 
+/* Where each shot is and where it's headed, an array apiece and indexed
+ * like shotRec, so that moving the shots is a loop over plain floats.  All
+ * four are in the one block x points to. */
+struct destruct_motion_s
+{
+    float * x, * y;
+    float * xmov, * ymov;
+};
+
 struct destruct_explo_s
 {
     bool isAvailable;
@@ -191,6 +202,23 @@ struct destruct_wall_s
     unsigned int wallX, wallY;
 };
 
+/* A firing solution of the solver AI's: the angle and power that put a
+ * unit's shot of shotType on target (a unitGrid item, -1 if there was no
+ * target), worked out with the unit at (fromX, fromY) and the target at
+ * (toX, toY).  It is used again while neither has moved, for uses more
+ * ticks, and then worked out afresh in case the terrain has changed.
+ * valid is false if the unit can't reach the target at all; clear is false
+ * if it can only by blasting its way through the terrain. */
+struct destruct_aim_s
+{
+    int target;
+    enum de_shot_t shotType;
+    int fromX, fromY, toX, toY;
+    unsigned int uses;
+    float angle, power;
+    bool valid, clear;
+};
+
 struct destruct_unit_s
 {
     /* Positioning/movement */
@@ -211,6 +239,54 @@ struct destruct_unit_s
     int lastMove;
     unsigned int ani_frame;
     int health;
+    unsigned int shotDelay; /* a massive battle's units reload one by one */
+
+    /* The solver AI's aim, kept with the unit so that a snapshot has it */
+    struct destruct_aim_s aim;
+};
+
+/* Revisions of the rules of play.  Anything that changes what a tick does
+ * gets one, so that input logs recorded under older rules still replay the
+ * way they were played. */
+enum de_rules_t
+{
+    RULES_ORIGINAL = 0, /* as OpenTyrian played it */
+    RULES_FLARE_TABLES, /* explosion flares drawn a tick's worth at a time */
+    RULES_STREAMS,      /* a Philox stream for each part of the game */
+    RULES_EXPLO_POOL,   /* explosions go in the order they were set off,
+                           and the pool grows up to explosion_limit */
+    RULES_SWEPT,        /* shots hit the first dirt along the way they
+                           moved, not just where they end up */
+    RULES_MAP_SEEDS,    /* each round's map comes from a seed of its own */
+    RULES_CURRENT = RULES_MAP_SEEDS
+};
+
+/* How the CPU players play.  The original AI nudges its aim about at
+ * random; the solver works out the angle and power that hit; the rollout AI
+ * plays the shots the solver comes up with out ahead of time, in a match of
+ * its own, and takes the one that does the most damage. */
+enum de_ai_t
+{
+    AI_ORIGINAL = 0,
+    AI_SOLVER,
+    AI_ROLLOUT,
+    MAX_AI
+};
+
+/* What the random numbers are for.  Since RULES_STREAMS each gets its own
+ * stream, so drawing more for one doesn't move the others along; before
+ * that they all came out of the one Mersenne Twister, in play order.  Each
+ * player's AI has a stream of its own, STREAM_AI + the player. */
+enum de_stream_t
+{
+    STREAM_LEVEL = 0, /* the map, the units on it and the song */
+    STREAM_EXPLOSIONS,
+    STREAM_SHOTS,
+    STREAM_AI,
+    STREAM_PLACEMENT = STREAM_AI + MAX_PLAYERS, /* since RULES_MAP_SEEDS, the
+                                                   units and walls, from the
+                                                   round's map seed */
+    MAX_STREAMS
 };
 
 struct destruct_keys_s
@@ -218,15 +294,64 @@ struct destruct_keys_s
     SDL_Scancode Config[MAX_KEY];
 };
 
+struct destruct_config_s
+{
+    unsigned int max_shots;
+    unsigned int min_walls;
+    unsigned int max_walls;
+    unsigned int max_explosions;
+    unsigned int explosion_limit; /* what max_explosions may grow to */
+    unsigned int max_installations;
+    unsigned int players;      /* 2 up to MAX_PLAYERS */
+    unsigned int battle_units; /* units a player gets, if not the mode's, up to DE_MAX_BATTLE_UNITS */
+    unsigned int world_width;  /* the map, from a screen's worth up to */
+    unsigned int world_height; /* DE_MAX_WORLD_WIDTH by DE_MAX_WORLD_HEIGHT */
+    bool allow_custom;
+    bool alwaysalias;
+    bool jumper_straight[2];
+    bool ai[2];
+    enum de_ai_t ai_level;     /* how the CPU players play */
+    unsigned int ai_budget;    /* rollout ticks each rollout AI search may
+                                  play a tick, or 0 to play it out at once */
+    unsigned int ai_time;      /* microseconds the searches' slice may take
+                                  a tick, or 0 to go by ai_budget alone */
+
+    /* Not loaded from the config file.  A headless match never touches the
+     * window, the mixer or the frame timer; it only advances the world.
+     * New matches play by RULES_CURRENT, replays by the log's rules. */
+    bool headless;
+    enum de_rules_t rules;
+
+    /* Tables the config file may alter.  Each match gets its own copy. */
+    bool weaponSystems[MAX_UNITS][MAX_SHOT_TYPES];
+    JE_byte basetypes[10][11]; /* [0] is amount of units */
+    struct destruct_keys_s keys[DE_KEYBOARD_PLAYERS];
+};
+
 struct destruct_moves_s
 {
     bool actions[MAX_MOVE];
 };
 
+/* A shot the rollout AI means to take: unit fires shotType at angle and
+ * power, once it has been turned and powered up to them.  In a rollout it
+ * waits for delay ticks first, as it does while the search for it goes on. */
+struct destruct_plan_s
+{
+    unsigned int unit;
+    enum de_shot_t shotType;
+    float angle, power;
+    unsigned int delay;
+    bool valid;
+};
+
 struct destruct_ai_s
 {
     int c_Angle, c_Power, c_Fire;
     unsigned int c_noDown;
+
+    /* The rollout AI's next shot, if valid */
+    struct destruct_plan_s plan;
 };
 
 struct destruct_player_s
@@ -245,11 +370,499 @@ struct destruct_player_s
     unsigned int score;
 };
 
-extern JE_boolean destructFirstTime;
-extern JE_byte basetypes[10][11];
+/* The parts the per-tick world hash is split into, so that a desync can be
+ * pinned on one of them. */
+enum de_hash_t
+{
+    HASH_PLAYERS = 0, /* players, their units and the round's state */
+    HASH_SHOTS,
+    HASH_EXPLOSIONS,
+    HASH_WALLS,       /* and the map settings */
+    HASH_TERRAIN,     /* every pixel of the terrain */
+    HASH_RNG,
+    MAX_HASHES
+};
+
+extern const char destructHashName[MAX_HASHES][11];
+
+/* The map can be many screens across and down.  Its size is rounded up to
+ * a whole number of tiles, and a pixel's index (x + y * width) has to fit
+ * in the 24 bits a journal entry has for it. */
+#define DE_MAX_WORLD_WIDTH 8192
+#define DE_MAX_WORLD_HEIGHT 2048
+
+/* The dirt plane covers the terrain a bit per pixel, row after row, width /
+ * 64 words to a row.  The spare word at the end lets checks that run off
+ * the bottom row read no dirt instead of whatever comes next.  The other
+ * bit planes are laid out the same way. */
+#define DE_PLANE_WORDS(terrain) ((terrain)->width * (terrain)->height / 64 + 1)
+
+/* Above the plane are summaries of it, for skipping empty space: a bit for
+ * each 8x8 block of pixels with any dirt in it, then a bit for each 64x64
+ * region with any such block.  Both go row after row like the plane. */
+#define DE_BLOCK_WORDS(terrain) (((terrain)->width / 8) * ((terrain)->height / 8) / 64 + 1)
+#define DE_REGION_WORDS(terrain) (((terrain)->columns * (((terrain)->height + 63) / 64) + 63) / 64)
+
+/* The terrain is also split into tiles of a dirt word each, 64x8 pixels, so
+ * that the work done on it each tick and frame can stick to what changed.
+ * Sets of tiles are bitmaps with a bit per tile, row after row. */
+#define DE_TILE_WIDTH 64
+#define DE_TILE_HEIGHT 8
+#define DE_TILE_WORDS(terrain) (((terrain)->columns * (terrain)->rows + 63) / 64)
+
+/* The terrain's pixels are kept a tile at a time.  A tile only gets a chunk
+ * of its own once something draws on it; until then it looks like the
+ * backdrop the map was made over, which repeats every screen across and
+ * carries on down past the screen as its own bottom row of tiles.  Chunks
+ * come DE_CHUNKS_PER_BLOCK to a block and never move, and a new map hands
+ * out the same blocks again. */
+#define DE_CHUNK_SIZE (DE_TILE_WIDTH * DE_TILE_HEIGHT)
+#define DE_CHUNKS_PER_BLOCK 64
+#define DE_BACKDROP_COLUMNS (320 / DE_TILE_WIDTH)
+#define DE_BACKDROP_ROWS (200 / DE_TILE_HEIGHT)
+
+struct destruct_terrain_s
+{
+    unsigned int width, height;  /* in pixels */
+    unsigned int columns, rows;  /* in tiles */
+
+    /* Every tile's chunk, row after row, NULL for the ones still showing
+     * the backdrop.  A chunk is the tile's rows one after another. */
+    Uint8 ** chunk;
+    Uint8 ** block;
+    unsigned int chunkCount, blockCount, blockCapacity;
+
+    Uint8 backdrop[DE_BACKDROP_ROWS * DE_BACKDROP_COLUMNS][DE_CHUNK_SIZE];
+};
 
+/* Units and walls get bucketed into a grid of DE_GRID_SIZE pixel squares
+ * each tick, so that a shot or an explosion only has to be checked against
+ * what's in its own square.  Something sits in every square it could be hit
+ * in, at most four since nothing is bigger than a square. */
+#define DE_GRID_SIZE 16
+
+/* A square's entries are a list through next[], head[cell] first, in the
+ * order they were added.  -1 ends the list.  used has the usedCount
+ * squares with anything in them, so clearing the grid doesn't have to go
+ * over the whole map. */
+struct destruct_grid_s
+{
+    unsigned int columns, rows;
+    int * head, * tail;
+    unsigned int * used;
+    unsigned int usedCount;
+    unsigned int * item;
+    int * next;
+    unsigned int count, capacity;
+};
+
+/* Explosion flares come out of a table of DE_FLARE_ANGLES directions,
+ * sines first and then a quarter turn more of them for the cosines.  An
+ * explosion never has more than DE_MAX_FLARE_FILL flares a tick. */
+#define DE_FLARE_ANGLES 1024
+#define DE_MAX_FLARE_FILL 80
+
+struct destruct_flare_s
+{
+    Uint16 x, y;
+    Uint8 exploType;
+};
+
+/* A round's map as its seed has it (since RULES_MAP_SEEDS), before any
+ * units are put on it: the flags, the song, the ground's height in each
+ * column and the pixels rings of dirt and holes go on, in planes laid out
+ * like the dirt plane.  Nothing else goes into making it, so it can be kept
+ * and used again by any match on a map that size. */
+struct destruct_map_s
+{
+    unsigned long seed;
+    unsigned int mapFlags;
+    unsigned int song;
+    unsigned int * heights;
+    Uint64 * rings, * holes;
+    Uint32 * draws; /* scratch for a ring's random numbers */
+};
+
+struct destruct_mapentry_s
+{
+    unsigned long seed;
+    unsigned int width, height;
+    Uint8 * data;
+    size_t size;
+};
+
+/* Maps made before, packed, for DE_ResetLevel to unpack instead of making
+ * them again.  Once full, the oldest make way.  A cache may be shared by
+ * any number of matches on one thread. */
+struct destruct_mapcache_s
+{
+    unsigned int capacity, count;
+    unsigned int next; /* the entry to fill next */
+    struct destruct_mapentry_s * entries;
+    unsigned long hits, misses;
+};
+
+/* A block of VGAScreen a frame drew over, clipped to the screen */
+struct destruct_rect_s
+{
+    int x, y;
+    unsigned int width, height;
+};
+
+/* One tick of an input log is a flags byte followed by every player's moves,
+ * one bit per de_move_t.  A tick that starts a round also carries the
+ * round's mode in the flags.  Only the keyboard players have a CPU flag. */
+#define DE_LOG_TICK_SIZE(players) (1 + (players))
+
+enum de_log_flags_t
+{
+    LOG_CPU_LEFT = 0x01, /* LOG_CPU_LEFT << player is that player's is_cpu */
+    LOG_CPU_RIGHT = 0x02,
+    LOG_ROUND_START = 0x04,
+    LOG_MODE_SHIFT = 3   /* the mode sits in the bits above LOG_ROUND_START */
+};
+
+/* A match boiled down to what it takes to play it again: the seed and
+ * config it was started with and what every player did on every tick. */
+struct destruct_log_s
+{
+    unsigned long seed;
+    struct destruct_config_s config;
+
+    unsigned int ticks;
+    unsigned int capacity;
+    Uint8 * data; /* DE_LOG_TICK_SIZE(config.players) bytes per tick */
+
+    /* If the log was recorded with hashes, MAX_HASHES per tick of the world
+     * as it was after that tick.  NULL otherwise. */
+    Uint32 * hashes;
+
+    /* If the rollout AI was timed (see destruct_planner_s), config.players
+     * per tick: the rollout ticks each player's search had played in the
+     * slice collected that tick.  NULL otherwise. */
+    Uint16 * slices;
+};
+
+/* Everything one match needs.  Matches share no mutable state, so any
+ * number of them may run side by side, each on its own thread. */
+struct destruct_match_s
+{
+    struct destruct_config_s config;
+    struct destruct_player_s destruct_player[MAX_PLAYERS];
+    struct destruct_world_s world;
+    struct destruct_shot_s * shotRec;
+    struct destruct_motion_s shotMotion;
+    struct destruct_explo_s * exploRec;
+
+    /* world.VGAScreen is what gets shown, a screen's worth of the map at a
+     * time; the internal screen is scratch space for the menus; the prev
+     * screen is saved by pause and help. */
+    SDL_Surface * destructInternalScreen;
+    SDL_Surface * destructPrevScreen;
+
+    /* The map's pixels, which is what the game logic reads */
+    struct destruct_terrain_s terrain;
+
+    /* NULL when nobody is at the keyboard */
+    Uint8 * keysactive;
+
+    unsigned long seed;
+    MTState rng;                      /* before RULES_STREAMS */
+    PhiloxStream stream[MAX_STREAMS]; /* since */
+
+    /* Sound effects queue */
+    JE_byte soundQueue[8]; /* [0..7] */
+    unsigned int exploSoundChannel;
+
+    bool destructFirstTime;
+    unsigned int endDelay;
+
+    /* The world hash as of the end of the last tick.  The terrain part is
+     * kept up to date as pixels change instead of being recomputed. */
+    Uint64 hash[MAX_HASHES];
+
+    /* The input log being recorded or replayed, if any.  logTick counts the
+     * ticks run since then. */
+    struct destruct_log_s * log;
+    bool replaying;
+    bool logRoundStart;
+    unsigned int logTick;
+
+    /* The first replayed tick whose hash differed from the log's, and the
+     * parts that did (1 << de_hash_t).  desyncMask stays 0 until then. */
+    unsigned int desyncTick;
+    unsigned int desyncMask;
+
+    /* Recent snapshots to rewind to, if any.  Terrain changes are journaled
+     * into it as they happen. */
+    struct destruct_history_s * history;
+
+    /* Where the rollout AI plays its shots out, if anywhere.  Without one it
+     * plays as the solver does. */
+    struct destruct_planner_s * planner;
+
+    /* The map of the round, and where to keep maps to use again, if
+     * anywhere. */
+    struct destruct_map_s map;
+    struct destruct_mapcache_s * mapCache;
+
+    /* One bit per pixel of the terrain, set where it's dirt.  This is what
+     * collisions and stability checks look at. */
+    Uint64 * dirt;
+
+    /* For each column of the terrain, the top row with dirt in it, or the
+     * terrain's height if it has none.  Kept up to date along with the
+     * plane, so nothing needs to search a column for the ground. */
+    Uint16 * surface;
+
+    /* The plane's summaries (DE_BLOCK_WORDS and DE_REGION_WORDS), kept up
+     * to date with it.  Swept collisions and traced shots skip whatever
+     * they say is empty. */
+    Uint64 * dirtBlocks;
+    Uint64 * dirtRegions;
+
+    /* Tiles DE_FadeTerrain has to look at next tick: the ones with
+     * explosions fading. */
+    Uint64 * busyTiles;
+
+    /* Pixels it has to anti-alias again, laid out like the dirt plane: the
+     * ones turned black and the neighbours of dirt that came or went.
+     * aliasTiles has the tiles with any of them. */
+    Uint64 * aliasPending;
+    Uint64 * aliasTiles;
+
+    /* The broadphase.  unitGrid has units as player * max_installations +
+     * index, wallGrid has walls by index; both are rebuilt every tick once
+     * units are done moving.  The live shots are kept in lists by grid
+     * column (through shotNext), for magnets to push.  gridUnit turns a
+     * unitGrid item back into its unit without dividing. */
+    struct destruct_grid_s unitGrid, wallGrid;
+    struct destruct_unit_s ** gridUnit;
+    int * shotColumn;
+    int * shotNext;
+    /* Laid out like the dirt plane, the pixels some unit could be hit at as
+     * of the last rebuild.  When a battle crowds a square with units, most
+     * explosion pixels get turned away here without walking its list. */
+    Uint64 * unitPlane;
+
+    /* The shot pool.  shotLive has a bit for each slot in use, agreeing
+     * with isAvailable, and no slot below word shotFreeWord of it is free.
+     * DE_RunTickShots sorts the live ones into shotBatch by how they move
+     * and keeps which of them hit the floor in shotFloor, and where they
+     * were before moving in shotFromX and shotFromY. */
+    Uint64 * shotLive;
+    unsigned int shotFreeWord;
+    unsigned int * shotBatch;
+    Uint8 * shotFloor;
+    float * shotFromX, * shotFromY;
+
+    /* The explosion pool.  exploRec has exploCapacity slots; exploLive has
+     * a bit for each one in use, with none free below word exploFreeWord.
+     * exploActive lists the exploCount in use, in the order a tick goes
+     * through them: by slot before RULES_EXPLO_POOL, the order they were
+     * set off in since.  exploDropped counts the explosions there was no
+     * room for and exploPeak the most there ever were at once. */
+    Uint64 * exploLive;
+    unsigned int exploCapacity, exploFreeWord;
+    unsigned int * exploActive;
+    unsigned int exploCount;
+    unsigned int exploDropped, exploPeak;
+
+    /* This tick's explosion flares, before and after sorting them by row,
+     * the random numbers they're placed by and the direction table they're
+     * aimed from.  There is room for flareCapacity of each. */
+    struct destruct_flare_s * flares, * sortedFlares;
+    Uint32 * flareDraws;
+    unsigned int flareCapacity;
+    float flareSin[DE_FLARE_ANGLES + DE_FLARE_ANGLES / 4];
+
+    /* The units, shots and selections as the current tick found them, for
+     * DE_DrawFrame to interpolate from.  NULL when headless. */
+    struct destruct_unit_s * prevUnit[MAX_PLAYERS];
+    struct destruct_shot_s * prevShotRec;
+    struct destruct_motion_s prevShotMotion;
+    unsigned int prevUnitSelected[MAX_PLAYERS];
+
+    /* What DE_DrawFrame has to put back on VGAScreen before drawing again:
+     * the tiles that changed since the last frame and the blocks it drew
+     * sprites over.  redrawFrame has it copy all of the view instead. */
+    Uint64 * frameTiles;
+    struct destruct_rect_s * drawnRects;
+    unsigned int drawnCount, drawnCapacity;
+    bool redrawFrame;
+
+    /* The part of the map on screen: viewX and viewY are where its top left
+     * corner is on the map.  It follows the shot in viewShot, the last one
+     * fired, while that is in the air and otherwise the keyboard players'
+     * units.  Only the picture depends on these; they are not hashed. */
+    int viewX, viewY;
+    int viewShot;
+};
+
+/* Everything it takes to pick a round up again where it was saved.  Only
+ * the world is in here: the config, the surfaces, the keyboard and the
+ * input log belong to the match. */
+struct destruct_state_s
+{
+    struct destruct_player_s destruct_player[MAX_PLAYERS]; /* minus the units */
+    struct destruct_unit_s * unit[MAX_PLAYERS];
+    struct destruct_shot_s * shotRec;
+    struct destruct_motion_s shotMotion;
+    struct destruct_explo_s * exploRec; /* exploCapacity of them */
+    unsigned int * exploActive;
+    unsigned int exploCapacity, exploCount;
+    struct destruct_wall_s * mapWalls;
+
+    unsigned int * baseMap;
+    enum de_mode_t destructMode;
+    unsigned int mapFlags;
+
+    /* The terrain's chunks, one after another in the order of their tiles,
+     * with a bit in chunked for each tile that has one, the dirt plane, its
+     * summaries and the surface.  All NULL in a history. */
+    Uint8 * terrain;
+    Uint64 * chunked;
+    unsigned int chunkCount, chunkCapacity;
+    Uint64 * dirt;
+    Uint64 * dirtBlocks;
+    Uint64 * dirtRegions;
+    Uint16 * surface;
+
+    MTState rng;
+    PhiloxStream stream[MAX_STREAMS];
+    JE_byte soundQueue[8];
+    unsigned int exploSoundChannel;
+    bool destructFirstTime;
+    unsigned int endDelay;
+    Uint64 hash[MAX_HASHES];
+};
+
+/* A ring of the most recent snapshots.  They leave the terrain out; instead
+ * every terrain pixel that changes has its old value journaled, and a rewind
+ * undoes the journal back to the snapshot.  Only a pixel's first change
+ * after the newest snapshot is journaled, since a rewind never stops
+ * between two snapshots; a fading explosion changes the same pixels every
+ * tick. */
+struct destruct_history_s
+{
+    unsigned int capacity;
+    unsigned int first, count; /* the oldest snapshot and how many there are */
+    struct destruct_state_s * states;
+    size_t * journalEnd; /* where the journal was when each was taken */
+
+    /* Entries are (pixel index << 8 | old value).  Positions count every
+     * entry ever journaled; journal[0] is position journalBase. */
+    Uint32 * journal;
+    size_t journalBase, journalLength, journalCapacity;
+
+    /* One bit per pixel, like the dirt plane, set for the pixels journaled
+     * since the newest snapshot */
+    Uint64 * journaled;
+};
+
+/* The rollout AI weighs up to DE_ROLLOUT_CANDIDATES shots at a time,
+ * DE_ROLLOUT_LANES of them side by side.  Each is played out
+ * DE_ROLLOUT_SAMPLES times, aimed a little off each time the way steering
+ * leaves it, for DE_ROLLOUT_TICKS ticks or to the end of the round. */
+#define DE_ROLLOUT_CANDIDATES 24
+#define DE_ROLLOUT_SAMPLES 3
+#define DE_ROLLOUT_TICKS 300
+#define DE_ROLLOUT_LANES 8
+
+/* The default ai_budget, per search.  A core plays some 70,000 rollout
+ * ticks a second, so a search averages about a fifth of one of the game's
+ * 14.4 ms ticks; a slice full of explosions can take more than the tick,
+ * the more so with two players searching at once. */
+#define DE_ROLLOUT_BUDGET 200
+
+/* The default ai_time, which cuts such a slice short in a windowed match.
+ * It leaves the rest of the tick to the match itself and to drawing it. */
+#define DE_ROLLOUT_TIME 8000
+
+/* A headless match to play rollouts in.  It loads the world being searched
+ * once, snapshots it into its history and rewinds to it after every
+ * rollout, so only the terrain a rollout changes is ever copied back.  A
+ * candidate it is partway through is picked up again from where it left
+ * off by the next slice of the search. */
+struct destruct_rollout_s
+{
+    struct destruct_match_s match;
+    struct destruct_history_s history;
+    bool loaded;  /* with the search's world */
+    unsigned int candidate, sample, tick;  /* where it has got to */
+    int score;  /* the candidate's, so far */
+    unsigned long played, ticks;  /* rollouts so far and their ticks */
+};
+
+/* A search for one player's next shot.  It saves the match into root, and
+ * its candidates are played out DE_ROLLOUT_LANES at a time, side by side,
+ * candidate c in lane c % DE_ROLLOUT_LANES.  Its work, in rollout ticks,
+ * goes a slice of the match's ai_budget a tick, shared out evenly between
+ * the candidates being played.  The lanes are made for the player's first
+ * search. */
+struct destruct_search_s
+{
+    bool searching;
+    struct destruct_rollout_s * lanes;
+    struct destruct_state_s root;
+    struct destruct_plan_s candidate[DE_ROLLOUT_CANDIDATES];
+    int score[DE_ROLLOUT_CANDIDATES];
+    unsigned int count;
+    unsigned int ticks;  /* it will take, and its plan waits in rollouts */
+    int health[MAX_TEAMS];  /* each team's, at root */
+    unsigned long done, end;  /* rollout ticks of it played, and to play by
+                                 the end of the slice */
+    unsigned long reached[DE_ROLLOUT_LANES];  /* how far each lane has got */
+    unsigned long slice;  /* rollout ticks the last slice collected played */
+};
+
+/* Where the rollout AI plays its candidate shots out, for every player at
+ * once.  The lanes being played this tick, taken over every search in turn,
+ * are shared out between as many workers as there are lanes, at most all
+ * of them: worker w plays lanes w, w + jobs and so on.  A candidate scores
+ * the same whichever worker plays it and however the work is sliced, so
+ * the AI plays the same with any number of them.
+ *
+ * dispatch, if set, has to run DE_RunPlanner once for each of the first
+ * jobs workers, the ones with lanes to play, on whatever threads it likes;
+ * without it they run one after another on the match's thread.  With wait
+ * set too, dispatch may return before they are done and the match ticks on
+ * while they play, one tick behind; wait must then return once they are.
+ *
+ * In a match with an ai_time, a slice stops at a deadline on the
+ * performance counter.  The workers go round their lanes a few rollout
+ * ticks at a time until it passes, and each search counts as played as
+ * far as all its lanes got.  How far that was is logged, since it differs
+ * from run to run, and a replay plays the same again without the clock. */
+struct destruct_planner_s
+{
+    unsigned int workers;
+    unsigned int players;
+    void (*dispatch)(struct destruct_planner_s * planner);
+    void (*wait)(struct destruct_planner_s * planner);
+    void * context;  /* dispatch and wait's */
+
+    struct destruct_search_s search[MAX_PLAYERS];
+    unsigned int jobs;  /* workers the slice being played has lanes for */
+    Uint64 deadline;    /* when the slice stops, or 0 when it's played out */
+    bool stale;    /* the round the searches were for is over */
+    bool pending;  /* a slice is waiting to be collected */
+
+    unsigned long searches;  /* so far */
+};
+
+void DE_ResetConfig(struct destruct_config_s * config);
 void load_destruct_config(Config *config_, struct destruct_config_s * config);
 
+// match functions
+void DE_InitMatch(struct destruct_match_s * match,
+                  const struct destruct_config_s * config,
+                  unsigned long seed,
+                  SDL_Surface * screen,
+                  SDL_Surface * destructInternalScreen,
+                  SDL_Surface * destructPrevScreen);
+void DE_FreeMatch(struct destruct_match_s * match);
+
 // Prep functions
 void JE_introScreen(SDL_Surface * screen, SDL_Surface * destructInternalScreen);
 void JE_helpScreen(SDL_Surface * screen,
@@ -257,26 +870,55 @@ void JE_helpScreen(SDL_Surface * screen,
                    struct destruct_player_s * destruct_player);
 
 // level generating functions
-void DE_ResetLevel(const struct destruct_config_s * config,
-                   struct destruct_player_s * destruct_player,
-                   struct destruct_shot_s * shotRec,
-                   struct destruct_explo_s * exploRec,
-                   struct destruct_world_s * world,
-                   SDL_Surface * destructInternalScreen);
+void DE_ResetLevel(struct destruct_match_s * match);
+void DE_PrepareLevel(struct destruct_match_s * match, const SDL_Surface * backdrop);
+void DE_ShowLevel(struct destruct_match_s * match);
+void DE_InitMapCache(struct destruct_mapcache_s * cache, unsigned int capacity);
+void DE_FreeMapCache(struct destruct_mapcache_s * cache);
 
 // player functions
-void DE_ResetPlayers(struct destruct_player_s * destruct_player);
+void DE_ResetPlayers(struct destruct_match_s * match);
+unsigned int DE_TeamUnits(const struct destruct_match_s * match, enum de_team_t team);
+unsigned int DE_TeamScore(const struct destruct_match_s * match, enum de_team_t team);
 
 // unit functions
-void DE_ResetUnits(const struct destruct_config_s * config, struct destruct_player_s * destruct_player);
+void DE_ResetUnits(struct destruct_match_s * match);
 
 // gameplay functions
-enum de_state_t DE_RunTick(const struct destruct_config_s * config,
-                           struct destruct_player_s * destruct_player,
-                           struct destruct_shot_s * shotRec,
-                           struct destruct_explo_s * exploRec,
-                           struct destruct_world_s * world,
-                           SDL_Surface * destructInternalScreen,
-                           SDL_Surface * destructPrevScreen);
+enum de_state_t DE_RunTick(struct destruct_match_s * match);
+void DE_DrawFrame(struct destruct_match_s * match, float alpha);
+void DE_FadeTerrain(struct destruct_match_s * match, bool reference);
+
+// terrain functions
+Uint8 DE_GetTerrainPixel(const struct destruct_match_s * match, unsigned int x, unsigned int y);
+void DE_PutTerrainPixel(struct destruct_match_s * match, unsigned int x, unsigned int y, Uint8 value);
+unsigned int DE_TraceShot(const struct destruct_match_s * match, unsigned int shottype, float x, float y, float xmov, float ymov,
+                          unsigned int ticks, unsigned int * hitX, unsigned int * hitY);
+
+// snapshot functions
+void DE_InitState(struct destruct_state_s * state, const struct destruct_match_s * match);
+void DE_FreeState(struct destruct_state_s * state);
+void DE_SaveState(const struct destruct_match_s * match, struct destruct_state_s * state);
+void DE_RestoreState(struct destruct_match_s * match, const struct destruct_state_s * state);
+
+void DE_InitHistory(struct destruct_match_s * match, struct destruct_history_s * history, unsigned int capacity);
+void DE_FreeHistory(struct destruct_match_s * match);
+void DE_ClearHistory(struct destruct_history_s * history);
+void DE_PushHistory(struct destruct_match_s * match);
+bool DE_RewindHistory(struct destruct_match_s * match, unsigned int back);
+
+// rollout AI functions
+void DE_InitPlanner(struct destruct_planner_s * planner, const struct destruct_match_s * match, unsigned int workers);
+void DE_FreePlanner(struct destruct_planner_s * planner);
+void DE_RunPlanner(struct destruct_planner_s * planner, unsigned int worker);
+void DE_PlannerStats(const struct destruct_planner_s * planner, unsigned long * rollouts, unsigned long * ticks);
+
+// input log functions
+void DE_RecordLog(struct destruct_match_s * match, struct destruct_log_s * log, bool hashes);
+void DE_ReplayLog(struct destruct_match_s * match, struct destruct_log_s * log);
+bool DE_LogRoundStart(const struct destruct_log_s * log, unsigned int tick);
+bool DE_SaveLog(const struct destruct_log_s * log, const char * filename);
+bool DE_LoadLog(struct destruct_log_s * log, const char * filename);
+void DE_FreeLog(struct destruct_log_s * log);
 
 #endif /* DESTRUCT_H */
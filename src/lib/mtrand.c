@@ -43,17 +43,17 @@
 #include "mtrand.h"
 
 /* Period parameters */
-#define N 624
+#define N MT_STATE_N
 #define M 397
 #define MATRIX_A 0x9908b0dfUL   /* constant vector a */
 #define UPPER_MASK 0x80000000UL /* most significant w-r bits */
 #define LOWER_MASK 0x7fffffffUL /* least significant r bits */
 
-static unsigned long x[N];      /* the array for the state vector  */
-static unsigned long *p0, *p1, *pm;
+static MTState global_state;    /* used by the non-reentrant functions */
 
-void mt_srand(unsigned long s)
+void mt_srand_r(MTState *state, unsigned long s)
 {
+	unsigned long *x = state->x;
 	int i;
 	
 	x[0] = s & 0xffffffffUL;
@@ -61,28 +61,30 @@ void mt_srand(unsigned long s)
 		x[i] = (1812433253UL * (x[i - 1] ^ (x[i - 1] >> 30)) + i)
 		     & 0xffffffffUL;           /* for >32 bit machines */
 	}
-	p0 = x;
-	p1 = x + 1;
-	pm = x + M;
+	state->p0 = 0;
+	state->p1 = 1;
+	state->pm = M;
+	state->seeded = true;
 }
 
 /* generates a random number on the interval [0,0xffffffff] */
-unsigned long mt_rand(void)
+unsigned long mt_rand_r(MTState *state)
 {
+	unsigned long *x = state->x;
 	unsigned long y;
 
-	if (!p0) {
+	if (!state->seeded) {
 		/* Default seed */
-		mt_srand(5489UL);
+		mt_srand_r(state, 5489UL);
 	}
 	/* Twisted feedback */
-	y = *p0 = *pm++ ^ (((*p0 & UPPER_MASK) | (*p1 & LOWER_MASK)) >> 1) ^ ((~(*p1 & 1)+1) & MATRIX_A);
-	p0 = p1++;
-	if (pm == x + N) {
-		pm = x;
+	y = x[state->p0] = x[state->pm++] ^ (((x[state->p0] & UPPER_MASK) | (x[state->p1] & LOWER_MASK)) >> 1) ^ ((~(x[state->p1] & 1)+1) & MATRIX_A);
+	state->p0 = state->p1++;
+	if (state->pm == N) {
+		state->pm = 0;
 	}
-	if (p1 == x + N) {
-		p1 = x;
+	if (state->p1 == N) {
+		state->p1 = 0;
 	}
 	/* Temper */
 	y ^= y >> 11;
@@ -93,14 +95,34 @@ unsigned long mt_rand(void)
 }
 
 /* generates a random number on the interval [0,1]. */
-float mt_rand_1(void)
+float mt_rand_1_r(MTState *state)
 {
-	return ((float)mt_rand() / (float)MT_RAND_MAX);
+	return ((float)mt_rand_r(state) / (float)MT_RAND_MAX);
 }
 
 /* generates a random number on the interval [0,1). */
-float mt_rand_lt1(void)
+float mt_rand_lt1_r(MTState *state)
 {
 	/* MT_RAND_MAX must be a float before adding one to it! */
-	return ((float)mt_rand() / ((float)MT_RAND_MAX + 1.0f));
+	return ((float)mt_rand_r(state) / ((float)MT_RAND_MAX + 1.0f));
+}
+
+void mt_srand(unsigned long s)
+{
+	mt_srand_r(&global_state, s);
+}
+
+unsigned long mt_rand(void)
+{
+	return mt_rand_r(&global_state);
+}
+
+float mt_rand_1(void)
+{
+	return mt_rand_1_r(&global_state);
+}
+
+float mt_rand_lt1(void)
+{
+	return mt_rand_lt1_r(&global_state);
 }
@@ -19,11 +19,30 @@
 #ifndef MTRAND_H
 #define MTRAND_H
 
+#include <stdbool.h>
+
 #define MT_RAND_MAX 0xffffffffUL
 
+#define MT_STATE_N 624
+
+/* Generator state.  Holds no pointers, so it can be copied freely. */
+typedef struct
+{
+	unsigned long x[MT_STATE_N];
+	unsigned int p0, p1, pm;
+	bool seeded;
+}
+MTState;
+
 void mt_srand(unsigned long s);
 unsigned long mt_rand(void);
 float mt_rand_1(void);
 float mt_rand_lt1(void);
 
+/* Reentrant versions of the above, for callers that keep their own state. */
+void mt_srand_r(MTState *state, unsigned long s);
+unsigned long mt_rand_r(MTState *state);
+float mt_rand_1_r(MTState *state);
+float mt_rand_lt1_r(MTState *state);
+
 #endif /* MTRAND_H */
@@ -38,7 +38,7 @@ const JE_word fxPlayVol = 4;
 static const float pitPeriod = (12.0f / 14318180.0f) * 1000.0f;
 
 static Uint16 delaySpeed = 0x4300;
-static float delayPeriod = 0x4300 * ((12.0f / 14318180.0f) * 1000.0f);
+float delayPeriod = 0x4300 * ((12.0f / 14318180.0f) * 1000.0f);
 
 static Uint32 target = 0;
 static Uint32 target2 = 0;
@@ -79,6 +79,8 @@ extern size_t soundSampleCount[SOUND_COUNT];
 extern JE_word tyrMusicVolume, fxVolume;
 extern const JE_word fxPlayVol;
 
+extern float delayPeriod;  // milliseconds per unit of setDelay
+
 void setDelay(int delay);
 
 void wait_delay(void);
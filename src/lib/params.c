@@ -19,6 +19,7 @@
 #include "params.h"
 
 #include "arg_parse.h"
+#include "destruct.h"
 #include "file.h"
 #include "loudness.h"
 #include "network.h"
@@ -32,6 +33,29 @@
 
 JE_boolean richMode = false, constantPlay = false, constantDie = false;
 
+JE_boolean headless = false;
+unsigned int headlessRounds = 0, headlessTicks = 0;  // 0 means no limit
+int headlessMode = MODE_5CARDWAR;
+JE_boolean headlessModeSet = false;
+
+unsigned int battlePlayers = 0;  // 0 means the config file's
+unsigned int battleUnits = 0;    // 0 means the mode's
+unsigned int worldWidth = 0, worldHeight = 0;  // 0 means the config file's
+int aiLevel = AI_ORIGINAL;
+JE_boolean aiLevelSet = false;
+
+unsigned int tournamentThreads = 0;  // 0 means one per core
+unsigned int tournamentMatches = 0;  // 0 means the tournament's default
+
+JE_boolean randomSeedSet = false;
+unsigned long randomSeed;
+
+const char *recordFile = NULL;  // input log to write the match to
+JE_boolean recordHashes = false;
+const char *replayFile = NULL;  // input log to play back
+
+JE_boolean benchKernels = false;
+
 /* YKS: Note: LOOT cheat had non letters removed. */
 const char pars[][9] = {
     "LOOT", "RECORD", "NOJOY", "CONSTANT", "DEATH", "NOSOUND", "NOXMAS", "YESXMAS"
@@ -53,9 +77,24 @@ void JE_paramCheck(int argc, char *argv[])
 
         { 'c', 'c', "constant",          false },
         { 'k', 'k', "death",             false },
-        { 'r', 'r', "record",            false },
+        { 'r', 'r', "record",            true },
         { 'l', 'l', "loot",              false },
 
+        { 258, 0,   "headless",          false },
+        { 259, 0,   "rounds",            true },
+        { 260, 0,   "ticks",             true },
+        { 261, 0,   "mode",              true },
+        { 262, 0,   "seed",              true },
+        { 263, 0,   "threads",           true },
+        { 264, 0,   "matches",           true },
+        { 265, 0,   "replay",            true },
+        { 266, 0,   "hashes",            false },
+        { 267, 0,   "bench",             false },
+        { 268, 0,   "players",           true },
+        { 269, 0,   "units",             true },
+        { 270, 0,   "world",             true },
+        { 271, 0,   "ai",                true },
+
         { 0, 0, NULL, false}
     };
 
@@ -89,7 +128,35 @@ void JE_paramCheck(int argc, char *argv[])
                    "  --net-player-number=NUMBER   Sets local player number in a networked game\n"
                    "                               (1 or 2)\n"
                    "  -p, --net-port=PORT          Local port to bind (default is 1333)\n"
-                   "  -d, --net-delay=FRAMES       Set lag-compensation delay (default is 1)\n", argv[0]);
+                   "  -d, --net-delay=FRAMES       Set lag-compensation delay (default is 1)\n\n"
+                   "  --headless                   Run AI-vs-AI rounds without a window, sound\n"
+                   "                               or frame pacing and print the results\n"
+                   "  --rounds=COUNT               Stop a headless run after COUNT rounds\n"
+                   "                               (default is 1 unless --ticks is given)\n"
+                   "  --ticks=COUNT                Stop a headless run after COUNT ticks\n"
+                   "                               (in a tournament, cut each round off)\n"
+                   "  --mode=MODE                  Game mode of a headless run (0-5, default is 0)\n"
+                   "  --seed=SEED                  Seed the random number generator\n"
+                   "  --threads=COUNT              Worker threads of a tournament\n"
+                   "                               (default is one per core)\n"
+                   "  --matches=COUNT              Matches per mode in a tournament, each with\n"
+                   "                               its own seed\n"
+                   "  --players=COUNT              Players in the match (2-8); the ones past\n"
+                   "                               the first two are always the computer\n"
+                   "  --units=COUNT                Give every player COUNT units, up to 256, for\n"
+                   "                               a massive battle\n"
+                   "  --world=WIDTHxHEIGHT         Play on a map of WIDTH by HEIGHT pixels, up to\n"
+                   "                               8192x2048; the view scrolls to follow the action\n"
+                   "  --ai=LEVEL                   How the computer plays: 0 as in the original,\n"
+                   "                               1 solving for its aim, 2 playing its shots\n"
+                   "                               out ahead of time (default is 0)\n\n"
+                   "  -r, --record=FILE            Write an input log of the match to FILE\n"
+                   "  --hashes                     Add world hashes to the input log, so that\n"
+                   "                               --replay can tell where it went out of sync\n"
+                   "  --replay=FILE                Play back an input log without a window,\n"
+                   "                               as fast as possible\n\n"
+                   "  --bench                      Time the terrain kernels under a screen full\n"
+                   "                               of explosions and exit\n", argv[0]);
             exit(0);
             break;
 
@@ -179,7 +246,7 @@ void JE_paramCheck(int argc, char *argv[])
             break;
 
         case 'r':
-            // record_demo = true;
+            recordFile = option.arg;
             break;
 
         case 'l':
@@ -187,12 +254,137 @@ void JE_paramCheck(int argc, char *argv[])
             richMode = true;
             break;
 
+        case 258: // --headless
+            headless = true;
+            break;
+
+        case 259: // --rounds
+        case 260: // --ticks
+        {
+            unsigned int temp;
+            if (sscanf(option.arg, "%u", &temp) == 1)
+                *(option.value == 259 ? &headlessRounds : &headlessTicks) = temp;
+            else
+            {
+                fprintf(stderr, "%s: error: invalid %s count\n", argv[0], option.value == 259 ? "round" : "tick");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        }
+        case 261: // --mode
+        {
+            int temp;
+            if (sscanf(option.arg, "%d", &temp) == 1 && temp >= 0 && temp < MAX_MODES)
+            {
+                headlessMode = temp;
+                headlessModeSet = true;
+            }
+            else
+            {
+                fprintf(stderr, "%s: error: invalid game mode\n", argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        }
+        case 262: // --seed
+            if (sscanf(option.arg, "%lu", &randomSeed) == 1)
+                randomSeedSet = true;
+            else
+            {
+                fprintf(stderr, "%s: error: invalid random seed\n", argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case 263: // --threads
+        case 264: // --matches
+        {
+            unsigned int temp;
+            if (sscanf(option.arg, "%u", &temp) == 1 && temp > 0)
+                *(option.value == 263 ? &tournamentThreads : &tournamentMatches) = temp;
+            else
+            {
+                fprintf(stderr, "%s: error: invalid %s count\n", argv[0], option.value == 263 ? "thread" : "match");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        }
+        case 265: // --replay
+            replayFile = option.arg;
+            break;
+
+        case 266: // --hashes
+            recordHashes = true;
+            break;
+
+        case 267: // --bench
+            benchKernels = true;
+            break;
+
+        case 268: // --players
+        {
+            unsigned int temp;
+            if (sscanf(option.arg, "%u", &temp) == 1 && temp >= 2 && temp <= MAX_PLAYERS)
+                battlePlayers = temp;
+            else
+            {
+                fprintf(stderr, "%s: error: invalid player count\n", argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        }
+        case 269: // --units
+        {
+            unsigned int temp;
+            if (sscanf(option.arg, "%u", &temp) == 1 && temp > 0 && temp <= DE_MAX_BATTLE_UNITS)
+                battleUnits = temp;
+            else
+            {
+                fprintf(stderr, "%s: error: invalid unit count\n", argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        }
+        case 270: // --world
+        {
+            unsigned int width, height;
+            if (sscanf(option.arg, "%ux%u", &width, &height) == 2 && width > 0 && height > 0)
+            {
+                worldWidth = width;
+                worldHeight = height;
+            }
+            else
+            {
+                fprintf(stderr, "%s: error: invalid world size\n", argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        }
+        case 271: // --ai
+        {
+            int temp;
+            if (sscanf(option.arg, "%d", &temp) == 1 && temp >= 0 && temp < MAX_AI)
+            {
+                aiLevel = temp;
+                aiLevelSet = true;
+            }
+            else
+            {
+                fprintf(stderr, "%s: error: invalid AI level\n", argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        }
+
         default:
             assert(false);
             break;
         }
     }
 
+    if (headless && headlessRounds == 0 && headlessTicks == 0)
+        headlessRounds = 1;
+
     // legacy parameter support
     for (int i = option.argn; i < argc; ++i)
     {
@@ -23,6 +23,26 @@
 
 extern JE_boolean richMode, constantPlay, constantDie;
 
+extern JE_boolean headless;
+extern unsigned int headlessRounds, headlessTicks;
+extern int headlessMode;
+extern JE_boolean headlessModeSet;
+
+extern unsigned int battlePlayers, battleUnits;
+extern unsigned int worldWidth, worldHeight;
+extern int aiLevel;
+extern JE_boolean aiLevelSet;
+
+extern unsigned int tournamentThreads, tournamentMatches;
+
+extern JE_boolean randomSeedSet;
+extern unsigned long randomSeed;
+
+extern const char *recordFile, *replayFile;
+extern JE_boolean recordHashes;
+
+extern JE_boolean benchKernels;
+
 void JE_paramCheck(int argc, char *argv[]);
 
 #endif /* PARAMS_H */
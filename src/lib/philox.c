@@ -0,0 +1,144 @@
+/*
+ * OpenTyrian: A modern cross-platform port of Tyrian
+ * Copyright (C) 2007-2009  The OpenTyrian Development Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include "philox.h"
+
+#include <string.h>
+
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U  /* golden ratio */
+#define PHILOX_W1 0xBB67AE85U  /* sqrt(3) - 1 */
+#define PHILOX_ROUNDS 10
+
+/* Blocks philox_fill works on at once.  The rounds go across all of them
+ * lane by lane, which is a loop the compiler can vectorize. */
+#define PHILOX_BATCH 8
+
+/* Block b of the stream: the counter is (b, stream) and the key the seed. */
+static void philox_block(const PhiloxStream *s, uint64_t b, uint32_t out[4])
+{
+	uint32_t c0 = (uint32_t)b, c1 = (uint32_t)(b >> 32), c2 = s->stream, c3 = 0;
+	uint32_t k0 = s->key[0], k1 = s->key[1];
+	uint64_t p0, p1;
+	int r;
+
+	for (r = 0; r < PHILOX_ROUNDS; ++r) {
+		p0 = (uint64_t)PHILOX_M0 * c0;
+		p1 = (uint64_t)PHILOX_M1 * c2;
+		c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+		c1 = (uint32_t)p1;
+		c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+		c3 = (uint32_t)p0;
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+	out[0] = c0;
+	out[1] = c1;
+	out[2] = c2;
+	out[3] = c3;
+}
+
+/* PHILOX_BATCH blocks from b on, interleaved into out as the stream has them */
+static void philox_batch(const PhiloxStream *s, uint64_t b, uint32_t *out)
+{
+	uint32_t c0[PHILOX_BATCH], c1[PHILOX_BATCH], c2[PHILOX_BATCH], c3[PHILOX_BATCH];
+	uint32_t k0 = s->key[0], k1 = s->key[1];
+	uint64_t p0, p1;
+	int i, r;
+
+	for (i = 0; i < PHILOX_BATCH; ++i) {
+		c0[i] = (uint32_t)(b + i);
+		c1[i] = (uint32_t)((b + i) >> 32);
+		c2[i] = s->stream;
+		c3[i] = 0;
+	}
+	for (r = 0; r < PHILOX_ROUNDS; ++r) {
+		for (i = 0; i < PHILOX_BATCH; ++i) {
+			p0 = (uint64_t)PHILOX_M0 * c0[i];
+			p1 = (uint64_t)PHILOX_M1 * c2[i];
+			c0[i] = (uint32_t)(p1 >> 32) ^ c1[i] ^ k0;
+			c1[i] = (uint32_t)p1;
+			c2[i] = (uint32_t)(p0 >> 32) ^ c3[i] ^ k1;
+			c3[i] = (uint32_t)p0;
+		}
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+	for (i = 0; i < PHILOX_BATCH; ++i) {
+		out[4 * i + 0] = c0[i];
+		out[4 * i + 1] = c1[i];
+		out[4 * i + 2] = c2[i];
+		out[4 * i + 3] = c3[i];
+	}
+}
+
+void philox_init(PhiloxStream *s, unsigned long seed, unsigned int stream)
+{
+	s->key[0] = (uint32_t)seed;
+	s->key[1] = (uint32_t)((uint64_t)seed >> 32);
+	s->stream = stream;
+	s->position = 0;
+	memset(s->block, 0, sizeof(s->block));
+}
+
+/* generates a random number on the interval [0,0xffffffff] */
+uint32_t philox_rand(PhiloxStream *s)
+{
+	if ((s->position & 3) == 0)
+		philox_block(s, s->position >> 2, s->block);
+	return s->block[s->position++ & 3];
+}
+
+/* generates a random number on the interval [0,1), with 24 bits of it */
+float philox_rand_lt1(PhiloxStream *s)
+{
+	return (philox_rand(s) >> 8) * (1.0f / 16777216.0f);
+}
+
+void philox_fill(PhiloxStream *s, uint32_t *out, size_t count)
+{
+	uint32_t batch[4 * PHILOX_BATCH];
+	size_t n;
+
+	/* The rest of the current block */
+	while (count > 0 && (s->position & 3) != 0) {
+		*out++ = philox_rand(s);
+		--count;
+	}
+
+	for (; count >= 4 * PHILOX_BATCH; count -= 4 * PHILOX_BATCH) {
+		philox_batch(s, s->position >> 2, out);
+		s->position += 4 * PHILOX_BATCH;
+		out += 4 * PHILOX_BATCH;
+	}
+
+	if (count >= 4) {
+		philox_batch(s, s->position >> 2, batch);
+		n = count & ~(size_t)3;
+		memcpy(out, batch, n * sizeof(*out));
+		s->position += n;
+		out += n;
+		count -= n;
+	}
+
+	while (count > 0) {
+		*out++ = philox_rand(s);
+		--count;
+	}
+}
@@ -0,0 +1,47 @@
+/*
+ * OpenTyrian: A modern cross-platform port of Tyrian
+ * Copyright (C) 2007-2009  The OpenTyrian Development Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2,
+ * 3", SC 2011).  A counter-based generator: number n of a stream is a pure
+ * function of the key, the stream and n, so streams never overlap, can be
+ * skipped through for free and can be filled in bulk. */
+
+/* A stream and where it is.  Holds no pointers, so it can be copied freely. */
+typedef struct
+{
+	uint32_t key[2];
+	uint32_t stream;
+	uint64_t position;  /* numbers drawn so far */
+	uint32_t block[4];  /* the block position is in, unless on a boundary */
+}
+PhiloxStream;
+
+void philox_init(PhiloxStream *s, unsigned long seed, unsigned int stream);
+uint32_t philox_rand(PhiloxStream *s);
+float philox_rand_lt1(PhiloxStream *s);
+
+/* The next count numbers, as count calls to philox_rand would give them */
+void philox_fill(PhiloxStream *s, uint32_t *out, size_t count);
+
+#endif /* PHILOX_H */
@@ -342,6 +342,42 @@ void blit_sprite2(SDL_Surface *surface, int x, int y, Sprite2_array sprite2s, un
 	}
 }
 
+// like blit_sprite2, but drops whatever falls outside the surface rather than running on into the next row
+void blit_sprite2_clip(SDL_Surface *surface, int x, int y, Sprite2_array sprite2s, unsigned int index)
+{
+	assert(surface->format->BitsPerPixel == 8);
+	Uint8 * const pixels = (Uint8 *)surface->pixels;
+	int px = x, py = y;
+	
+	const Uint8 *data = sprite2s.data + SDL_SwapLE16(((Uint16 *)sprite2s.data)[index - 1]);
+	
+	for (; *data != 0x0f; ++data)
+	{
+		px += *data & 0x0f;                       // second nibble: transparent pixel count
+		unsigned int count = (*data & 0xf0) >> 4; // first nibble: opaque pixel count
+		
+		if (count == 0) // move to next pixel row
+		{
+			px -= 12;
+			++py;
+		}
+		else
+		{
+			while (count--)
+			{
+				++data;
+				
+				if (py >= surface->h)
+					return;
+				if (py >= 0 && px >= 0 && px < surface->w)
+					pixels[py * surface->pitch + px] = *data;
+				
+				++px;
+			}
+		}
+	}
+}
+
 void JE_loadMainShapeTables(const char *shp_buffer, const size_t shp_buffer_size)
 {
     enum { SHP_NUM = 13 };
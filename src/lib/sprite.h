@@ -86,6 +86,7 @@ void JE_loadCompShapesB(Sprite2_array *, FILE *f);
 void free_sprite2s(Sprite2_array *);
 
 void blit_sprite2(SDL_Surface *, int x, int y, Sprite2_array, unsigned int index);
+void blit_sprite2_clip(SDL_Surface *, int x, int y, Sprite2_array, unsigned int index);
 
 void JE_loadMainShapeTables(const char *shp_buffer, const size_t shp_buffer_size);
 void free_main_shape_tables(void);
@@ -325,6 +325,17 @@ void JE_showVGA(void)
 	scale_and_flip(VGAScreen); 
 }
 
+// Refresh rate in Hz of the display the window is on, or 60 if SDL can't tell.
+int video_refresh_rate(void)
+{
+	SDL_DisplayMode mode;
+
+	if (main_window == NULL || SDL_GetWindowDisplayMode(main_window, &mode) != 0 || mode.refresh_rate <= 0)
+		return 60;
+
+	return mode.refresh_rate;
+}
+
 static void calc_dst_render_rect(SDL_Surface *const src_surface, SDL_Rect *const dst_rect)
 {
 	// Decides how the logical output texture (after software scaling applied) will fit
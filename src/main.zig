@@ -4,6 +4,7 @@ const builtin = @import("builtin");
 const SDL = @import("sdl2");
 
 const c = @cImport({
+    @cInclude("stdio.h");
     @cInclude("time.h");
     @cInclude("destruct.h");
     @cInclude("config.h");
@@ -30,7 +31,7 @@ pub fn logFn(
 
     var buffer: [128]u8 = undefined;
     const c_string = std.fmt.bufPrintZ(&buffer, prefix2 ++ format ++ "\n", args) catch &buffer;
-    _ = c.printf(c_string.ptr);
+    _ = c.fputs(c_string.ptr, c.stderr);
 }
 
 pub const std_options: std.Options = .{
@@ -39,12 +40,15 @@ pub const std_options: std.Options = .{
         else => .info,
     },
 
-    // Overwrite default log handler
+    // Overwrite default log handler.  It writes to stderr, leaving stdout to
+    // the results (see destruct.printResult).
     .logFn = logFn,
 };
 
 pub fn main() u8 {
-    c.mt_srand(@intCast(c.time(0)));
+    c.JE_paramCheck(@intCast(std.os.argv.len), @ptrCast(std.os.argv.ptr));
+
+    c.mt_srand(if (c.randomSeedSet) c.randomSeed else @intCast(c.time(0)));
 
     std.log.info("Welcome to... >> {s} {s} <<\n", .{ c.opentyrian_str, c.opentyrian_version });
 
@@ -65,8 +69,6 @@ pub fn main() u8 {
     // Tyrian 2000 requires help text to be loaded before the configuration,
     // because the default high score names are stored in help text
 
-    c.JE_paramCheck(0, null);
-
     c.JE_loadHelpText(destruct.assets.texts.ptr, destruct.assets.texts.len);
 
     c.JE_loadConfiguration();
@@ -77,6 +79,22 @@ pub fn main() u8 {
         c.JE_saveConfiguration();
     }
 
+    if (c.benchKernels) {
+        // no window either; just the terrain pass, timed
+        return if (destruct.JE_destructBench()) 0 else 1;
+    }
+
+    if (c.replayFile != null) {
+        // headless as well; the log says who does what
+        return if (destruct.JE_destructReplay(c.replayFile)) 0 else 1;
+    }
+
+    if (c.headless) {
+        // no window, keyboard or audio; just the simulation
+        destruct.JE_destructHeadless(c.headlessMode, c.headlessRounds, c.headlessTicks, c.recordFile, c.recordHashes);
+        return 0;
+    }
+
     c.init_video("destruct");
     defer c.deinit_video();
 
@@ -104,7 +122,7 @@ pub fn main() u8 {
         }
     }
 
-    destruct.JE_destructGame();
+    destruct.JE_destructGame(c.recordFile, c.recordHashes);
 
     return 0;
 }
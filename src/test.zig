@@ -0,0 +1,349 @@
+const std = @import("std");
+const testing = std.testing;
+
+const destruct = @import("destruct.zig");
+const c = destruct.c;
+
+const philox = @cImport({
+    @cInclude("philox.h");
+});
+
+// A stream's counter is (block, stream, 0) under the key (seed), so of
+// Random123's known answers for Philox4x32-10 only the all-zero one can be
+// reached.  The second set keeps Random123's digits of pi for everything
+// but the counter's last word; its answer comes from the reference
+// algorithm, checked against all of Random123's known answers.
+test "philox gives the known answers" {
+    var stream: philox.PhiloxStream = undefined;
+
+    philox.philox_init(&stream, 0, 0);
+    for ([_]u32{ 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 }) |expected| {
+        try testing.expectEqual(expected, philox.philox_rand(&stream));
+    }
+
+    philox.philox_init(&stream, 0, 0x13198a2e);
+    stream.key = .{ 0xa4093822, 0x299f31d0 };
+    stream.position = 0x05a308d3243f6a88 * 4;
+    for ([_]u32{ 0xf495576a, 0x5807f187, 0xd142cd03, 0xa4ead775 }) |expected| {
+        try testing.expectEqual(expected, philox.philox_rand(&stream));
+    }
+}
+
+test "philox_fill gives what philox_rand does" {
+    var filled_stream: philox.PhiloxStream = undefined;
+    philox.philox_init(&filled_stream, 1234, 5);
+    _ = philox.philox_rand(&filled_stream); // off a block boundary
+    var stream = filled_stream;
+
+    // A part block, whole batches of blocks and a part block again
+    var filled: [101]u32 = undefined;
+    philox.philox_fill(&filled_stream, &filled, filled.len);
+    for (filled) |number| {
+        try testing.expectEqual(philox.philox_rand(&stream), number);
+    }
+    try testing.expectEqual(stream.position, filled_stream.position);
+}
+
+// The three surfaces a match draws on, as a headless match has them
+const Screens = struct {
+    screen: *c.SDL_Surface,
+    destructInternalScreen: *c.SDL_Surface,
+    destructPrevScreen: *c.SDL_Surface,
+
+    fn init() Screens {
+        return .{
+            .screen = destruct.createScreen(),
+            .destructInternalScreen = destruct.createScreen(),
+            .destructPrevScreen = destruct.createScreen(),
+        };
+    }
+
+    fn deinit(self: Screens) void {
+        c.SDL_FreeSurface(self.destructPrevScreen);
+        c.SDL_FreeSurface(self.destructInternalScreen);
+        c.SDL_FreeSurface(self.screen);
+    }
+
+    fn initMatch(self: Screens, match: *c.destruct_match_s, config: *const c.destruct_config_s, seed: c_ulong) void {
+        c.DE_InitMatch(match, config, seed, self.screen, self.destructInternalScreen, self.destructPrevScreen);
+    }
+};
+
+fn headlessConfig() c.destruct_config_s {
+    var config: c.destruct_config_s = undefined;
+    c.DE_ResetConfig(&config);
+    config.headless = true;
+    return config;
+}
+
+// The bench's load, faded out once by the incremental pass and its vector
+// kernels and once by the whole-map scalar reference.
+test "the incremental fade leaves what the reference does" {
+    const screens = Screens.init();
+    defer screens.deinit();
+
+    var config = headlessConfig();
+    config.alwaysalias = true;
+
+    var match: c.destruct_match_s = undefined;
+    screens.initMatch(&match, &config, 1);
+    defer c.DE_FreeMatch(&match);
+
+    c.DE_ResetPlayers(&match);
+    c.DE_ResetLevel(&match);
+    destruct.fillFadeLoad(&match);
+
+    var state: c.destruct_state_s = undefined;
+    c.DE_InitState(&state, &match);
+    defer c.DE_FreeState(&state);
+    c.DE_SaveState(&match, &state);
+    const start_hash = match.hash[c.HASH_TERRAIN];
+
+    const width: usize = match.terrain.width;
+    const height: usize = match.terrain.height;
+    const terrain = try testing.allocator.alloc(u8, 2 * width * height);
+    defer testing.allocator.free(terrain);
+    var hash: [2]u64 = undefined;
+    for ([_]bool{ false, true }, 0..) |reference, kernel| {
+        c.DE_RestoreState(&match, &state);
+        for (0..15) |_| {
+            c.DE_FadeTerrain(&match, reference);
+        }
+
+        const kernel_terrain = terrain[kernel * width * height ..][0 .. width * height];
+        for (0..height) |y| {
+            for (0..width) |x| {
+                kernel_terrain[y * width + x] = c.DE_GetTerrainPixel(&match, @intCast(x), @intCast(y));
+            }
+        }
+        hash[kernel] = match.hash[c.HASH_TERRAIN];
+    }
+
+    try testing.expect(hash[1] != start_hash);
+    try testing.expectEqualSlices(u8, terrain[width * height ..], terrain[0 .. width * height]);
+    try testing.expectEqual(hash[1], hash[0]);
+}
+
+const Replay = struct {
+    ticks: c_uint,
+    desync_tick: c_uint,
+    desync_mask: c_uint,
+    scores: [c.MAX_TEAMS]c_uint,
+};
+
+// Plays log back the way --replay does, up to the first tick that doesn't
+// match its hashes.
+fn replay(log: *c.destruct_log_s, backdrop: *const c.SDL_Surface, screens: Screens) Replay {
+    var config = log.config;
+    config.headless = true;
+
+    var match: c.destruct_match_s = undefined;
+    screens.initMatch(&match, &config, log.seed);
+    defer c.DE_FreeMatch(&match);
+
+    c.DE_ResetPlayers(&match);
+    c.DE_ReplayLog(&match, log);
+
+    while (match.logTick < log.ticks and match.desyncMask == 0) {
+        _ = c.memcpy(match.world.VGAScreen.*.pixels, backdrop.pixels, @intCast(backdrop.h * backdrop.pitch));
+        c.DE_ResetUnits(&match);
+        c.DE_ResetLevel(&match);
+
+        while (true) {
+            const curState = c.DE_RunTick(&match);
+            if (match.desyncMask != 0 or curState != c.STATE_CONTINUE or match.logTick >= log.ticks or c.DE_LogRoundStart(log, match.logTick)) {
+                break;
+            }
+        }
+    }
+
+    var result = Replay{
+        .ticks = match.logTick,
+        .desync_tick = match.desyncTick,
+        .desync_mask = match.desyncMask,
+        .scores = undefined,
+    };
+    for (&result.scores, 0..) |*score, team| {
+        score.* = c.DE_TeamScore(&match, @intCast(team));
+    }
+    return result;
+}
+
+// Three rounds of three modes, recorded with hashes, saved and loaded again.
+// The replay has to match every tick and end on the same score, and a hash
+// made wrong on purpose has to be caught where it is.
+test "a recorded log replays with every hash matching" {
+    const backdrop = destruct.loadBackdrop();
+    defer c.SDL_FreeSurface(backdrop);
+    const screens = Screens.init();
+    defer screens.deinit();
+
+    var log: c.destruct_log_s = undefined;
+    var scores: [c.MAX_TEAMS]c_uint = undefined;
+    {
+        const config = headlessConfig();
+        var match: c.destruct_match_s = undefined;
+        screens.initMatch(&match, &config, 1234);
+        defer c.DE_FreeMatch(&match);
+
+        c.DE_ResetPlayers(&match);
+        for (&match.destruct_player) |*player| {
+            player.is_cpu = true;
+        }
+        c.DE_RecordLog(&match, &log, true);
+        for (0..3) |mode| {
+            match.world.destructMode = @intCast(mode);
+            _ = destruct.playRound(&match, backdrop, 1500);
+        }
+        for (&scores, 0..) |*score, team| {
+            score.* = c.DE_TeamScore(&match, @intCast(team));
+        }
+    }
+    defer c.DE_FreeLog(&log);
+
+    var tmp = testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const dir_path = try tmp.dir.realpathAlloc(testing.allocator, ".");
+    defer testing.allocator.free(dir_path);
+    const filename = try std.fs.path.joinZ(testing.allocator, &.{ dir_path, "replay.dlog" });
+    defer testing.allocator.free(filename);
+
+    try testing.expect(c.DE_SaveLog(&log, filename.ptr));
+    var loaded: c.destruct_log_s = undefined;
+    try testing.expect(c.DE_LoadLog(&loaded, filename.ptr));
+    defer c.DE_FreeLog(&loaded);
+    try testing.expect(loaded.hashes != null);
+    try testing.expectEqual(log.ticks, loaded.ticks);
+
+    const result = replay(&loaded, backdrop, screens);
+    try testing.expectEqual(@as(c_uint, 0), result.desync_mask);
+    try testing.expectEqual(loaded.ticks, result.ticks);
+    try testing.expectEqualSlices(c_uint, &scores, &result.scores);
+
+    const tick = loaded.ticks / 2;
+    loaded.hashes[@as(usize, tick) * c.MAX_HASHES + c.HASH_TERRAIN] ^= 1;
+    const desync = replay(&loaded, backdrop, screens);
+    try testing.expectEqual(tick, desync.desync_tick);
+    try testing.expectEqual(@as(c_uint, 1) << c.HASH_TERRAIN, desync.desync_mask);
+}
+
+// Whether the straight line from (x0, y0) to (x1, y1) meets dirt, one pixel
+// at a time, the way DE_SweepDirt rounds it
+fn sweepDirt(match: *const c.destruct_match_s, x0: f32, y0: f32, x1: f32, y1: f32, hit_x: *c_uint, hit_y: *c_uint) bool {
+    const pixel_dirt = 25;
+    const dx = x1 - x0;
+    const dy = y1 - y0;
+    const steps: u32 = @intFromFloat(@max(@ceil(@abs(dx)), @ceil(@abs(dy)), 1.0));
+    for (1..steps + 1) |k| {
+        const k_f: f32 = @floatFromInt(k);
+        const steps_f: f32 = @floatFromInt(steps);
+        const x = if (k == steps) x1 else x0 + dx * k_f / steps_f;
+        const y = if (k == steps) y1 else y0 + dy * k_f / steps_f;
+        if (y <= 14 or x < 0) {
+            continue;
+        }
+        const px: c_uint = @intFromFloat(@round(x));
+        const py: c_uint = @intFromFloat(@round(y));
+        if (px >= match.terrain.width or py >= match.terrain.height) {
+            continue;
+        }
+        if (c.DE_GetTerrainPixel(match, px, py) == pixel_dirt) {
+            hit_x.* = px;
+            hit_y.* = py;
+            return true;
+        }
+    }
+    return false;
+}
+
+// DE_TraceShot the slow way: the flight as DE_MoveShots and DE_BounceShots
+// have it, tick by tick, and sweepDirt between ticks
+fn traceShot(match: *const c.destruct_match_s, bounces: bool, start_x: f32, start_y: f32, start_xmov: f32, start_ymov: f32, ticks: c_uint, hit_x: *c_uint, hit_y: *c_uint) c_uint {
+    const bottom: f32 = @floatFromInt(match.terrain.height - 1);
+    const right: f32 = @floatFromInt(match.terrain.width - 2);
+    var x = start_x;
+    var y = start_y;
+    var xmov = start_xmov;
+    var ymov = start_ymov;
+    for (1..ticks + 1) |tick| {
+        const from_x = x;
+        const from_y = y;
+        x += xmov;
+        y += ymov;
+        if (bounces) {
+            if (y > bottom or y < 14) {
+                y -= ymov;
+                ymov = -ymov;
+            }
+            if (x < 1 or x > right) {
+                x -= xmov;
+                xmov = -xmov;
+            }
+        } else {
+            ymov += 0.05;
+            if (y > bottom) {
+                y -= ymov;
+                ymov = -ymov * 0.8;
+            }
+        }
+
+        if (x > right or x < 1) {
+            return 0;
+        }
+        if (y > 14 and sweepDirt(match, from_x, from_y, x, y, hit_x, hit_y)) {
+            return @intCast(tick);
+        }
+    }
+    return 0;
+}
+
+// Shots fired every which way over a map a round has been played on for a
+// while, half of them a falling shot (type 0) and half a bouncing one
+// (type 11).  The occupancy structure's sweeps have to find the very pixel
+// the brute force does.
+test "DE_TraceShot hits what a pixel by pixel trace does" {
+    const backdrop = destruct.loadBackdrop();
+    defer c.SDL_FreeSurface(backdrop);
+    const screens = Screens.init();
+    defer screens.deinit();
+
+    const config = headlessConfig();
+    var match: c.destruct_match_s = undefined;
+    screens.initMatch(&match, &config, 3);
+    defer c.DE_FreeMatch(&match);
+
+    c.DE_ResetPlayers(&match);
+    for (&match.destruct_player) |*player| {
+        player.is_cpu = true;
+    }
+    match.world.destructMode = c.MODE_5CARDWAR;
+    _ = destruct.playRound(&match, backdrop, 300);
+
+    var prng = std.Random.DefaultPrng.init(1);
+    const random = prng.random();
+    const width: f32 = @floatFromInt(match.terrain.width);
+    var hits: usize = 0;
+    for (0..2000) |i| {
+        const bounces = i % 2 == 1;
+        const angle = random.float(f32) * std.math.pi;
+        const power = 1 + random.float(f32) * 5;
+        const x = 20 + random.float(f32) * (width - 40);
+        const xmov = @cos(angle) * power;
+        const ymov = -@sin(angle) * power;
+
+        var hit_x: c_uint = 0;
+        var hit_y: c_uint = 0;
+        const tick = c.DE_TraceShot(&match, if (bounces) 11 else 0, x, 60, xmov, ymov, 500, &hit_x, &hit_y);
+        var expected_x: c_uint = 0;
+        var expected_y: c_uint = 0;
+        const expected_tick = traceShot(&match, bounces, x, 60, xmov, ymov, 500, &expected_x, &expected_y);
+
+        try testing.expectEqual(expected_tick, tick);
+        if (tick != 0) {
+            try testing.expectEqual(expected_x, hit_x);
+            try testing.expectEqual(expected_y, hit_y);
+            hits += 1;
+        }
+    }
+    try testing.expect(hits > 0);
+}
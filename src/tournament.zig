@@ -0,0 +1,355 @@
+const std = @import("std");
+
+const destruct = @import("destruct.zig");
+const c = destruct.c;
+
+const params = @cImport({
+    @cInclude("time.h");
+    @cInclude("params.h");
+});
+
+pub const std_options = @import("main.zig").std_options;
+
+// Matches per mode when --matches isn't given, and rounds per match when
+// --rounds isn't.
+const default_matches = 100;
+const default_rounds = 10;
+
+// One task is one match: a handful of rounds of one mode, played from one seed.
+const Task = struct {
+    mode: c.de_mode_t,
+    seed: c_ulong,
+};
+
+const MatchResult = struct {
+    rounds: u64 = 0,
+    wins: [c.MAX_TEAMS]u64 = std.mem.zeroes([c.MAX_TEAMS]u64),
+    draws: u64 = 0,
+    unfinished: u64 = 0,
+    ticks: u64 = 0,
+
+    fn add(self: *MatchResult, other: MatchResult) void {
+        self.rounds += other.rounds;
+        for (&self.wins, other.wins) |*wins, other_wins| {
+            wins.* += other_wins;
+        }
+        self.draws += other.draws;
+        self.unfinished += other.unfinished;
+        self.ticks += other.ticks;
+    }
+
+    // A breakdown goes to the debug log, a result to stdout.
+    fn report(self: MatchResult, comptime to: enum { debug, result }, name: []const u8, matches: usize) void {
+        const args = .{
+            name,
+            matches,
+            self.rounds,
+            self.wins[c.TEAM_LEFT],
+            self.wins[c.TEAM_RIGHT],
+            self.draws,
+            self.unfinished,
+            if (self.rounds > 0) @as(f64, @floatFromInt(self.ticks)) / @as(f64, @floatFromInt(self.rounds)) else 0,
+        };
+        const format = "{s}: {d} matches, {d} rounds (left {d}, right {d}, draws {d}, unfinished {d}), {d:.0} ticks/round";
+        switch (to) {
+            .debug => std.log.debug(format, args),
+            .result => destruct.printResult(format, args),
+        }
+    }
+};
+
+const Pool = struct {
+    config: c.destruct_config_s,
+    backdrop: *const c.SDL_Surface,
+    rounds: c_uint,
+    max_ticks: c_uint,
+
+    tasks: []const Task,
+    results: []MatchResult,
+    workers: []Worker,
+};
+
+const Worker = struct {
+    pool: *const Pool,
+    thread: std.Thread = undefined,
+
+    // Tasks [head, tail) of pool.tasks are queued on this worker.  The owner
+    // works from the tail; thieves take the older half from the head.
+    mutex: std.Thread.Mutex = .{},
+    head: usize,
+    tail: usize,
+
+    // Picks whom to steal from.  Match seeds come from the task, so the
+    // results don't depend on which worker ends up playing what.
+    prng: std.Random.DefaultPrng,
+
+    screen: *c.SDL_Surface,
+    destructInternalScreen: *c.SDL_Surface,
+    destructPrevScreen: *c.SDL_Surface,
+
+    // Maps this worker has made.  Every mode plays the same seeds, so a
+    // seed's rounds come up again with each of its other modes, and the
+    // queue keeps a seed's modes together.
+    maps: c.destruct_mapcache_s = undefined,
+
+    matches: usize = 0,
+    steals: usize = 0,
+
+    fn pop(self: *Worker) ?usize {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        if (self.head == self.tail) {
+            return null;
+        }
+        self.tail -= 1;
+        return self.tail;
+    }
+
+    // Moves half of some other worker's queue over to this (empty) one.
+    // Returns false once there is nothing left to steal anywhere.
+    fn steal(self: *Worker) bool {
+        const workers = self.pool.workers;
+        const first = self.prng.random().uintLessThan(usize, workers.len);
+
+        for (0..workers.len) |i| {
+            const victim = &workers[(first + i) % workers.len];
+            if (victim == self) {
+                continue;
+            }
+
+            victim.mutex.lock();
+            const queued = victim.tail - victim.head;
+            const head = victim.head;
+            const count = (queued + 1) / 2;
+            victim.head += count;
+            victim.mutex.unlock();
+
+            if (count == 0) {
+                continue;
+            }
+
+            self.mutex.lock();
+            self.head = head;
+            self.tail = head + count;
+            self.mutex.unlock();
+
+            self.steals += 1;
+            return true;
+        }
+        return false;
+    }
+
+    fn run(self: *Worker) void {
+        while (true) {
+            const index = self.pop() orelse {
+                if (self.steal()) {
+                    continue;
+                }
+                break;
+            };
+
+            self.pool.results[index] = self.playMatch(self.pool.tasks[index]);
+            self.matches += 1;
+        }
+    }
+
+    fn playMatch(self: *Worker, task: Task) MatchResult {
+        const pool = self.pool;
+
+        var match: c.destruct_match_s = undefined;
+        c.DE_InitMatch(&match, &pool.config, task.seed, self.screen, self.destructInternalScreen, self.destructPrevScreen);
+        defer c.DE_FreeMatch(&match);
+        match.mapCache = &self.maps;
+
+        // Every core is busy with a match already, so the rollout AI plays
+        // its shots out on this one.
+        var planner: destruct.Planner = .{};
+        planner.start(&match, 1, false);
+        defer planner.stop();
+
+        c.DE_ResetPlayers(&match);
+        for (&match.destruct_player) |*player| {
+            player.is_cpu = true;
+        }
+        match.world.destructMode = task.mode;
+
+        var result = MatchResult{};
+        while (result.rounds < pool.rounds) {
+            const round = destruct.playRound(&match, pool.backdrop, pool.max_ticks);
+            result.rounds += 1;
+            result.ticks += round.ticks;
+
+            const left_alive = c.DE_TeamUnits(&match, c.TEAM_LEFT) > 0;
+            const right_alive = c.DE_TeamUnits(&match, c.TEAM_RIGHT) > 0;
+            if (!round.finished) {
+                result.unfinished += 1;
+            } else if (left_alive == right_alive) {
+                result.draws += 1;
+            } else {
+                const winner: usize = if (left_alive) c.TEAM_LEFT else c.TEAM_RIGHT;
+                result.wins[winner] += 1;
+            }
+        }
+        return result;
+    }
+};
+
+pub fn main() u8 {
+    params.JE_paramCheck(@intCast(std.os.argv.len), @ptrCast(std.os.argv.ptr));
+
+    // The destruct settings come out of the same config file the game uses,
+    // which needs the help text loaded first.
+    c.JE_loadHelpText(destruct.assets.texts.ptr, destruct.assets.texts.len);
+    c.JE_loadConfiguration();
+
+    const allocator = std.heap.page_allocator;
+
+    const config = destruct.loadConfig(true);
+    const base_seed: c_ulong = if (params.randomSeedSet) params.randomSeed else @intCast(params.time(0));
+    const matches: usize = if (params.tournamentMatches != 0) params.tournamentMatches else default_matches;
+
+    var modes_buffer: [c.MAX_MODES]c.de_mode_t = undefined;
+    var modes = std.ArrayListUnmanaged(c.de_mode_t).initBuffer(&modes_buffer);
+    if (params.headlessModeSet) {
+        modes.appendAssumeCapacity(params.headlessMode);
+    } else {
+        for (0..c.MAX_MODES) |mode| {
+            if (mode == c.MODE_CUSTOM and !config.allow_custom) {
+                continue;
+            }
+            modes.appendAssumeCapacity(@intCast(mode));
+        }
+    }
+
+    // Every mode is played from the same seeds, so modes can be compared
+    // seed by seed.  Laid out seed-major so each worker's share of the queue
+    // gets a mix of modes.
+    const tasks = allocator.alloc(Task, matches * modes.items.len) catch oom();
+    defer allocator.free(tasks);
+    for (0..matches) |seed_index| {
+        for (modes.items, 0..) |mode, mode_index| {
+            tasks[seed_index * modes.items.len + mode_index] = .{
+                .mode = mode,
+                .seed = base_seed +% @as(c_ulong, @intCast(seed_index)),
+            };
+        }
+    }
+
+    const results = allocator.alloc(MatchResult, tasks.len) catch oom();
+    defer allocator.free(results);
+
+    const cpu_count = std.Thread.getCpuCount() catch 1;
+    const thread_count: usize = @max(1, @min(tasks.len, if (params.tournamentThreads != 0) params.tournamentThreads else cpu_count));
+
+    const backdrop = destruct.loadBackdrop();
+    defer c.SDL_FreeSurface(backdrop);
+
+    var pool = Pool{
+        .config = config,
+        .backdrop = backdrop,
+        .rounds = if (params.headlessRounds != 0) params.headlessRounds else default_rounds,
+        .max_ticks = params.headlessTicks,
+        .tasks = tasks,
+        .results = results,
+        .workers = allocator.alloc(Worker, thread_count) catch oom(),
+    };
+    defer allocator.free(pool.workers);
+
+    // Start every worker off with an even share of the queue.
+    for (pool.workers, 0..) |*worker, i| {
+        worker.* = .{
+            .pool = &pool,
+            .head = tasks.len * i / thread_count,
+            .tail = tasks.len * (i + 1) / thread_count,
+            .prng = std.Random.DefaultPrng.init(base_seed +% @as(c_ulong, @intCast(i))),
+            .screen = destruct.createScreen(),
+            .destructInternalScreen = destruct.createScreen(),
+            .destructPrevScreen = destruct.createScreen(),
+        };
+        c.DE_InitMapCache(&worker.maps, 2 * pool.rounds);
+    }
+    defer {
+        for (pool.workers) |*worker| {
+            c.DE_FreeMapCache(&worker.maps);
+            c.SDL_FreeSurface(worker.destructPrevScreen);
+            c.SDL_FreeSurface(worker.destructInternalScreen);
+            c.SDL_FreeSurface(worker.screen);
+        }
+    }
+
+    destruct.printResult("tournament: {d} modes x {d} seeds (from {d}), {d} rounds per match, {d} threads", .{
+        modes.items.len,
+        matches,
+        base_seed,
+        pool.rounds,
+        thread_count,
+    });
+
+    const start_time = std.time.nanoTimestamp();
+
+    // The main thread is worker 0.
+    for (pool.workers[1..]) |*worker| {
+        worker.thread = std.Thread.spawn(.{}, Worker.run, .{worker}) catch |err| {
+            std.log.err("Failed to start worker thread: {s}", .{@errorName(err)});
+            std.process.exit(1);
+        };
+    }
+    pool.workers[0].run();
+    for (pool.workers[1..]) |*worker| {
+        worker.thread.join();
+    }
+
+    const elapsed_ns = std.time.nanoTimestamp() - start_time;
+    const elapsed_s = @as(f64, @floatFromInt(elapsed_ns)) / std.time.ns_per_s;
+
+    // Results per seed, summed over the modes
+    for (0..matches) |seed_index| {
+        var total = MatchResult{};
+        for (results[seed_index * modes.items.len ..][0..modes.items.len]) |result| {
+            total.add(result);
+        }
+
+        var name_buffer: [32]u8 = undefined;
+        const name = std.fmt.bufPrint(&name_buffer, "seed {d}", .{tasks[seed_index * modes.items.len].seed}) catch "seed";
+        total.report(.debug, name, modes.items.len);
+    }
+
+    for (pool.workers, 0..) |worker, i| {
+        std.log.debug("worker {d}: {d} matches, {d} steals, maps {d} made {d} reused", .{
+            i,
+            worker.matches,
+            worker.steals,
+            worker.maps.misses,
+            worker.maps.hits,
+        });
+    }
+
+    // Results per mode, summed over the seeds
+    var total = MatchResult{};
+    for (modes.items, 0..) |mode, mode_index| {
+        var mode_total = MatchResult{};
+        for (0..matches) |seed_index| {
+            mode_total.add(results[seed_index * modes.items.len + mode_index]);
+        }
+        mode_total.report(.result, destruct.modeName(mode), matches);
+        total.add(mode_total);
+    }
+    total.report(.result, "total", tasks.len);
+
+    const matches_per_s = if (elapsed_s > 0) @as(f64, @floatFromInt(tasks.len)) / elapsed_s else 0;
+    destruct.printResult("{d} matches in {d:.3} s: {d:.2} matches/s, {d:.3} matches/s per core, {d:.0} ticks/s", .{
+        tasks.len,
+        elapsed_s,
+        matches_per_s,
+        matches_per_s / @as(f64, @floatFromInt(thread_count)),
+        if (elapsed_s > 0) @as(f64, @floatFromInt(total.ticks)) / elapsed_s else 0,
+    });
+
+    return 0;
+}
+
+fn oom() noreturn {
+    std.log.err("Out of memory", .{});
+    std.process.exit(1);
+}